@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "configqueue.h"
+
+ConfigQueue::ConfigQueue()
+	: m_bRunning(false)
+	, m_bStop(false)
+	, m_ulPostedCount(0)
+	, m_ulCoalescedCount(0)
+{
+}
+
+ConfigQueue::~ConfigQueue()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_conditionEntry.notify_all();
+	if (m_threadControl.joinable())
+		m_threadControl.join();
+}
+
+void ConfigQueue::post(uint32_t key, const Command& command, const Callback& callback)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_ulPostedCount++;
+		//the thread is started with the first command
+		if (!m_threadControl.joinable())
+			m_threadControl = thread(&ConfigQueue::controlThread, this);
+
+		for (auto itr = m_queueEntry.begin(); itr != m_queueEntry.end(); itr++)
+		{
+			if (itr->key == key)
+			{
+				itr->command = command;
+				if (callback)
+					itr->callbacks.push_back(callback);
+				m_ulCoalescedCount++;
+				return;
+			}
+		}
+		Entry entry;
+		entry.key = key;
+		entry.command = command;
+		if (callback)
+			entry.callbacks.push_back(callback);
+		m_queueEntry.push_back(entry);
+	}
+	m_conditionEntry.notify_one();
+}
+
+void ConfigQueue::wait()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_conditionIdle.wait(lock, [this] { return m_queueEntry.empty() && !m_bRunning; });
+}
+
+uint64_t ConfigQueue::getPostedCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_ulPostedCount;
+}
+
+uint64_t ConfigQueue::getCoalescedCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_ulCoalescedCount;
+}
+
+void ConfigQueue::controlThread()
+{
+	unique_lock<mutex> lock(m_mutex);
+	while (true)
+	{
+		m_conditionEntry.wait(lock, [this] { return m_bStop || !m_queueEntry.empty(); });
+		if (m_queueEntry.empty()) //stopped, all the pending commands have run
+			break;
+		Entry entry = m_queueEntry.front();
+		m_queueEntry.pop_front();
+		m_bRunning = true;
+
+		lock.unlock();
+		bool bSucceeded = entry.command();
+		for (auto itr = entry.callbacks.begin(); itr != entry.callbacks.end(); itr++)
+			(*itr)(bSucceeded);
+		lock.lock();
+
+		m_bRunning = false;
+		if (m_queueEntry.empty())
+			m_conditionIdle.notify_all();
+	}
+}
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CONFIGQUEUE_H
+#define CONFIGQUEUE_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// Run configuration commands on a dedicated control thread, post never waits for them.
+// Commands run in the order they were first posted. A command posted while one with the
+// same key is still pending replaces that one in place, so a setting changed faster than
+// the sensor can be written is applied once with the latest value; the callbacks of both
+// are called once it has run, with its result. Commands of different keys must not depend
+// on each other.
+class ConfigQueue
+{
+public:
+	typedef function<bool()> Command; //returns whether it succeeded
+	typedef function<void(bool bSucceeded)> Callback; //called on the control thread
+
+	ConfigQueue();
+	~ConfigQueue(); //runs the pending commands first
+
+	void post(uint32_t key, const Command& command, const Callback& callback);
+	void wait(); //until all commands posted so far have run
+
+	uint64_t getPostedCount();
+	uint64_t getCoalescedCount(); //commands replaced by a later one with the same key
+
+private:
+	struct Entry
+	{
+		uint32_t            key;
+		Command             command;
+		vector<Callback>    callbacks;
+	};
+	void controlThread();
+
+private:
+	mutex                          m_mutex;
+	condition_variable             m_conditionEntry;
+	condition_variable             m_conditionIdle;
+	deque<Entry>                   m_queueEntry; //pending, not started yet
+	thread                         m_threadControl;
+	bool                           m_bRunning; //an entry is being run
+	bool                           m_bStop;
+
+	uint64_t                       m_ulPostedCount;
+	uint64_t                       m_ulCoalescedCount;
+};
+
+#endif // CONFIGQUEUE_H
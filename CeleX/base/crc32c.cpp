@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "crc32c.h"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_SSE42 __attribute__((target("sse4.2")))
+#elif defined(_M_X64)
+#include <nmmintrin.h>
+#include <intrin.h>
+#define CRC32C_SSE42
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78 //reflected
+
+static uint32_t s_table[8][256];
+
+static bool initTable()
+{
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+		for (int j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+		s_table[0][i] = crc;
+	}
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (int j = 1; j < 8; j++)
+			s_table[j][i] = (s_table[j - 1][i] >> 8) ^ s_table[0][s_table[j - 1][i] & 0xFF];
+	}
+	return true;
+}
+
+static uint32_t crc32cTable(const uint8_t* p, size_t size, uint32_t crc)
+{
+	static bool s_bTableReady = initTable();
+	(void)s_bTableReady;
+	while (size >= 8)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		value ^= crc;
+		crc = s_table[7][value & 0xFF] ^ s_table[6][(value >> 8) & 0xFF] ^
+			s_table[5][(value >> 16) & 0xFF] ^ s_table[4][(value >> 24) & 0xFF] ^
+			s_table[3][(value >> 32) & 0xFF] ^ s_table[2][(value >> 40) & 0xFF] ^
+			s_table[1][(value >> 48) & 0xFF] ^ s_table[0][value >> 56];
+		p += 8;
+		size -= 8;
+	}
+	while (size-- > 0)
+		crc = (crc >> 8) ^ s_table[0][(crc ^ *p++) & 0xFF];
+	return crc;
+}
+
+#ifdef CRC32C_SSE42
+CRC32C_SSE42 static uint32_t crc32cSSE42(const uint8_t* p, size_t size, uint32_t crc)
+{
+	uint64_t crc64 = crc;
+	while (size >= 8)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		crc64 = _mm_crc32_u64(crc64, value);
+		p += 8;
+		size -= 8;
+	}
+	crc = uint32_t(crc64);
+	while (size-- > 0)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+
+static bool hasSSE42()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 20)) != 0;
+#else
+	return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+static uint32_t crc32cARM(const uint8_t* p, size_t size, uint32_t crc)
+{
+	while (size >= 8)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		crc = __crc32cd(crc, value);
+		p += 8;
+		size -= 8;
+	}
+	while (size-- > 0)
+		crc = __crc32cb(crc, *p++);
+	return crc;
+}
+#endif
+
+uint32_t crc32c(const void* pData, size_t size, uint32_t crc)
+{
+	const uint8_t* p = (const uint8_t*)pData;
+	crc = ~crc;
+#if defined(__ARM_FEATURE_CRC32)
+	crc = crc32cARM(p, size, crc);
+#else
+#ifdef CRC32C_SSE42
+	static const bool s_bSSE42 = hasSSE42();
+	if (s_bSSE42)
+		return ~crc32cSSE42(p, size, crc);
+#endif
+	crc = crc32cTable(p, size, crc);
+#endif
+	return ~crc;
+}
@@ -0,0 +1,29 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32C (Castagnoli), as used by iSCSI and ext4.
+// Runs on the SSE4.2 crc32 instruction where the CPU has it (8 bytes per instruction,
+// several GB/s) and on the ARMv8 CRC extension when compiled for it, otherwise on a
+// slicing-by-8 table. crc chains calls: crc32c(b, n2, crc32c(a, n1)).
+uint32_t crc32c(const void* pData, size_t size, uint32_t crc = 0);
+
+#endif // CRC32C_H
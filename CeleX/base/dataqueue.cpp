@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "dataqueue.h"
+#include <chrono>
+
+DataQueue::DataQueue(uint32_t capacity)
+	: m_uiCapacity(capacity > 0 ? capacity : 1)
+	, m_ulDroppedCount(0)
+	, m_bStopped(false)
+{
+}
+
+DataQueue::~DataQueue()
+{
+	stop();
+}
+
+bool DataQueue::push(const CeleX5::MIPIPacket& packet)
+{
+	bool bDropped = false;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_queuePacket.size() >= m_uiCapacity)
+		{
+			m_queuePacket.pop_front();
+			m_ulDroppedCount++;
+			bDropped = true;
+		}
+		m_queuePacket.push_back(packet);
+	}
+	m_condition.notify_one();
+	return !bDropped;
+}
+
+bool DataQueue::pop(CeleX5::MIPIPacket& packet, uint32_t timeoutMs)
+{
+	unique_lock<mutex> lock(m_mutex);
+	if (!m_condition.wait_for(lock, chrono::milliseconds(timeoutMs),
+		[this] { return m_bStopped || !m_queuePacket.empty(); }))
+	{
+		return false;
+	}
+	if (m_bStopped)
+		return false;
+	packet = m_queuePacket.front();
+	m_queuePacket.pop_front();
+	return true;
+}
+
+void DataQueue::clear()
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_queuePacket.clear();
+}
+
+void DataQueue::stop()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_bStopped = true;
+	}
+	m_condition.notify_all();
+}
+
+void DataQueue::restart()
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_bStopped = false;
+}
+
+uint32_t DataQueue::size()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_queuePacket.size();
+}
+
+uint64_t DataQueue::droppedCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_ulDroppedCount;
+}
@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef DATAQUEUE_H
+#define DATAQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "../include/celex5/celex5.h"
+
+using namespace std;
+
+// Bounded queue of MIPI packets shared by one producer and its consumers.
+// The producer never blocks: when the queue is full the oldest packet is dropped.
+class DataQueue
+{
+public:
+	DataQueue(uint32_t capacity);
+	~DataQueue();
+
+	bool push(const CeleX5::MIPIPacket& packet); //false if a packet had to be dropped
+	bool pop(CeleX5::MIPIPacket& packet, uint32_t timeoutMs);
+	void clear();
+	void stop(); //wake up all waiting consumers, pop fails from now on
+	void restart();
+
+	uint32_t size();
+	uint64_t droppedCount();
+
+private:
+	deque<CeleX5::MIPIPacket>   m_queuePacket;
+	mutex                       m_mutex;
+	condition_variable          m_condition;
+	uint32_t                    m_uiCapacity;
+	uint64_t                    m_ulDroppedCount;
+	bool                        m_bStopped;
+};
+
+#endif // DATAQUEUE_H
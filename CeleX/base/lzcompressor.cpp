@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "lzcompressor.h"
+#include <cstring>
+
+static inline uint32_t read32(const uint8_t* p)
+{
+	uint32_t value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
+
+static inline uint8_t* writeLength(uint8_t* pDst, uint32_t length)
+{
+	while (length >= 255)
+	{
+		*pDst++ = 255;
+		length -= 255;
+	}
+	*pDst++ = length;
+	return pDst;
+}
+
+static inline bool readLength(const uint8_t*& pSrc, const uint8_t* pSrcEnd, uint32_t& length)
+{
+	uint8_t value;
+	do
+	{
+		if (pSrc >= pSrcEnd)
+			return false;
+		value = *pSrc++;
+		length += value;
+	} while (255 == value);
+	return true;
+}
+
+static uint8_t* writeSequence(uint8_t* pDst, const uint8_t* pLiteral, uint32_t literalLength, uint32_t offset, uint32_t matchLength)
+{
+	uint8_t* pToken = pDst++;
+	*pToken = (literalLength < 15 ? literalLength : 15) << 4;
+	if (literalLength >= 15)
+		pDst = writeLength(pDst, literalLength - 15);
+	memcpy(pDst, pLiteral, literalLength);
+	pDst += literalLength;
+	if (0 == matchLength)
+		return pDst;
+
+	*pDst++ = offset & 0xFF;
+	*pDst++ = offset >> 8;
+	matchLength -= LZ_MIN_MATCH;
+	*pToken |= matchLength < 15 ? matchLength : 15;
+	if (matchLength >= 15)
+		pDst = writeLength(pDst, matchLength - 15);
+	return pDst;
+}
+
+LZCompressor::LZCompressor()
+{
+	m_pHashTable = new uint32_t[1 << LZ_HASH_LOG];
+}
+
+LZCompressor::~LZCompressor()
+{
+	if (m_pHashTable)
+	{
+		delete[] m_pHashTable;
+		m_pHashTable = NULL;
+	}
+}
+
+uint32_t LZCompressor::compressBound(uint32_t srcSize)
+{
+	return srcSize + srcSize / 255 + 16;
+}
+
+uint32_t LZCompressor::compress(const uint8_t* pSrc, uint32_t srcSize, uint8_t* pDst)
+{
+	memset(m_pHashTable, 0, sizeof(uint32_t) << LZ_HASH_LOG);
+	uint8_t* pOut = pDst;
+	uint32_t anchor = 0;
+	uint32_t pos = 0;
+	while (pos + LZ_MIN_MATCH <= srcSize)
+	{
+		uint32_t sequence = read32(pSrc + pos);
+		uint32_t hash = hashSequence(sequence);
+		uint32_t ref = m_pHashTable[hash];
+		m_pHashTable[hash] = pos + 1;
+		if (ref == 0 || pos + 1 - ref > LZ_MAX_OFFSET || read32(pSrc + ref - 1) != sequence)
+		{
+			//step faster through data that doesn't compress
+			pos += 1 + ((pos - anchor) >> 6);
+			continue;
+		}
+		ref--;
+		uint32_t matchLength = LZ_MIN_MATCH;
+		while (pos + matchLength < srcSize && pSrc[ref + matchLength] == pSrc[pos + matchLength])
+			matchLength++;
+		pOut = writeSequence(pOut, pSrc + anchor, pos - anchor, pos - ref, matchLength);
+		pos += matchLength;
+		anchor = pos;
+	}
+	pOut = writeSequence(pOut, pSrc + anchor, srcSize - anchor, 0, 0);
+	return pOut - pDst;
+}
+
+bool LZCompressor::decompress(const uint8_t* pSrc, uint32_t srcSize, uint8_t* pDst, uint32_t dstSize)
+{
+	const uint8_t* pSrcEnd = pSrc + srcSize;
+	uint8_t* pOut = pDst;
+	uint8_t* pOutEnd = pDst + dstSize;
+	while (pSrc < pSrcEnd)
+	{
+		uint8_t token = *pSrc++;
+		uint32_t literalLength = token >> 4;
+		if (15 == literalLength && !readLength(pSrc, pSrcEnd, literalLength))
+			return false;
+		if (literalLength > uint32_t(pSrcEnd - pSrc) || literalLength > uint32_t(pOutEnd - pOut))
+			return false;
+		memcpy(pOut, pSrc, literalLength);
+		pSrc += literalLength;
+		pOut += literalLength;
+		if (pSrc == pSrcEnd)
+			break; //the last sequence has no match
+
+		if (pSrcEnd - pSrc < 2)
+			return false;
+		uint32_t offset = pSrc[0] | (pSrc[1] << 8);
+		pSrc += 2;
+		uint32_t matchLength = token & 0x0F;
+		if (15 == matchLength && !readLength(pSrc, pSrcEnd, matchLength))
+			return false;
+		matchLength += LZ_MIN_MATCH;
+		if (0 == offset || offset > uint32_t(pOut - pDst) || matchLength > uint32_t(pOutEnd - pOut))
+			return false;
+		const uint8_t* pMatch = pOut - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(pOut, pMatch, matchLength);
+			pOut += matchLength;
+		}
+		else
+		{
+			//overlapping match repeats the last offset bytes
+			for (uint32_t i = 0; i < matchLength; i++)
+				*pOut++ = *pMatch++;
+		}
+	}
+	return pOut == pOutEnd;
+}
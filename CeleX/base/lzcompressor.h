@@ -0,0 +1,48 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef LZCOMPRESSOR_H
+#define LZCOMPRESSOR_H
+
+#include <stdint.h>
+
+#define LZ_HASH_LOG     14
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_OFFSET   0xFFFF
+
+// Byte-aligned LZ77 block compressor in the spirit of LZ4.
+// Matches are found greedily through a hash of the next four bytes and there is no
+// entropy stage, so decoding is a loop of memcpy and runs at memory speed.
+// Sequence: token (literal length << 4 | match length - 4, 15 = continued in the
+// following bytes, 255 per byte), literals, offset (2 bytes), match length bytes.
+// The last sequence has literals only.
+class LZCompressor
+{
+public:
+	LZCompressor();
+	~LZCompressor();
+
+	static uint32_t compressBound(uint32_t srcSize);
+	//pDst must hold compressBound(srcSize) bytes, returns the compressed size
+	uint32_t compress(const uint8_t* pSrc, uint32_t srcSize, uint8_t* pDst);
+	//fails unless pSrc decodes to exactly dstSize bytes
+	static bool decompress(const uint8_t* pSrc, uint32_t srcSize, uint8_t* pDst, uint32_t dstSize);
+
+private:
+	uint32_t*     m_pHashTable; //position + 1 of the last sequence with the hash, 0: none
+};
+
+#endif // LZCOMPRESSOR_H
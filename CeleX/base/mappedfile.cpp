@@ -0,0 +1,133 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "mappedfile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+	: m_pData(NULL)
+	, m_ulSize(0)
+#ifdef _WIN32
+	, m_hFile(INVALID_HANDLE_VALUE)
+	, m_hMapping(NULL)
+#else
+	, m_iFile(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// bSequential: the file will mostly be read front to back, read ahead aggressively
+bool MappedFile::open(const string& filePath, bool bSequential)
+{
+	close();
+#ifdef _WIN32
+	m_hFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		bSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (INVALID_HANDLE_VALUE == m_hFile)
+	{
+		cout << "MappedFile::open: can't open " << filePath << endl;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_hFile, &fileSize) || 0 == fileSize.QuadPart)
+	{
+		close();
+		return false;
+	}
+	m_ulSize = fileSize.QuadPart;
+	m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_hMapping)
+		m_pData = (const uint8_t*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	m_iFile = ::open(filePath.c_str(), O_RDONLY);
+	if (m_iFile < 0)
+	{
+		cout << "MappedFile::open: can't open " << filePath << endl;
+		return false;
+	}
+	struct stat fileStat;
+	if (fstat(m_iFile, &fileStat) != 0 || 0 == fileStat.st_size)
+	{
+		close();
+		return false;
+	}
+	m_ulSize = fileStat.st_size;
+	void* pData = mmap(NULL, m_ulSize, PROT_READ, MAP_SHARED, m_iFile, 0);
+	if (pData != MAP_FAILED)
+	{
+		m_pData = (const uint8_t*)pData;
+		madvise(pData, m_ulSize, bSequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	}
+#endif
+	if (NULL == m_pData)
+	{
+		cout << "MappedFile::open: can't map " << filePath << endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (INVALID_HANDLE_VALUE != m_hFile)
+		CloseHandle(m_hFile);
+	m_hMapping = NULL;
+	m_hFile = INVALID_HANDLE_VALUE;
+#else
+	if (m_pData)
+		munmap((void*)m_pData, m_ulSize);
+	if (m_iFile >= 0)
+		::close(m_iFile);
+	m_iFile = -1;
+#endif
+	m_pData = NULL;
+	m_ulSize = 0;
+}
+
+bool MappedFile::isOpened()
+{
+	return NULL != m_pData;
+}
+
+const uint8_t* MappedFile::data()
+{
+	return m_pData;
+}
+
+uint64_t MappedFile::size()
+{
+	return m_ulSize;
+}
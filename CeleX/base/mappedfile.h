@@ -0,0 +1,51 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+// Read-only memory mapping of a whole file.
+// The mapped data may be read from any number of threads until close.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const string& filePath, bool bSequential);
+	void close();
+	bool isOpened();
+
+	const uint8_t* data();
+	uint64_t size();
+
+private:
+	const uint8_t*                 m_pData;
+	uint64_t                       m_ulSize;
+#ifdef _WIN32
+	void*                          m_hFile;
+	void*                          m_hMapping;
+#else
+	int                            m_iFile;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,395 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#include "celex5cfgprofile.h"
+#include "hhsequencemgr.h"
+#include "hhwireincommand.h"
+#include "../base/crc32c.h"
+#include "../base/xbase.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <iterator>
+#include <sys/stat.h>
+
+//file names are relative to the application directory, as for HHXmlReader::parse
+static string getApplicationFilePath(const string& fileName)
+{
+	XBase base;
+	string filePath = base.getApplicationDirPath();
+#ifdef _WIN32
+	filePath += "\\";
+#endif
+	filePath += fileName;
+	return filePath;
+}
+
+static bool isFileExisting(const string& fileName)
+{
+	struct stat fileStat;
+	return 0 == stat(getApplicationFilePath(fileName).c_str(), &fileStat);
+}
+
+static bool getFileChecksum(const string& fileName, uint64_t &size, uint32_t &checksum)
+{
+	ifstream file(getApplicationFilePath(fileName).c_str(), ios::in | ios::binary);
+	if (!file.is_open())
+		return false;
+	vector<char> vecData((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	if (file.bad())
+		return false;
+	size = vecData.size();
+	checksum = crc32c(vecData.data(), vecData.size());
+	return true;
+}
+
+static uint32_t appendString(vector<char> &vecString, const string& str)
+{
+	uint32_t offset = vecString.size();
+	vecString.insert(vecString.end(), str.begin(), str.end());
+	vecString.push_back('\0');
+	return offset;
+}
+
+static uint32_t profileChecksum(const uint8_t* pData, uint64_t size)
+{
+	CfgProfileHeader header = *(const CfgProfileHeader*)pData;
+	header.checksum = 0;
+	return crc32c(pData + sizeof(header), size - sizeof(header), crc32c(&header, sizeof(header)));
+}
+
+CeleX5CfgProfile::CeleX5CfgProfile()
+	: m_pHeader(NULL)
+	, m_pGroups(NULL)
+	, m_pEntries(NULL)
+	, m_pHashSlots(NULL)
+	, m_pStrings(NULL)
+{
+}
+
+CeleX5CfgProfile::~CeleX5CfgProfile()
+{
+	close();
+}
+
+bool CeleX5CfgProfile::compile(const string& xmlPath, vector<uint8_t>& vecImage)
+{
+	uint64_t sourceSize = 0;
+	uint32_t sourceChecksum = 0;
+	if (!getFileChecksum(xmlPath, sourceSize, sourceChecksum))
+	{
+		cout << "CeleX5CfgProfile::compile: can't find " << xmlPath << endl;
+		return false;
+	}
+	HHSequenceMgr sequenceMgr;
+	if (!sequenceMgr.parseCeleX5Cfg(xmlPath))
+	{
+		cout << "CeleX5CfgProfile::compile: can't parse " << xmlPath << endl;
+		return false;
+	}
+	//the map keeps the groups sorted by name, as the profile wants them
+	map<string, vector<HHCommandBase*>> mapCfg = sequenceMgr.getCeleX5Cfg();
+
+	vector<CfgProfileGroup> vecGroup;
+	vector<CfgProfileEntry> vecEntry;
+	vector<char> vecString;
+	for (auto itr = mapCfg.begin(); itr != mapCfg.end(); itr++)
+	{
+		CfgProfileGroup group;
+		memset(&group, 0, sizeof(group));
+		group.nameOffset = appendString(vecString, itr->first);
+		group.firstEntry = vecEntry.size();
+		group.entryCount = itr->second.size();
+		vecGroup.push_back(group);
+		for (auto itr1 = itr->second.begin(); itr1 != itr->second.end(); itr1++)
+		{
+			HHCommandBase* pCommand = *itr1;
+			WireinCommandEx* pCmd = (WireinCommandEx*)pCommand;
+			CfgProfileEntry entry;
+			memset(&entry, 0, sizeof(entry));
+			entry.nameOffset = appendString(vecString, pCmd->name());
+			entry.min = pCmd->minValue();
+			entry.max = pCmd->maxValue();
+			entry.value = pCmd->value();
+			entry.highAddr = pCmd->highAddr();
+			entry.middleAddr = pCmd->middleAddr();
+			entry.lowAddr = pCmd->lowAddr();
+			vecEntry.push_back(entry);
+			delete pCommand; //not owned by HHSequenceMgr
+		}
+	}
+	vecString.resize((vecString.size() + 7) & ~(size_t)7, '\0');
+
+	//at most half full, so a probe stays short and always ends at an empty slot
+	uint32_t hashSize = 8;
+	while (hashSize < 2 * vecEntry.size())
+		hashSize *= 2;
+	vector<CfgProfileHashSlot> vecHashSlot(hashSize);
+	memset(vecHashSlot.data(), 0, hashSize * sizeof(CfgProfileHashSlot));
+	for (uint32_t i = 0; i < vecEntry.size(); i++)
+	{
+		uint32_t hash = cfgProfileHash(&vecString[vecEntry[i].nameOffset]);
+		uint32_t slot = hash & (hashSize - 1);
+		while (vecHashSlot[slot].entry != 0)
+			slot = (slot + 1) & (hashSize - 1);
+		vecHashSlot[slot].hash = hash;
+		vecHashSlot[slot].entry = i + 1;
+	}
+
+	CfgProfileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CFG_PROFILE_MAGIC, sizeof(CFG_PROFILE_MAGIC));
+	header.version = CFG_PROFILE_VERSION;
+	header.groupCount = vecGroup.size();
+	header.entryCount = vecEntry.size();
+	header.stringSize = vecString.size();
+	header.hashSize = hashSize;
+	header.sourceSize = sourceSize;
+	header.sourceChecksum = sourceChecksum;
+
+	size_t groupSize = vecGroup.size() * sizeof(CfgProfileGroup);
+	size_t entrySize = vecEntry.size() * sizeof(CfgProfileEntry);
+	size_t hashTableSize = vecHashSlot.size() * sizeof(CfgProfileHashSlot);
+	vecImage.resize(sizeof(header) + groupSize + entrySize + hashTableSize + vecString.size());
+	uint8_t* pData = vecImage.data();
+	memcpy(pData, &header, sizeof(header));
+	pData += sizeof(header);
+	if (groupSize > 0)
+		memcpy(pData, vecGroup.data(), groupSize);
+	pData += groupSize;
+	if (entrySize > 0)
+		memcpy(pData, vecEntry.data(), entrySize);
+	pData += entrySize;
+	memcpy(pData, vecHashSlot.data(), hashTableSize);
+	pData += hashTableSize;
+	if (!vecString.empty())
+		memcpy(pData, vecString.data(), vecString.size());
+	((CfgProfileHeader*)vecImage.data())->checksum = profileChecksum(vecImage.data(), vecImage.size());
+	return true;
+}
+
+// The profile is written under a temporary name and renamed, so a process opening it
+// meanwhile sees either the old profile or the new one
+bool CeleX5CfgProfile::compileFile(const string& xmlPath, const string& profilePath)
+{
+	vector<uint8_t> vecImage;
+	return compile(xmlPath, vecImage) && saveImage(vecImage, profilePath);
+}
+
+bool CeleX5CfgProfile::saveImage(const vector<uint8_t>& vecImage, const string& profileName)
+{
+	string profilePath = getApplicationFilePath(profileName);
+	string tempPath = profilePath + ".tmp";
+	ofstream file(tempPath.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "CeleX5CfgProfile::saveImage: can't create " << tempPath << endl;
+		return false;
+	}
+	file.write((const char*)vecImage.data(), vecImage.size());
+	file.close();
+	if (!file.good())
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	remove(profilePath.c_str()); //rename doesn't replace a file on Windows
+#endif
+	if (rename(tempPath.c_str(), profilePath.c_str()) != 0)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool CeleX5CfgProfile::load(const string& xmlPath, const string& profilePath)
+{
+	if (isFileExisting(profilePath) && open(profilePath))
+	{
+		if (isUpToDate(xmlPath))
+			return true;
+		cout << "CeleX5CfgProfile::load: " << xmlPath << " has changed, compiling it" << endl;
+		close();
+	}
+	vector<uint8_t> vecImage;
+	if (!compile(xmlPath, vecImage))
+		return false;
+	if (saveImage(vecImage, profilePath) && open(profilePath))
+		return true;
+
+	//e.g. a read-only directory: use the compiled profile without saving it
+	close();
+	m_vecImage.swap(vecImage);
+	return setData(m_vecImage.data(), m_vecImage.size());
+}
+
+bool CeleX5CfgProfile::open(const string& profilePath)
+{
+	close();
+	if (!m_mappedFile.open(getApplicationFilePath(profilePath), false))
+		return false;
+	if (!setData(m_mappedFile.data(), m_mappedFile.size()))
+	{
+		cout << "CeleX5CfgProfile::open: " << profilePath << " isn't a valid profile" << endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void CeleX5CfgProfile::close()
+{
+	m_mappedFile.close();
+	vector<uint8_t>().swap(m_vecImage);
+	m_pHeader = NULL;
+	m_pGroups = NULL;
+	m_pEntries = NULL;
+	m_pHashSlots = NULL;
+	m_pStrings = NULL;
+}
+
+bool CeleX5CfgProfile::isOpened()
+{
+	return NULL != m_pHeader;
+}
+
+// A profile without the XML next to it is up to date: it is all there is
+bool CeleX5CfgProfile::isUpToDate(const string& xmlPath)
+{
+	if (NULL == m_pHeader)
+		return false;
+	uint64_t size = 0;
+	uint32_t checksum = 0;
+	if (!getFileChecksum(xmlPath, size, checksum))
+		return true;
+	return m_pHeader->sourceSize == size && m_pHeader->sourceChecksum == checksum;
+}
+
+uint32_t CeleX5CfgProfile::getGroupCount()
+{
+	return m_pHeader ? m_pHeader->groupCount : 0;
+}
+
+const CfgProfileGroup* CeleX5CfgProfile::getGroup(uint32_t index)
+{
+	if (NULL == m_pHeader || index >= m_pHeader->groupCount)
+		return NULL;
+	return m_pGroups + index;
+}
+
+const CfgProfileGroup* CeleX5CfgProfile::findGroup(const char* name)
+{
+	if (NULL == m_pHeader)
+		return NULL;
+	uint32_t first = 0;
+	uint32_t last = m_pHeader->groupCount;
+	while (first < last)
+	{
+		uint32_t middle = first + (last - first) / 2;
+		int result = strcmp(m_pStrings + m_pGroups[middle].nameOffset, name);
+		if (0 == result)
+			return m_pGroups + middle;
+		if (result < 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return NULL;
+}
+
+const CfgProfileEntry* CeleX5CfgProfile::getEntries(const CfgProfileGroup* pGroup)
+{
+	return m_pEntries + pGroup->firstEntry;
+}
+
+const CfgProfileEntry* CeleX5CfgProfile::findEntry(const CfgProfileGroup* pGroup, const char* name)
+{
+	uint32_t hash = cfgProfileHash(name);
+	uint32_t mask = m_pHeader->hashSize - 1;
+	for (uint32_t slot = hash & mask; m_pHashSlots[slot].entry != 0; slot = (slot + 1) & mask)
+	{
+		if (m_pHashSlots[slot].hash != hash)
+			continue;
+		uint32_t entry = m_pHashSlots[slot].entry - 1;
+		if (entry >= pGroup->firstEntry && entry - pGroup->firstEntry < pGroup->entryCount &&
+			0 == strcmp(m_pStrings + m_pEntries[entry].nameOffset, name))
+			return m_pEntries + entry;
+	}
+	return NULL;
+}
+
+const char* CeleX5CfgProfile::getName(uint32_t nameOffset)
+{
+	return m_pStrings + nameOffset;
+}
+
+// Every offset is checked once here, so the accessors can trust the profile
+bool CeleX5CfgProfile::setData(const uint8_t* pData, uint64_t size)
+{
+	if (NULL == pData || size < sizeof(CfgProfileHeader))
+		return false;
+	const CfgProfileHeader* pHeader = (const CfgProfileHeader*)pData;
+	if (memcmp(pHeader->magic, CFG_PROFILE_MAGIC, sizeof(CFG_PROFILE_MAGIC)) != 0 ||
+		pHeader->version != CFG_PROFILE_VERSION)
+		return false;
+	uint64_t expectedSize = sizeof(CfgProfileHeader) +
+		(uint64_t)pHeader->groupCount * sizeof(CfgProfileGroup) +
+		(uint64_t)pHeader->entryCount * sizeof(CfgProfileEntry) +
+		(uint64_t)pHeader->hashSize * sizeof(CfgProfileHashSlot) + pHeader->stringSize;
+	if (expectedSize != size || 0 == pHeader->stringSize)
+		return false;
+	//a power of 2 with an empty slot left, so every probe ends
+	if (pHeader->hashSize <= pHeader->entryCount || (pHeader->hashSize & (pHeader->hashSize - 1)) != 0)
+		return false;
+	if (pHeader->checksum != profileChecksum(pData, size))
+		return false;
+
+	const CfgProfileGroup* pGroups = (const CfgProfileGroup*)(pHeader + 1);
+	const CfgProfileEntry* pEntries = (const CfgProfileEntry*)(pGroups + pHeader->groupCount);
+	const CfgProfileHashSlot* pHashSlots = (const CfgProfileHashSlot*)(pEntries + pHeader->entryCount);
+	const char* pStrings = (const char*)(pHashSlots + pHeader->hashSize);
+	if (pStrings[pHeader->stringSize - 1] != '\0')
+		return false;
+	for (uint32_t i = 0; i < pHeader->groupCount; i++)
+	{
+		if (pGroups[i].nameOffset >= pHeader->stringSize ||
+			pGroups[i].firstEntry > pHeader->entryCount ||
+			pGroups[i].entryCount > pHeader->entryCount - pGroups[i].firstEntry)
+			return false;
+		if (i > 0 && strcmp(pStrings + pGroups[i - 1].nameOffset, pStrings + pGroups[i].nameOffset) >= 0)
+			return false;
+	}
+	for (uint32_t i = 0; i < pHeader->entryCount; i++)
+	{
+		if (pEntries[i].nameOffset >= pHeader->stringSize)
+			return false;
+	}
+	for (uint32_t i = 0; i < pHeader->hashSize; i++)
+	{
+		if (pHashSlots[i].entry > pHeader->entryCount)
+			return false;
+	}
+	m_pHeader = pHeader;
+	m_pGroups = pGroups;
+	m_pEntries = pEntries;
+	m_pHashSlots = pHashSlots;
+	m_pStrings = pStrings;
+	return true;
+}
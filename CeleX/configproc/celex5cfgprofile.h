@@ -0,0 +1,72 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#ifndef CELEX5CFGPROFILE_H
+#define CELEX5CFGPROFILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "cfgprofileformat.h"
+#include "../base/mappedfile.h"
+
+using namespace std;
+
+// The CSR defaults of CeleX5_Commands.xml as a compiled profile, see cfgprofileformat.h.
+// Opening a profile maps the file and checks it, nothing is parsed or allocated: groups
+// and entries are handed out as pointers into the mapping, valid until close.
+// load compiles the XML first when the profile is missing or older than the XML.
+// File names are relative to the application directory, where the XML is looked up.
+class CeleX5CfgProfile
+{
+public:
+	CeleX5CfgProfile();
+	~CeleX5CfgProfile();
+
+	static bool compile(const string& xmlPath, vector<uint8_t>& vecImage);
+	static bool compileFile(const string& xmlPath, const string& profilePath);
+
+	//the profile if it is up to date, else the XML compiled (and saved as the profile)
+	bool load(const string& xmlPath, const string& profilePath);
+	bool open(const string& profilePath);
+	void close();
+	bool isOpened();
+	//false if the profile wasn't compiled from the XML as it is now
+	bool isUpToDate(const string& xmlPath);
+
+	uint32_t getGroupCount();
+	const CfgProfileGroup* getGroup(uint32_t index);
+	const CfgProfileGroup* findGroup(const char* name); //NULL if there is no such group
+	const CfgProfileEntry* getEntries(const CfgProfileGroup* pGroup); //pGroup->entryCount entries
+	const CfgProfileEntry* findEntry(const CfgProfileGroup* pGroup, const char* name); //hashed
+	const char* getName(uint32_t nameOffset);
+
+private:
+	static bool saveImage(const vector<uint8_t>& vecImage, const string& profileName);
+	bool setData(const uint8_t* pData, uint64_t size);
+
+private:
+	MappedFile                     m_mappedFile;
+	vector<uint8_t>                m_vecImage; //a profile compiled but not saved
+	const CfgProfileHeader*        m_pHeader;
+	const CfgProfileGroup*         m_pGroups;
+	const CfgProfileEntry*         m_pEntries;
+	const CfgProfileHashSlot*      m_pHashSlots;
+	const char*                    m_pStrings;
+};
+
+#endif // CELEX5CFGPROFILE_H
@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#ifndef CFGPROFILEFORMAT_H
+#define CFGPROFILEFORMAT_H
+
+#include <stdint.h>
+
+// Layout of a compiled CeleX5 register profile (all fields little endian):
+//   CfgProfileHeader
+//   groupCount CfgProfileGroup, sorted by name (strcmp order)
+//   entryCount CfgProfileEntry, the entries of a group are consecutive, in XML order
+//   hashSize CfgProfileHashSlot, an open addressing hash table of the entries by name
+//   stringSize bytes of NUL terminated names, referenced by offset
+// The profile is compiled from CeleX5_Commands.xml, which stays the source to edit; the
+// size and CRC-32C of the XML are kept to tell when it has to be recompiled.
+// (a modification time has a resolution of 1 s and misses an edit in the same second)
+// Everything is fixed size and 8 byte aligned, so a mapped profile is used in place.
+
+#define CFG_PROFILE_MAGIC       "CX5CFG"
+#define CFG_PROFILE_VERSION     3
+
+typedef struct CfgProfileHeader
+{
+	char        magic[8];
+	uint32_t    version;
+	uint32_t    checksum; //CRC-32C of the whole profile, with checksum 0
+	uint32_t    groupCount;
+	uint32_t    entryCount;
+	uint32_t    stringSize;
+	uint32_t    hashSize; //a power of 2, larger than entryCount
+	uint64_t    sourceSize; //of the XML compiled
+	uint32_t    sourceChecksum; //CRC-32C of the XML compiled
+	uint32_t    reserved;
+} CfgProfileHeader;
+
+typedef struct CfgProfileGroup
+{
+	uint32_t    nameOffset;
+	uint32_t    firstEntry;
+	uint32_t    entryCount;
+	uint32_t    reserved;
+} CfgProfileGroup;
+
+// A CSR, the fields of CeleX5::CfgInfo; -1: no such register
+typedef struct CfgProfileEntry
+{
+	uint32_t    nameOffset;
+	uint32_t    min;
+	uint32_t    max;
+	uint32_t    value;
+	uint32_t    step;
+	int16_t     highAddr;
+	int16_t     middleAddr;
+	int16_t     lowAddr;
+	int16_t     reserved;
+	uint32_t    reserved2;
+} CfgProfileEntry;
+
+// Slot of the entry hash table: entries are hashed by name with cfgProfileHash and found
+// by linear probing from slot (hash & (hashSize - 1)) up to the first empty slot
+typedef struct CfgProfileHashSlot
+{
+	uint32_t    hash;
+	uint32_t    entry; //index of the entry + 1, 0: empty slot
+} CfgProfileHashSlot;
+
+//FNV-1a
+inline uint32_t cfgProfileHash(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	for (; *name != '\0'; name++)
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+	return hash;
+}
+
+#endif // CFGPROFILEFORMAT_H
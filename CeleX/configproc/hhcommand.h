@@ -26,7 +26,7 @@ class HHCommandBase
 {
 public:
     HHCommandBase(const std::string& name);
-    ~HHCommandBase();
+    virtual ~HHCommandBase();
 
     std::string name();
 
@@ -227,7 +227,7 @@ bool HHSequenceMgr::parseCeleX5Cfg(const std::string fileName)
 	return false;
 }
 
-bool HHSequenceMgr::saveCeleX5XML(map<string, vector<CeleX5::CfgInfo>> mapCfgInfo)
+bool HHSequenceMgr::saveCeleX5XML(const map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 {
 	HHXmlReader xml;
 	return xml.saveXML(mapCfgInfo);
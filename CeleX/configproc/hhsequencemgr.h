@@ -93,7 +93,7 @@ public:
 
     //--- for CeleX5 ---
     bool parseCeleX5Cfg(const std::string fileName);
-    bool saveCeleX5XML(map<string, vector<CeleX5::CfgInfo>> mapCfgInfo);
+    bool saveCeleX5XML(const map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo);
 	map<string, vector<HHCommandBase*>> getCeleX5Cfg();
 
 private:
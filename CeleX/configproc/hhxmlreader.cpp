@@ -22,6 +22,7 @@
 #include "tinyxml/tinyxml.h"
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 HHXmlReader::HHXmlReader()
 {
@@ -386,29 +387,13 @@ bool HHXmlReader::save(const std::string& filename, TiXmlDocument* pDom)
 	return true;
 }
 
-CeleX5::CfgInfo HHXmlReader::getCfgInfoByName(string csrType, string name, map<string, vector<CeleX5::CfgInfo>>& mapCfg)
+// Index the CSRs of a group by name, pointing into the group instead of copying it
+void HHXmlReader::indexCfgInfo(const vector<CeleX5::CfgInfo>& vecCfg, unordered_map<string, const CeleX5::CfgInfo*>& mapIndex)
 {
-	CeleX5::CfgInfo cfgInfo;
-	for (auto itr = mapCfg.begin(); itr != mapCfg.end(); itr++)
-	{
-		string tapName = itr->first;
-		if (csrType == tapName)
-		{
-			vector<CeleX5::CfgInfo> vecCfg = itr->second;
-			int index = 0;
-			for (auto itr1 = vecCfg.begin(); itr1 != vecCfg.end(); itr1++)
-			{
-				if ((*itr1).name == name)
-				{
-					cfgInfo = (*itr1);
-					return cfgInfo;
-				}
-				index++;
-			}
-			break;
-		}
-	}
-	return cfgInfo;
+	mapIndex.clear();
+	mapIndex.reserve(vecCfg.size());
+	for (auto itr = vecCfg.begin(); itr != vecCfg.end(); itr++)
+		mapIndex[itr->name] = &(*itr);
 }
 
 bool HHXmlReader::importCommands_CeleX5(map<string, vector<HHCommandBase*>> &commandList, TiXmlDocument *pDom)
@@ -473,7 +458,7 @@ bool HHXmlReader::importCommands_CeleX5(map<string, vector<HHCommandBase*>> &com
 	return true;
 }
 
-bool HHXmlReader::saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
+bool HHXmlReader::saveXML(const map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 {
 	TiXmlDocument*  pDom = new TiXmlDocument;
 	if (parse(FILE_CELEX5_CFG_NEW, pDom))
@@ -499,6 +484,11 @@ bool HHXmlReader::saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 				cout << "-----" << pEle->Value() << "has no children!" << endl;
 				continue;
 			}
+			auto itrGroup = mapCfgInfo.find(csrType);
+			if (itrGroup == mapCfgInfo.end())
+				continue;
+			unordered_map<string, const CeleX5::CfgInfo*> mapIndex;
+			indexCfgInfo(itrGroup->second, mapIndex);
 			for (TiXmlElement* pChildEle = pEle->FirstChildElement();
 				NULL != pChildEle;
 				pChildEle = pChildEle->NextSiblingElement())
@@ -507,6 +497,10 @@ bool HHXmlReader::saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 				if ("PXL_BUF_TRIM" == strCSRName)
 					continue;
 				//cout << "----- CSR Name = " << strCSRName << endl;
+				auto itrCfg = mapIndex.find(strCSRName);
+				if (itrCfg == mapIndex.end())
+					continue;
+				const CeleX5::CfgInfo* pCfgInfo = itrCfg->second;
 				TiXmlNode* pNode = pChildEle->FirstChild();
 				while (NULL != pNode)
 				{
@@ -514,19 +508,17 @@ bool HHXmlReader::saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 					string value = pNode->FirstChild()->Value();
 					if ("value_high" == tagName)
 					{
-						CeleX5::CfgInfo cfgInfo = getCfgInfoByName(csrType, strCSRName, mapCfgInfo);
-						//cout << csrType << ", " << strCSRName << endl;
 						int valueH = 0;
-						if (cfgInfo.low_addr == -1)
+						if (pCfgInfo->low_addr == -1)
 						{
-							valueH = cfgInfo.value;
+							valueH = pCfgInfo->value;
 						}
 						else
 						{
-							if (cfgInfo.middle_addr == -1) //no middle register
-								valueH = cfgInfo.value >> 8;
+							if (pCfgInfo->middle_addr == -1) //no middle register
+								valueH = pCfgInfo->value >> 8;
 							else
-								valueH = cfgInfo.value >> 16;
+								valueH = pCfgInfo->value >> 16;
 						}
 						std::stringstream ss;
 						ss << valueH;
@@ -536,9 +528,7 @@ bool HHXmlReader::saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 					}
 					else if ("value_middle" == tagName)
 					{
-						CeleX5::CfgInfo cfgInfo = getCfgInfoByName(csrType, strCSRName, mapCfgInfo);
-						//cout << csrType << ", " << strCSRName << endl;
-						uint32_t valueM = (0xFF00 & cfgInfo.value) >> 8;
+						uint32_t valueM = (0xFF00 & pCfgInfo->value) >> 8;
 						std::stringstream ss;
 						ss << valueM;
 						string str = ss.str();
@@ -547,9 +537,7 @@ bool HHXmlReader::saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo)
 					}
 					else if ("value_low" == tagName)
 					{
-						CeleX5::CfgInfo cfgInfo = getCfgInfoByName(csrType, strCSRName, mapCfgInfo);
-						//cout << csrType << ", " << strCSRName << endl;
-						uint32_t valueL = 0xFF & cfgInfo.value;
+						uint32_t valueL = 0xFF & pCfgInfo->value;
 						std::stringstream ss;
 						ss << valueL;
 						string str = ss.str();
@@ -22,6 +22,7 @@
 #include <string>
 #include <stdint.h>
 #include <map>
+#include <unordered_map>
 
 #include "../include/celex5/celex5.h"
 
@@ -45,11 +46,11 @@ public:
     bool save(const std::string& filename, TiXmlDocument* pDom);
     bool importCommands_CeleX5(std::map<std::string, std::vector<HHCommandBase*>>& commandList, TiXmlDocument* pDom);
 
-    bool saveXML(map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo);
+    bool saveXML(const map<string, vector<CeleX5::CfgInfo>>& mapCfgInfo);
 
  private:
     bool getNumber(const std::string& text, uint32_t* pNumber);
-    CeleX5::CfgInfo getCfgInfoByName(string csrType, string name, map<string, vector<CeleX5::CfgInfo>>& mapCfg);
+    void indexCfgInfo(const vector<CeleX5::CfgInfo>& vecCfg, unordered_map<string, const CeleX5::CfgInfo*>& mapIndex);
 };
 
 #endif // HHXMLREADER_H
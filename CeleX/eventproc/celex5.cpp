@@ -17,29 +17,85 @@
 #include "../include/celex5/celex5.h"
 #include "../frontpanel/frontpanel.h"
 #include "../driver/CeleDriver.h"
-#include "../configproc/hhsequencemgr.h"
-#include "../configproc/hhwireincommand.h"
+#include "../configproc/celex5cfgprofile.h"
 #include "../base/xbase.h"
+#include "../record/shardedrecorder.h"
+#include "../record/shardedplayer.h"
+#include "../record/ringrecorder.h"
+#include "../base/configqueue.h"
+#include "registercache.h"
+#include "celex5registers.h"
 #include <cstring>
+#include <chrono>
+#include <algorithm>
+
+// clock rate (MHz), PLL_DIV_N, PLL_DIV_L, PLL_FOUT_DIV1, PLL_FOUT_DIV2, MIPI_PLL_DIV_I, MIPI_PLL_DIV_N
+// 110 ~ 160 MHz: { 110, 22, 3, 0, 3, 2, 195 }, { 120, 18, 2, 0, 3, 2, 180 }, { 130, 26, 3, 0, 3, 2, 165 },
+//                { 140, 21, 2, 0, 3, 2, 153 }, { 150, 30, 3, 0, 3, 2, 144 }, { 160, 24, 2, 0, 3, 1, 180 }
+static const CeleX5::ClockSetting s_arrayDefaultClockTable[] = {
+	{ 20, 12, 2, 3, 3, 3, 180 },
+	{ 30, 18, 3, 2, 2, 2, 180 },
+	{ 40, 12, 2, 1, 3, 3, 180 },
+	{ 50, 15, 2, 1, 3, 3, 144 },
+	{ 60, 18, 2, 1, 3, 2, 180 },
+	{ 70, 21, 2, 1, 3, 2, 153 },
+	{ 80, 12, 2, 0, 3, 3, 180 },
+	{ 90, 18, 3, 0, 2, 2, 180 },
+	{ 100, 15, 2, 0, 3, 3, 144 },
+};
 
 CeleX5::CeleX5() 
-	: m_bLoopModeEnabled(false)
+	: m_pCeleDriver(NULL)
 	, m_emSensorFixedMode(CeleX5::Event_Address_Only_Mode)
 	, m_emSensorLoopMode{ CeleX5::Full_Picture_Mode, CeleX5::Event_Address_Only_Mode, CeleX5::Full_Optical_Flow_S_Mode }
+	, m_uiContrast(2)
+	, m_uiBrightness(140)
+	, m_uiThreshold(171)
 	, m_uiClockRate(100)
-	, m_pCeleDriver(NULL)
+	, m_bLoopModeEnabled(false)
 	, m_bAutoISPEnabled(false)
 	, m_arrayISPThreshold{60, 500, 2500}
 	, m_arrayBrightness{100, 130, 150, 175}
 	, m_uiAutoISPRefreshTime(80)
+	, m_bRegisterCacheEnabled(true)
+	, m_ulRegisterWriteCount(0)
+	, m_ulElidedRegisterWriteCount(0)
+	, m_ulFailedRegisterWriteCount(0)
+	, m_uiRegisterBatchDepth(0)
+	, m_bBringUpSequenceChanged(true)
+	, m_bModeConfigApplied(false)
+	, m_bApplyingModeConfig(false)
+	, m_bPlaybackSensorStateValid(false)
+	, m_ulPacketSequence(0)
+	, m_uiConfigVersion(0)
+	, m_ulClockRetuneStart(0)
+	, m_bClockSettling(false)
 {
-	m_pSequenceMgr = new HHSequenceMgr;
-	m_pSequenceMgr->parseCeleX5Cfg(FILE_CELEX5_CFG);
-	m_mapCfgDefaults = getCeleX5Cfg();
+	m_pCfgProfile = new CeleX5CfgProfile;
+	if (!m_pCfgProfile->load(FILE_CELEX5_CFG, FILE_CELEX5_CFG_PROFILE))
+		cout << "CeleX5::CeleX5: can't load the CSR defaults from " << FILE_CELEX5_CFG << endl;
+	m_uiEventPacketFormat = getCfgDefault("Sensor_Data_Transfer_Parameters", "EVENT_PACKET_SELECT", 2);
+	m_pRecorder = new ShardedRecorder;
+	m_pPlayer = new ShardedPlayer;
+	m_pRingRecorder = new RingRecorder;
+	m_pRegisterCache = new RegisterCache;
+	m_pConfigQueue = new ConfigQueue;
+	buildModeConfigs();
+	memset(&m_lastModeSwitch, 0, sizeof(m_lastModeSwitch));
+	memset(&m_lastClockRetune, 0, sizeof(m_lastClockRetune));
+	memset(&m_playbackSensorState, 0, sizeof(m_playbackSensorState));
+	m_vecClockTable.assign(s_arrayDefaultClockTable, s_arrayDefaultClockTable +
+		sizeof(s_arrayDefaultClockTable) / sizeof(s_arrayDefaultClockTable[0]));
 }
 
 CeleX5::~CeleX5()
 {
+	//the pending settings are applied while the sensor is still open
+	if (m_pConfigQueue)
+	{
+		delete m_pConfigQueue;
+		m_pConfigQueue = NULL;
+	}
 	if (m_pCeleDriver)
 	{
 		m_pCeleDriver->clearData();
@@ -47,21 +103,49 @@ CeleX5::~CeleX5()
 		delete m_pCeleDriver;
 		m_pCeleDriver = NULL;
 	}
-	if (m_pSequenceMgr)
+	if (m_pCfgProfile)
+	{
+		delete m_pCfgProfile;
+		m_pCfgProfile = NULL;
+	}
+	if (m_pRecorder)
+	{
+		delete m_pRecorder;
+		m_pRecorder = NULL;
+	}
+	if (m_pPlayer)
 	{
-		delete m_pSequenceMgr;
-		m_pSequenceMgr = NULL;
+		delete m_pPlayer;
+		m_pPlayer = NULL;
+	}
+	if (m_pRingRecorder)
+	{
+		delete m_pRingRecorder;
+		m_pRingRecorder = NULL;
+	}
+	if (m_pRegisterCache)
+	{
+		delete m_pRegisterCache;
+		m_pRegisterCache = NULL;
 	}
 }
 
 bool CeleX5::openSensor()
 {
+	//without the CSR defaults the sensor would be brought up with none of its registers set
+	if (!m_pCfgProfile->isOpened())
+	{
+		cout << "CeleX5::openSensor: no CSR defaults, " << FILE_CELEX5_CFG << " couldn't be loaded!" << endl;
+		return false;
+	}
 	if (NULL == m_pCeleDriver)
 	{
 		m_pCeleDriver = new CeleDriver;
 		if (!m_pCeleDriver->openUSB())
 			return false;
 	}
+	m_pRegisterCache->invalidateAll();
+	m_bModeConfigApplied = false;
 	if (!configureSettings())
 		return false;
 	return true;
@@ -69,34 +153,184 @@ bool CeleX5::openSensor()
 
 bool CeleX5::getMIPIData(vector<uint8_t> &buffer)
 {
-	m_pCeleDriver->getimage(buffer);
+	if (m_pPlayer->isOpened())
+	{
+		MIPIPacket packet;
+		if (!getPlaybackPacket(packet))
+			return false;
+		buffer.assign(packet.data, packet.data + packet.size);
+		return true;
+	}
+	uint32_t configVersion = 0;
+	uint64_t sequence = 0;
+	return readSensorData(buffer, configVersion, sequence);
+}
+
+bool CeleX5::getMIPIData(MIPIPacket &packet)
+{
+	if (m_pPlayer->isOpened())
+		return getPlaybackPacket(packet);
+
+	packet.buffer = make_shared<vector<uint8_t>>();
+	if (!readSensorData(*packet.buffer, packet.configVersion, packet.sequence))
+		return false;
+	packet.data = packet.buffer->data();
+	packet.size = packet.buffer->size();
+	packet.mode = CeleX5Mode(0x07 & packet.data[packet.size - 1]);
+	return true;
+}
+
+// The version and the sequence are taken with the data: changeConfigVersion can't drop the
+// buffered data and change the version in between, so the data is always tagged with its
+// version, and a packet read before a mode switch dropped the data gets an earlier sequence
+bool CeleX5::readSensorData(vector<uint8_t> &buffer, uint32_t &configVersion, uint64_t &sequence)
+{
+	{
+		lock_guard<mutex> lock(m_mutexConfigVersion);
+		m_pCeleDriver->getimage(buffer);
+		configVersion = m_uiConfigVersion;
+		if (buffer.size() > 0)
+			sequence = m_ulPacketSequence++;
+	}
 	if (buffer.size() > 0)
 	{
+		if (m_pRecorder->isRecording() || m_pRingRecorder->isEnabled())
+			recordMIPIData(buffer.data(), buffer.size(), sequence);
+		if (m_bClockSettling)
+		{
+			lock_guard<mutex> lock(m_mutexClockRetune);
+			m_lastClockRetune.settleTime = chrono::duration_cast<chrono::microseconds>(
+				chrono::steady_clock::now().time_since_epoch()).count() - m_ulClockRetuneStart;
+			m_lastClockRetune.sequence = sequence;
+			m_bClockSettling = false;
+		}
 		return true;
 	}	
 	return false;
 }
 
+static uint32_t clampFieldValue(const RegisterField& field, uint32_t value)
+{
+	cout << "CeleX5: " << field.name << " = " << value << " is out of range ["
+		<< field.minValue << ", " << field.maxValue << "]" << endl;
+	return field.clamp(value);
+}
+
+// Write a field of the register map, split over its high and low register; inlined, so
+// for a constant value the range check and the split are done by the compiler
+inline void CeleX5::writeField(const RegisterField& field, uint32_t value)
+{
+	if (!field.isInRange(value))
+		value = clampFieldValue(field, value);
+	wireIn(field.highAddr, field.highValue(value), 0xFF);
+	if (field.isSplit())
+		wireIn(field.lowAddr, field.lowValue(value), 0xFF);
+}
+
+// Whether the register cache holds the value of the field; false if it isn't cached
+bool CeleX5::isFieldCached(const RegisterField& field, uint32_t value)
+{
+	uint32_t cachedValue = 0;
+	if (!m_bRegisterCacheEnabled)
+		return false;
+	if (!m_pRegisterCache->lookup(field.highAddr, cachedValue) || cachedValue != field.highValue(value))
+		return false;
+	if (field.isSplit() && (!m_pRegisterCache->lookup(field.lowAddr, cachedValue) || cachedValue != field.lowValue(value)))
+		return false;
+	return true;
+}
+
 // Set the Sensor operation mode in fixed mode
 // address = 53, width = [2:0]
-void CeleX5::setSensorFixedMode(CeleX5Mode mode)
+// Only the delta to the configuration of the current mode is written, see buildModeConfigs,
+// unless the registers of the configuration may have been changed since it was applied.
+// Switching to the current mode does nothing then.
+bool CeleX5::setSensorFixedMode(CeleX5Mode mode)
 {
-	m_pCeleDriver->clearData();
-	//Disable ALS read and write, must be the first operation
-	setALSEnabled(false);
+	if (mode < 0 || mode >= 8)
+	{
+		cout << "CeleX5::setSensorFixedMode: wrong mode!" << endl;
+		return false;
+	}
+	auto tpStart = chrono::steady_clock::now();
+	const vector<RegisterValue>* pWrites = &m_vecModeConfig[mode];
+	if (m_bModeConfigApplied)
+	{
+		pWrites = &m_vecModeDelta[m_emSensorFixedMode][mode];
+		if (pWrites->empty())
+			return true;
+	}
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
 
+	//under auto ISP the CFG mode window keeps ALS disabled while the registers are written
 	enterCFGMode();
-	//Write Fixed Sensor Mode
-	wireIn(53, static_cast<uint32_t>(mode), 0xFF);
-
-	//Disable brightness adjustment (auto isp), always load sensor core parameters from profile0
-	wireIn(221, 0, 0xFF); //AUTOISP_BRT_EN
-	wireIn(223, 0, 0xFF); //AUTOISP_TRIGGER
-	wireIn(220, 0, 0xFF); //AUTOISP_PROFILE_ADDR, Write core parameters to profile0
-	writeRegister(233, -1, 232, 1500); //AUTOISP_BRT_VALUE, Set initial brightness value 1500
-	writeRegister(22, -1, 23, 140); //BIAS_BRT_I, Override the brightness value in profile0, avoid conflict with AUTOISP profile0
+	uint64_t ulWriteCount = m_ulRegisterWriteCount;
+	m_bApplyingModeConfig = true;
+	m_bModeConfigApplied = true; //cleared by wireIn if a write fails
+	for (auto itr = pWrites->begin(); itr != pWrites->end(); itr++)
+		wireIn(itr->address, itr->value, 0xFF);
+	m_bApplyingModeConfig = false;
+	//writes skipped by the register cache don't count
+	ulWriteCount = m_ulRegisterWriteCount - ulWriteCount;
+	//the sensor doesn't capture in CFG mode: what the driver holds now is of the old mode;
+	//under the lock no packet of the old mode can be read after the sequence is taken
+	uint64_t sequence = 0;
+	{
+		lock_guard<mutex> lock(m_mutexConfigVersion);
+		m_pCeleDriver->clearData();
+		sequence = m_ulPacketSequence;
+	}
 	enterStartMode();
+
+	m_lastModeSwitch.fromMode = m_emSensorFixedMode;
+	m_lastModeSwitch.toMode = mode;
+	m_lastModeSwitch.writeCount = ulWriteCount;
+	m_lastModeSwitch.duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - tpStart).count();
+	m_lastModeSwitch.sequence = sequence;
 	m_emSensorFixedMode = mode;
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
+}
+
+// The registers written for a fixed mode, and the writes turning the configuration of
+// one mode into that of another: only the registers whose value differs
+void CeleX5::buildModeConfigs()
+{
+	m_vecModeConfigRegister.assign(REGISTER_NUMBER, false);
+	for (int mode = 0; mode < 8; mode++)
+	{
+		vector<RegisterValue>& vecConfig = m_vecModeConfig[mode];
+		vecConfig.clear();
+		appendField(vecConfig, CSR::SENSOR_MODE[0], mode);
+		//Disable brightness adjustment (auto isp), always load sensor core parameters from profile0
+		appendField(vecConfig, CSR::AUTOISP_BRT_EN, 0);
+		appendField(vecConfig, CSR::AUTOISP_TRIGGER, 0);
+		appendField(vecConfig, CSR::AUTOISP_PROFILE_ADDR, 0); //Write core parameters to profile0
+		appendField(vecConfig, CSR::AUTOISP_BRT_VALUE, 1500); //Set initial brightness value 1500
+		appendField(vecConfig, CSR::BIAS_BRT_I, 140); //Override the brightness value in profile0, avoid conflict with AUTOISP profile0
+		for (auto itr = vecConfig.begin(); itr != vecConfig.end(); itr++)
+			m_vecModeConfigRegister[itr->address] = true;
+	}
+	for (int from = 0; from < 8; from++)
+	{
+		for (int to = 0; to < 8; to++)
+		{
+			vector<RegisterValue>& vecDelta = m_vecModeDelta[from][to];
+			vecDelta.clear();
+			for (auto itr = m_vecModeConfig[to].begin(); itr != m_vecModeConfig[to].end(); itr++)
+			{
+				auto itr1 = m_vecModeConfig[from].begin();
+				while (itr1 != m_vecModeConfig[from].end() && itr1->address != itr->address)
+					itr1++;
+				if (itr1 == m_vecModeConfig[from].end() || itr1->value != itr->value)
+					vecDelta.push_back(*itr);
+			}
+		}
+	}
+}
+
+void CeleX5::getLastModeSwitch(ModeSwitch &modeSwitch)
+{
+	modeSwitch = m_lastModeSwitch;
 }
 
 // Set the Sensor operation mode in loop mode
@@ -112,7 +346,7 @@ void CeleX5::setSensorLoopMode(CeleX5Mode mode, int loopNum)
 		return;
 	}
 	enterCFGMode();
-	wireIn(52 + loopNum, static_cast<uint32_t>(mode), 0xFF);
+	writeField(CSR::SENSOR_MODE[loopNum - 1], static_cast<uint32_t>(mode));
 	enterStartMode();
 }
 
@@ -142,17 +376,17 @@ void CeleX5::setLoopModeEnabled(bool enable)
 	enterCFGMode();
 	if (enable)
 	{
-		wireIn(64, 1, 0xFF);
+		writeField(CSR::SENSOR_MODE_SELECT, 1);
 		//Disable brightness adjustment (auto isp), always load sensor core parameters from profile0
-		wireIn(221, 0, 0xFF); //AUTOISP_BRT_EN, disable auto isp
-		wireIn(223, 1, 0xFF); //AUTOISP_TRIGGER
-		wireIn(220, 0, 0xFF); //AUTOISP_PROFILE_ADDR, Write core parameters to profile0
-		writeRegister(233, -1, 232, 1500); //AUTOISP_BRT_VALUE, Set initial brightness value 1500
-		writeRegister(22, -1, 23, 140); //BIAS_BRT_I, Override the brightness value in profile0, avoid conflict with AUTOISP profile0
+		writeField(CSR::AUTOISP_BRT_EN, 0); //disable auto isp
+		writeField(CSR::AUTOISP_TRIGGER, 1);
+		writeField(CSR::AUTOISP_PROFILE_ADDR, 0); //Write core parameters to profile0
+		writeField(CSR::AUTOISP_BRT_VALUE, 1500); //Set initial brightness value 1500
+		writeField(CSR::BIAS_BRT_I, 140); //Override the brightness value in profile0, avoid conflict with AUTOISP profile0
 	}
 	else
 	{
-		wireIn(64, 0, 0xFF);
+		writeField(CSR::SENSOR_MODE_SELECT, 0);
 	}
 	enterStartMode();
 }
@@ -168,12 +402,7 @@ bool CeleX5::isLoopModeEnabled()
 void CeleX5::setEventDuration(uint32_t value)
 {
 	enterCFGMode();
-
-	uint32_t valueH = value >> 8;
-	uint32_t valueL = 0xFF & value;
-	wireIn(58, valueH, 0xFF);
-	wireIn(57, valueL, 0xFF);
-
+	writeField(CSR::EVENT_DURATION, value);
 	enterStartMode();
 }
 
@@ -188,11 +417,11 @@ void CeleX5::setPictureNumber(uint32_t num, CeleX5Mode mode)
 	enterCFGMode();
 
 	if (Full_Picture_Mode == mode)
-		wireIn(59, num, 0xFF);
+		writeField(CSR::PICTURE_NUMBER[0], num);
 	else if (Full_Optical_Flow_S_Mode == mode)
-		wireIn(60, num, 0xFF);
+		writeField(CSR::PICTURE_NUMBER[1], num);
 	else if (Full_Optical_Flow_M_Mode == mode)
-		wireIn(62, num, 0xFF);
+		writeField(CSR::PICTURE_NUMBER[3], num);
 
 	enterStartMode();
 }
@@ -200,23 +429,31 @@ void CeleX5::setPictureNumber(uint32_t num, CeleX5Mode mode)
 // BIAS_EVT_VL : 341 address(2/3)
 // BIAS_EVT_DC : 512 address(4/5)
 // BIAS_EVT_VH : 683 address(6/7)
-void CeleX5::setThreshold(uint32_t value)
+bool CeleX5::setThreshold(uint32_t value)
 {
-	m_uiThreshold = value;
-
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
 	enterCFGMode();
+	uint64_t ulWriteCount = m_ulRegisterWriteCount;
+	writeThreshold(value);
+	if (ulWriteCount != m_ulRegisterWriteCount)
+		changeConfigVersion();
+	enterStartMode();
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
+}
+
+void CeleX5::writeThreshold(uint32_t value)
+{
+	m_uiThreshold = value;
 
 	int EVT_VL = 512 - value;
 	if (EVT_VL < 0)
 		EVT_VL = 0;
-	writeRegister(2, -1, 3, EVT_VL);
+	writeField(CSR::BIAS_EVT_VL, EVT_VL);
 
 	int EVT_VH = 512 + value;
 	if (EVT_VH > 1023)
 		EVT_VH = 1023;
-	writeRegister(6, -1, 7, EVT_VH);
-
-	enterStartMode();
+	writeField(CSR::BIAS_EVT_VH, EVT_VH);
 }
 
 uint32_t CeleX5::getThreshold()
@@ -226,16 +463,26 @@ uint32_t CeleX5::getThreshold()
 
 // Set Contrast
 // COL_GAIN: address = 45, width = [1:0]
-void CeleX5::setContrast(uint32_t value)
+bool CeleX5::setContrast(uint32_t value)
+{
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
+	enterCFGMode();
+	uint64_t ulWriteCount = m_ulRegisterWriteCount;
+	writeContrast(value);
+	if (ulWriteCount != m_ulRegisterWriteCount)
+		changeConfigVersion();
+	enterStartMode();
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
+}
+
+void CeleX5::writeContrast(uint32_t value)
 {
 	m_uiContrast = value;
 	if (value < 1)
 		m_uiContrast = 1;
 	else if (value > 3)
 		m_uiContrast = 3;
-	enterCFGMode();
-	writeRegister(45, -1, -1, m_uiContrast);
-	enterStartMode();
+	writeField(CSR::COL_GAIN, m_uiContrast);
 }
 
 uint32_t CeleX5::getContrast()
@@ -247,13 +494,22 @@ uint32_t CeleX5::getContrast()
 // <BIAS_BRT_I>
 // high byte address = 22, width = [1:0]
 // low byte address = 23, width = [7:0]
-void CeleX5::setBrightness(uint32_t value)
+bool CeleX5::setBrightness(uint32_t value)
 {
-	m_uiBrightness = value;
-
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
 	enterCFGMode();
-	writeRegister(22, -1, 23, value);
+	uint64_t ulWriteCount = m_ulRegisterWriteCount;
+	writeBrightness(value);
+	if (ulWriteCount != m_ulRegisterWriteCount)
+		changeConfigVersion();
 	enterStartMode();
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
+}
+
+void CeleX5::writeBrightness(uint32_t value)
+{
+	m_uiBrightness = value;
+	writeField(CSR::BIAS_BRT_I, value);
 }
 
 uint32_t CeleX5::getBrightness()
@@ -261,80 +517,361 @@ uint32_t CeleX5::getBrightness()
 	return m_uiBrightness;
 }
 
+void CeleX5::getSensorConfig(SensorConfig &config)
+{
+	config.threshold = m_uiThreshold;
+	config.brightness = m_uiBrightness;
+	config.contrast = m_uiContrast;
+	config.version = m_uiConfigVersion;
+}
+
+// Write the parameters that differ from the current ones in one CFG mode window.
+// The sensor doesn't capture while in CFG mode, so the data still buffered by the driver
+// was captured with the old parameters: it is dropped before the version is changed and
+// every packet read afterwards was captured with the new parameters.
+uint32_t CeleX5::commitSensorConfig(const SensorConfig &config)
+{
+	enterCFGMode();
+	if (config.threshold != m_uiThreshold)
+		writeThreshold(config.threshold);
+	if (config.brightness != m_uiBrightness)
+		writeBrightness(config.brightness);
+	if (config.contrast != m_uiContrast)
+		writeContrast(config.contrast);
+	uint32_t version = changeConfigVersion();
+	enterStartMode();
+	return version;
+}
+
+// Called in CFG mode once the parameters were written
+uint32_t CeleX5::changeConfigVersion()
+{
+	lock_guard<mutex> lock(m_mutexConfigVersion);
+	if (m_pCeleDriver)
+		m_pCeleDriver->clearData();
+	return ++m_uiConfigVersion;
+}
+
+uint32_t CeleX5::getConfigVersion()
+{
+	return m_uiConfigVersion;
+}
+
 uint32_t CeleX5::getClockRate()
 {
 	return m_uiClockRate;
 }
 
-void CeleX5::setClockRate(uint32_t value)
+// Change the PLL and MIPI PLL parameters to those of the rate in the clock table.
+// The PLL is only powered down when one of its parameters differs from what the register
+// cache holds, the MIPI lanes only when the MIPI PLL parameters differ.
+bool CeleX5::setClockRate(uint32_t value)
 {
-	if (value > 100 || value < 20)
-		return;
-	m_uiClockRate = value;
+	auto itr = m_vecClockTable.begin();
+	while (itr != m_vecClockTable.end() && itr->clockRate != value)
+		itr++;
+	if (itr == m_vecClockTable.end())
+	{
+		cout << "CeleX5::setClockRate: " << value << " MHz is not in the clock table!" << endl;
+		return false;
+	}
+	cout << "CeleX5::setClockRate: " << value << " MHz" << endl;
+
+	uint64_t ulStart = chrono::duration_cast<chrono::microseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+	uint64_t ulWriteCount = m_ulRegisterWriteCount;
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
+	bool bPLLChanged = !isFieldCached(CSR::PLL_DIV_N, itr->pllDivN) ||
+		!isFieldCached(CSR::PLL_DIV_L, itr->pllDivL) ||
+		!isFieldCached(CSR::PLL_FOUT_DIV1, itr->pllFoutDiv1) ||
+		!isFieldCached(CSR::PLL_FOUT_DIV2, itr->pllFoutDiv2);
+	bool bMIPIChanged = !isFieldCached(CSR::MIPI_PLL_DIV_I, itr->mipiPllDivI) ||
+		!isFieldCached(CSR::MIPI_PLL_DIV_N, itr->mipiPllDivN);
+
 	enterCFGMode();
+	if (bPLLChanged)
+	{
+		// Disable PLL
+		writeField(CSR::PLL_PD_B, 0);
+		// Write PLL Clock Parameter
+		writeField(CSR::PLL_DIV_N, itr->pllDivN);
+		writeField(CSR::PLL_DIV_L, itr->pllDivL);
+		writeField(CSR::PLL_FOUT_DIV1, itr->pllFoutDiv1);
+		writeField(CSR::PLL_FOUT_DIV2, itr->pllFoutDiv2);
+		// Enable PLL
+		writeField(CSR::PLL_PD_B, 1);
+	}
+	if (bMIPIChanged)
+	{
+		disableMIPI();
+		writeField(CSR::MIPI_PLL_DIV_I, itr->mipiPllDivI);
+		writeField(CSR::MIPI_PLL_DIV_N, itr->mipiPllDivN);
+		enableMIPI();
+	}
+	//the data buffered by the driver was captured at the old rate; the sensor doesn't
+	//capture in CFG mode, so the first packet read from now on was captured at the new rate
+	{
+		lock_guard<mutex> lock(m_mutexConfigVersion);
+		if (m_pCeleDriver)
+			m_pCeleDriver->clearData();
+	}
+	{
+		lock_guard<mutex> lock(m_mutexClockRetune);
+		m_lastClockRetune.fromRate = m_uiClockRate;
+		m_lastClockRetune.toRate = value;
+		m_lastClockRetune.settleTime = 0;
+		m_lastClockRetune.sequence = 0;
+		m_ulClockRetuneStart = ulStart;
+		m_bClockSettling = true;
+	}
+	enterStartMode();
+
+	{
+		lock_guard<mutex> lock(m_mutexClockRetune);
+		m_lastClockRetune.writeCount = m_ulRegisterWriteCount - ulWriteCount;
+		m_lastClockRetune.writeDuration = chrono::duration_cast<chrono::microseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count() - ulStart;
+	}
+	m_uiClockRate = value;
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
+}
+
+// The entries are checked against the ranges of the registers; the rate is recorded
+// in RecordSensorState::clockRate, so it has to fit into a byte
+bool CeleX5::setClockTable(const vector<ClockSetting>& vecSetting)
+{
+	vector<ClockSetting> vecTable;
+	for (auto itr = vecSetting.begin(); itr != vecSetting.end(); itr++)
+	{
+		bool bValid = itr->clockRate > 0 && itr->clockRate <= 255 &&
+			CSR::PLL_DIV_N.isInRange(itr->pllDivN) &&
+			CSR::PLL_DIV_L.isInRange(itr->pllDivL) &&
+			CSR::PLL_FOUT_DIV1.isInRange(itr->pllFoutDiv1) &&
+			CSR::PLL_FOUT_DIV2.isInRange(itr->pllFoutDiv2) &&
+			CSR::MIPI_PLL_DIV_I.isInRange(itr->mipiPllDivI) &&
+			CSR::MIPI_PLL_DIV_N.isInRange(itr->mipiPllDivN);
+		for (auto itr1 = vecTable.begin(); bValid && itr1 != vecTable.end(); itr1++)
+			bValid = itr1->clockRate != itr->clockRate;
+		if (!bValid)
+		{
+			cout << "CeleX5::setClockTable: invalid entry " << itr - vecSetting.begin()
+				<< " (" << itr->clockRate << " MHz)!" << endl;
+			return false;
+		}
+		vecTable.push_back(*itr);
+	}
+	sort(vecTable.begin(), vecTable.end(),
+		[](const ClockSetting& a, const ClockSetting& b) { return a.clockRate < b.clockRate; });
+	m_vecClockTable = vecTable;
+	return true;
+}
 
-	// Disable PLL
-	wireIn(150, 0, 0xFF);
-	int clock[15] = { 20,  30,  40,  50,  60,  70,  80,  90, 100, 110, 120, 130, 140, 150, 160 };
+void CeleX5::getClockTable(vector<ClockSetting>& vecSetting)
+{
+	vecSetting = m_vecClockTable;
+}
 
-	int PLL_DIV_N[15] = { 12,  18,  12,  15,  18,  21,  12,  18,  15,  22,  18,  26,  21,  30,  24 };
-	int PLL_DIV_L[15] = { 2,   3,   2,   2,   2,   2,   2,   3,   2,   3,   2,   3,   2,   3,   2 };
-	int PLL_FOUT_DIV1[15] = { 3,   2,   1,   1,   1,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0 };
-	int PLL_FOUT_DIV2[15] = { 3,   2,   3,   3,   3,   3,   3,   2,   3,   3,   3,   3,   3,   3,   3 };
+void CeleX5::getLastClockRetune(ClockRetune& retune)
+{
+	lock_guard<mutex> lock(m_mutexClockRetune);
+	retune = m_lastClockRetune;
+}
 
-	int MIPI_PLL_DIV_I[15] = { 3,   2,   3,   3,   2,   2,   3,   2,   3,   2,   2,   2,   2,   2,   1 };
-	//int MIPI_PLL_DIV_N[15] = { 120, 120, 120, 96, 120, 102, 120, 120, 96, 130, 120, 110, 102, 96, 120 };
-	//int MIPI_PLL_DIV_N[15] = { 100, 120, 100, 96, 120, 102, 100, 120, 96, 130, 120, 110, 102, 96, 120 };
-	int MIPI_PLL_DIV_N[15] = { 180, 180, 180, 144, 180, 153, 180, 180, 144, 195, 180, 165, 153, 144, 180 };
+bool CeleX5::startRecording(string filePath, bool bDirectIO)
+{
+	return m_pRecorder->startRecording(filePath, bDirectIO);
+}
 
-	int index = value / 10 - 2;
+bool CeleX5::startShardedRecording(string manifestPath, const vector<string>& vecDirectory,
+	RecordShardPolicy policy, uint32_t segmentDuration, bool bDirectIO)
+{
+	return m_pRecorder->startRecording(manifestPath, vecDirectory, policy, segmentDuration, bDirectIO);
+}
 
-	cout << "CeleX5::setClockRate: " << clock[index] << " MHz" << endl;
+void CeleX5::stopRecording()
+{
+	m_pRecorder->stopRecording();
+}
 
-	// Write PLL Clock Parameter
-	writeRegister(159, -1, -1, PLL_DIV_N[index]);
-	writeRegister(160, -1, -1, PLL_DIV_L[index]);
-	writeRegister(151, -1, -1, PLL_FOUT_DIV1[index]);
-	writeRegister(152, -1, -1, PLL_FOUT_DIV2[index]);
+bool CeleX5::isRecording()
+{
+	return m_pRecorder->isRecording();
+}
 
-	// Enable PLL
-	wireIn(150, 1, 0xFF);
+void CeleX5::recordMIPIData(const uint8_t* pData, uint32_t dataSize, uint64_t sequence)
+{
+	writeRecord(RECORD_TYPE_MIPI_PACKET, 0x07 & pData[dataSize - 1], pData, dataSize, sequence); //mode byte appended by the CX3 firmware
+}
 
-	disableMIPI();
-	writeRegister(113, -1, -1, MIPI_PLL_DIV_I[index]);
-	writeRegister(115, -1, 114, MIPI_PLL_DIV_N[index]);
-	enableMIPI();
+// Tag the record with the host time and the sensor settings in effect
+void CeleX5::writeRecord(uint16_t type, uint16_t mode, const uint8_t* pData, uint32_t dataSize, uint64_t sequence)
+{
+	RecordPacketHeader header;
+	memset(&header, 0, sizeof(header));
+	header.timeStamp = chrono::duration_cast<chrono::microseconds>(
+		chrono::system_clock::now().time_since_epoch()).count();
+	header.sequence = sequence;
+	header.dataSize = dataSize;
+	header.type = type;
+	header.mode = mode;
+	header.state.threshold = m_uiThreshold;
+	header.state.brightness = m_uiBrightness;
+	header.state.contrast = m_uiContrast;
+	header.state.clockRate = m_uiClockRate;
+	header.state.loopModeEnabled = m_bLoopModeEnabled;
+	header.state.autoISPEnabled = m_bAutoISPEnabled;
+	header.state.eventPacketFormat = m_uiEventPacketFormat;
+	header.configVersion = m_uiConfigVersion;
+	if (m_pRecorder->isRecording())
+		m_pRecorder->writePacket(header, pData);
+	if (m_pRingRecorder->isEnabled())
+		m_pRingRecorder->writePacket(header, pData);
+}
 
-	enterStartMode();
+void CeleX5::setPreTriggerBuffer(uint32_t duration, uint64_t maxBytes)
+{
+	m_pRingRecorder->setCapacity(duration, maxBytes);
+}
+
+bool CeleX5::triggerRecording(string filePath, uint32_t postTriggerTime, bool bDirectIO)
+{
+	return m_pRingRecorder->trigger(filePath, postTriggerTime, bDirectIO);
+}
+
+bool CeleX5::isSavingTriggerRecording()
+{
+	return m_pRingRecorder->isFlushing();
+}
+
+bool CeleX5::openPlaybackFile(string filePath)
+{
+	if (!m_pPlayer->openFile(filePath))
+		return false;
+	m_vecPlaybackRegisterWrite.clear();
+	m_bPlaybackSensorStateValid = false;
+	return true;
+}
+
+void CeleX5::closePlaybackFile()
+{
+	m_pPlayer->closeFile();
+}
+
+bool CeleX5::isPlaybackFileOpened()
+{
+	return m_pPlayer->isOpened();
+}
+
+bool CeleX5::isPlaybackFinished()
+{
+	return m_pPlayer->isEndOfFile();
+}
+
+void CeleX5::setPlaybackMode(PlaybackMode mode)
+{
+	m_pPlayer->setRealTimeEnabled(Playback_Real_Time == mode);
+}
+
+CeleX5::PlaybackMode CeleX5::getPlaybackMode()
+{
+	return m_pPlayer->isRealTimeEnabled() ? Playback_Real_Time : Playback_As_Fast_As_Possible;
+}
+
+bool CeleX5::seekPlaybackTime(uint64_t time)
+{
+	m_vecPlaybackRegisterWrite.clear();
+	return m_pPlayer->seekToTime(time);
+}
+
+bool CeleX5::seekPlaybackPacket(uint64_t packetNumber)
+{
+	m_vecPlaybackRegisterWrite.clear();
+	return m_pPlayer->seekToPacket(packetNumber);
+}
+
+uint64_t CeleX5::getPlaybackPacketNumber()
+{
+	return m_pPlayer->getPacketNumber();
+}
+
+void CeleX5::getPlaybackRegisterWrites(vector<RegisterWrite> &vecRegisterWrite)
+{
+	vecRegisterWrite.swap(m_vecPlaybackRegisterWrite);
+	m_vecPlaybackRegisterWrite.clear();
+}
+
+bool CeleX5::getPlaybackSensorState(SensorState &state)
+{
+	if (!m_bPlaybackSensorStateValid)
+		return false;
+	state = m_playbackSensorState;
+	return true;
+}
+
+// The sensor settings stored with the packet are kept for getPlaybackSensorState
+bool CeleX5::getPlaybackPacket(MIPIPacket &packet)
+{
+	const uint8_t* pData = NULL;
+	const RecordPacketHeader* pHeader = NULL;
+	while ((pHeader = m_pPlayer->getNextRecord(&pData)) != NULL)
+	{
+		if (RECORD_TYPE_MIPI_PACKET == pHeader->type && pHeader->dataSize > 0)
+			break;
+		if (RECORD_TYPE_REGISTER_WRITE == pHeader->type && pHeader->dataSize >= sizeof(RecordRegisterWrite))
+		{
+			RecordRegisterWrite registerWrite;
+			memcpy(&registerWrite, pData, sizeof(registerWrite));
+			RegisterWrite write = { pHeader->timeStamp, pHeader->sequence,
+				registerWrite.address, registerWrite.value, registerWrite.mask };
+			m_vecPlaybackRegisterWrite.push_back(write);
+		}
+	}
+	if (NULL == pHeader)
+		return false;
+
+	packet.buffer.reset();
+	packet.data = pData;
+	packet.size = pHeader->dataSize;
+	packet.mode = CeleX5Mode(pHeader->mode);
+	packet.sequence = pHeader->sequence;
+	packet.configVersion = pHeader->configVersion;
+
+	//kept apart from the settings of the sensor, which may be open as well
+	m_playbackSensorState.threshold = pHeader->state.threshold;
+	m_playbackSensorState.brightness = pHeader->state.brightness;
+	m_playbackSensorState.contrast = pHeader->state.contrast;
+	m_playbackSensorState.clockRate = pHeader->state.clockRate;
+	m_playbackSensorState.loopModeEnabled = pHeader->state.loopModeEnabled != 0;
+	m_playbackSensorState.autoISPEnabled = pHeader->state.autoISPEnabled != 0;
+	m_playbackSensorState.eventPacketFormat = pHeader->state.eventPacketFormat;
+	m_bPlaybackSensorStateValid = true;
+	return true;
 }
 
 map<string, vector<CeleX5::CfgInfo>> CeleX5::getCeleX5Cfg()
 {
-	map<string, vector<HHCommandBase*>> mapCfg = m_pSequenceMgr->getCeleX5Cfg();
-	//
-	map<string, vector<CeleX5::CfgInfo>> mapCfg1;
-	for (auto itr = mapCfg.begin(); itr != mapCfg.end(); itr++)
+	map<string, vector<CeleX5::CfgInfo>> mapCfg;
+	for (uint32_t i = 0; i < m_pCfgProfile->getGroupCount(); i++)
 	{
-		//cout << "CelexSensorDLL::getCeleX5Cfg: " << itr->first << endl;
-		vector<HHCommandBase*> pCmdList = itr->second;
+		const CfgProfileGroup* pGroup = m_pCfgProfile->getGroup(i);
+		const CfgProfileEntry* pEntry = m_pCfgProfile->getEntries(pGroup);
 		vector<CeleX5::CfgInfo> vecCfg;
-		for (auto itr1 = pCmdList.begin(); itr1 != pCmdList.end(); itr1++)
+		for (uint32_t j = 0; j < pGroup->entryCount; j++, pEntry++)
 		{
-			WireinCommandEx* pCmd = (WireinCommandEx*)(*itr1);
-			//cout << "----- Register Name: " << pCmd->name() << endl;
 			CeleX5::CfgInfo cfgInfo;
-			cfgInfo.name = pCmd->name();
-			cfgInfo.min = pCmd->minValue();
-			cfgInfo.max = pCmd->maxValue();
-			cfgInfo.value = pCmd->value();
-			cfgInfo.high_addr = pCmd->highAddr();
-			cfgInfo.middle_addr = pCmd->middleAddr();
-			cfgInfo.low_addr = pCmd->lowAddr();
+			cfgInfo.name = m_pCfgProfile->getName(pEntry->nameOffset);
+			cfgInfo.min = pEntry->min;
+			cfgInfo.max = pEntry->max;
+			cfgInfo.value = pEntry->value;
+			cfgInfo.step = pEntry->step;
+			cfgInfo.high_addr = pEntry->highAddr;
+			cfgInfo.middle_addr = pEntry->middleAddr;
+			cfgInfo.low_addr = pEntry->lowAddr;
 			vecCfg.push_back(cfgInfo);
 		}
-		mapCfg1[itr->first] = vecCfg;
+		mapCfg[m_pCfgProfile->getName(pGroup->nameOffset)] = vecCfg;
 	}
-	return mapCfg1;
+	return mapCfg;
 }
 
 void CeleX5::writeRegister(int16_t addressH, int16_t addressM, int16_t addressL, uint32_t value)
@@ -355,113 +892,209 @@ void CeleX5::writeRegister(int16_t addressH, int16_t addressM, int16_t addressL,
 	}
 }
 
-void CeleX5::writeCSRDefaults(string csrType)
+void CeleX5::writeCSRDefaults(const string& csrType)
 {
 	cout << "CeleX5::writeCSRDefaults: " << csrType << endl;
-	for (auto itr = m_mapCfgDefaults.begin(); itr != m_mapCfgDefaults.end(); itr++)
-	{
-		//cout << "group name: " << itr->first << endl;
-		string tapName = itr->first;
-		if (csrType == tapName)
-		{
-			vector<CeleX5::CfgInfo> vecCfg = itr->second;
-			for (auto itr1 = vecCfg.begin(); itr1 != vecCfg.end(); itr1++)
-			{
-				CeleX5::CfgInfo cfgInfo = (*itr1);
-				writeRegister(cfgInfo);
-			}
-			break;
-		}
-	}
+	const CfgProfileGroup* pGroup = m_pCfgProfile->findGroup(csrType.c_str());
+	if (NULL == pGroup)
+		return;
+	const CfgProfileEntry* pEntry = m_pCfgProfile->getEntries(pGroup);
+	beginRegisterBatch();
+	for (uint32_t i = 0; i < pGroup->entryCount; i++, pEntry++)
+		writeRegister(pEntry->highAddr, pEntry->middleAddr, pEntry->lowAddr, pEntry->value);
+	endRegisterBatch();
+}
+
+uint32_t CeleX5::getCfgDefault(const string& csrType, const string& name, uint32_t defaultValue)
+{
+	const CfgProfileGroup* pGroup = m_pCfgProfile->findGroup(csrType.c_str());
+	if (NULL == pGroup)
+		return defaultValue;
+	const CfgProfileEntry* pEntry = m_pCfgProfile->findEntry(pGroup, name.c_str());
+	if (NULL == pEntry)
+		return defaultValue;
+	return pEntry->value;
 }
 
+// The register writes are resolved from the CSR defaults once by buildBringUpSequence,
+// not looked up again on every openSensor; each phase is timed, see getBringUpTimes
 bool CeleX5::configureSettings()
 {
+	if (m_bBringUpSequenceChanged)
+		buildBringUpSequence();
+	m_vecBringUpPhase.clear();
+
+	auto tpStart = chrono::steady_clock::now();
 	setALSEnabled(false);
 	if (m_pCeleDriver)
 		m_pCeleDriver->openStream();
-
-	//--------------- Step1 ---------------
-	wireIn(94, 0, 0xFF); //PADDR_EN
-
-						 //--------------- Step2: Load PLL Parameters ---------------
-						 //Disable PLL
-	cout << "--- Disable PLL ---" << endl;
-	wireIn(150, 0, 0xFF); //PLL_PD_B
-						  //Load PLL Parameters
-	cout << endl << "--- Load PLL Parameters ---" << endl;
-	writeCSRDefaults("PLL_Parameters");
-	//Enable PLL
-	cout << "--- Enable PLL ---" << endl;
-	wireIn(150, 1, 0xFF); //PLL_PD_B
-
-						  //--------------- Step3: Load MIPI Parameters ---------------
-	cout << endl << "--- Disable MIPI ---" << endl;
-	disableMIPI();
-
-	cout << endl << "--- Load MIPI Parameters ---" << endl;
-	writeCSRDefaults("MIPI_Parameters");
-	writeRegister(115, -1, 114, 120); //MIPI_PLL_DIV_N
-
-									  //Enable MIPI
-	cout << endl << "--- Enable MIPI ---" << endl;
-	enableMIPI();
-
-	//--------------- Step4: ---------------
-	cout << endl << "--- Enter CFG Mode ---" << endl;
-	enterCFGMode();
-
-	//----- Load Sensor Core Parameters -----
-	wireIn(220, 0, 0xFF); //AUTOISP_PROFILE_ADDR
-	writeCSRDefaults("Sensor_Core_Parameters");
-	//if (m_bAutoISPEnabled)
+	BringUpPhase phaseOpen;
+	phaseOpen.name = "Open_Stream";
+	phaseOpen.writeCount = 0;
+	phaseOpen.duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - tpStart).count();
+	m_vecBringUpPhase.push_back(phaseOpen);
+
+	beginRegisterBatch();
+	for (auto itr = m_vecBringUpSequence.begin(); itr != m_vecBringUpSequence.end(); itr++)
 	{
-		//--------------- for auto isp --------------- 
-		wireIn(220, 0, 0xFF); //AUTOISP_PROFILE_ADDR
-							  //Load Sensor Core Parameters
-		writeCSRDefaults("Sensor_Core_Parameters");
-		writeRegister(22, -1, 23, 140);
-
-		wireIn(220, 1, 0xFF); //AUTOISP_PROFILE_ADDR
-							  //Load Sensor Core Parameters
-		writeCSRDefaults("Sensor_Core_Parameters");
-		writeRegister(22, -1, 23, m_arrayBrightness[1]);
+		tpStart = chrono::steady_clock::now();
+		for (auto itr1 = itr->writes.begin(); itr1 != itr->writes.end(); itr1++)
+			wireIn(itr1->address, itr1->value, 0xFF);
+		BringUpPhase phase;
+		phase.name = itr->name;
+		phase.writeCount = itr->writes.size();
+		phase.duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - tpStart).count();
+		m_vecBringUpPhase.push_back(phase);
+	}
+	endRegisterBatch();
 
-		wireIn(220, 2, 0xFF); //AUTOISP_PROFILE_ADDR
-							  //Load Sensor Core Parameters
-		writeCSRDefaults("Sensor_Core_Parameters");
-		writeRegister(22, -1, 23, m_arrayBrightness[2]);
+	uint64_t ulTotalDuration = 0;
+	for (auto itr = m_vecBringUpPhase.begin(); itr != m_vecBringUpPhase.end(); itr++)
+	{
+		cout << "CeleX5::configureSettings: " << itr->name << ", " << itr->writeCount << " writes, "
+			<< itr->duration << " us" << endl;
+		ulTotalDuration += itr->duration;
+	}
+	cout << "CeleX5::configureSettings: total " << ulTotalDuration << " us" << endl;
 
-		wireIn(220, 3, 0xFF); //AUTOISP_PROFILE_ADDR
-							  //Load Sensor Core Parameters
-		writeCSRDefaults("Sensor_Core_Parameters");
-		writeRegister(22, -1, 23, m_arrayBrightness[3]);
+	return true;
+}
 
-		wireIn(221, 0, 0xFF); //AUTOISP_BRT_EN, disable auto ISP
-		wireIn(222, 0, 0xFF); //AUTOISP_TEM_EN
-		wireIn(223, 0, 0xFF); //AUTOISP_TRIGGER
+// The writes of configureSettings by phase. The sensor core parameters are written once
+// per auto ISP profile, with the brightness of the profile in place of the default one.
+void CeleX5::buildBringUpSequence()
+{
+	m_vecBringUpSequence.clear();
+
+	//--------------- Load PLL Parameters ---------------
+	BringUpStep stepPLL;
+	stepPLL.name = "PLL_Parameters";
+	appendField(stepPLL.writes, CSR::PADDR_EN, 0);
+	appendField(stepPLL.writes, CSR::PLL_PD_B, 0); //disable PLL
+	appendCSRDefaults(stepPLL.writes, "PLL_Parameters");
+	appendField(stepPLL.writes, CSR::PLL_PD_B, 1); //enable PLL
+	m_vecBringUpSequence.push_back(stepPLL);
+
+	//--------------- Load MIPI Parameters ---------------
+	BringUpStep stepMIPI;
+	stepMIPI.name = "MIPI_Parameters";
+	for (int i = 0; i < 6; i++)
+		appendField(stepMIPI.writes, CSR::MIPI_POWER[i], 0); //disable MIPI
+	appendCSRDefaults(stepMIPI.writes, "MIPI_Parameters");
+	appendField(stepMIPI.writes, CSR::MIPI_PLL_DIV_N, 120);
+	for (int i = 0; i < 6; i++)
+		appendField(stepMIPI.writes, CSR::MIPI_POWER[i], 1); //enable MIPI
+	m_vecBringUpSequence.push_back(stepMIPI);
+
+	//--------------- Load Sensor Core Parameters, in CFG mode ---------------
+	BringUpStep stepCore;
+	stepCore.name = "Sensor_Core_Parameters";
+	appendField(stepCore.writes, CSR::SOFT_TRIGGER, 0); //enter CFG mode
+	appendField(stepCore.writes, CSR::SOFT_RESET, 1);
+	vector<RegisterValue> vecCore;
+	appendCSRDefaults(vecCore, "Sensor_Core_Parameters");
+	for (int profile = 0; profile < 4; profile++)
+	{
+		//profile 0 is also what the sensor runs with while the auto ISP is disabled
+		vector<RegisterValue> vecProfile = vecCore;
+		replaceField(vecProfile, CSR::BIAS_BRT_I, 0 == profile ? 140 : m_arrayBrightness[profile]);
+		appendField(stepCore.writes, CSR::AUTOISP_PROFILE_ADDR, profile);
+		stepCore.writes.insert(stepCore.writes.end(), vecProfile.begin(), vecProfile.end());
+	}
+	m_vecBringUpSequence.push_back(stepCore);
+
+	//--------------- for auto isp ---------------
+	BringUpStep stepAutoISP;
+	stepAutoISP.name = "Auto_ISP_Parameters";
+	appendField(stepAutoISP.writes, CSR::AUTOISP_BRT_EN, 0); //disable auto ISP
+	appendField(stepAutoISP.writes, CSR::AUTOISP_TEM_EN, 0);
+	appendField(stepAutoISP.writes, CSR::AUTOISP_TRIGGER, 0);
+	appendField(stepAutoISP.writes, CSR::AUTOISP_REFRESH_TIME, m_uiAutoISPRefreshTime);
+	for (int i = 0; i < 3; i++)
+		appendField(stepAutoISP.writes, CSR::AUTOISP_BRT_THRES[i], m_arrayISPThreshold[i]);
+	appendField(stepAutoISP.writes, CSR::AUTOISP_BRT_VALUE, 1500);
+	m_vecBringUpSequence.push_back(stepAutoISP);
+
+	//--------------- Load Mode and Data Transfer Parameters ---------------
+	BringUpStep stepMode;
+	stepMode.name = "Sensor_Mode_Parameters";
+	appendCSRDefaults(stepMode.writes, "Sensor_Operation_Mode_Control_Parameters");
+	appendCSRDefaults(stepMode.writes, "Sensor_Data_Transfer_Parameters");
+	appendField(stepMode.writes, CSR::SOFT_RESET, 0); //enter Start mode
+	appendField(stepMode.writes, CSR::SOFT_TRIGGER, 1);
+	m_vecBringUpSequence.push_back(stepMode);
+
+	m_bBringUpSequenceChanged = false;
+}
 
-		writeRegister(225, -1, 224, m_uiAutoISPRefreshTime); //AUTOISP_REFRESH_TIME
+//same register layout as writeRegister(addressH, addressM, addressL, value)
+void CeleX5::appendCSRDefaults(vector<RegisterValue> &vecWrite, const string& csrType)
+{
+	const CfgProfileGroup* pGroup = m_pCfgProfile->findGroup(csrType.c_str());
+	if (NULL == pGroup)
+	{
+		cout << "CeleX5::appendCSRDefaults: no CSR group " << csrType << endl;
+		return;
+	}
+	const CfgProfileEntry* pEntry = m_pCfgProfile->getEntries(pGroup);
+	for (uint32_t i = 0; i < pGroup->entryCount; i++, pEntry++)
+	{
+		if (pEntry->middleAddr != -1 && pEntry->lowAddr != -1)
+			continue; //three register CSRs aren't written
+		RegisterField field = { m_pCfgProfile->getName(pEntry->nameOffset), (uint16_t)pEntry->highAddr,
+			pEntry->lowAddr, pEntry->min, pEntry->max };
+		appendField(vecWrite, field, pEntry->value);
+	}
+}
 
-		writeRegister(235, -1, 234, m_arrayISPThreshold[0]); //AUTOISP_BRT_THRES1
-		writeRegister(237, -1, 236, m_arrayISPThreshold[1]); //AUTOISP_BRT_THRES2
-		writeRegister(239, -1, 238, m_arrayISPThreshold[2]); //AUTOISP_BRT_THRES3
+void CeleX5::appendField(vector<RegisterValue> &vecWrite, const RegisterField& field, uint32_t value)
+{
+	if (!field.isInRange(value))
+		value = clampFieldValue(field, value);
+	RegisterValue writeH = { field.highAddr, field.highValue(value) };
+	vecWrite.push_back(writeH);
+	if (field.isSplit())
+	{
+		RegisterValue writeL = { (uint32_t)field.lowAddr, field.lowValue(value) };
+		vecWrite.push_back(writeL);
+	}
+}
 
-		writeRegister(233, -1, 232, 1500); //AUTOISP_BRT_VALUE
+//overwrite the value in place if the field is written already, append it otherwise
+void CeleX5::replaceField(vector<RegisterValue> &vecWrite, const RegisterField& field, uint32_t value)
+{
+	vector<RegisterValue> vecValue;
+	appendField(vecValue, field, value);
+	for (auto itr = vecValue.begin(); itr != vecValue.end(); itr++)
+	{
+		auto itr1 = vecWrite.begin();
+		while (itr1 != vecWrite.end() && itr1->address != itr->address)
+			itr1++;
+		if (itr1 == vecWrite.end())
+			vecWrite.push_back(*itr);
+		else
+			itr1->value = itr->value;
 	}
-	writeCSRDefaults("Sensor_Operation_Mode_Control_Parameters");
-	writeCSRDefaults("Sensor_Data_Transfer_Parameters");
-	cout << endl << "--- Enter Start Mode ---" << endl;
-	enterStartMode();
+}
 
-	return true;
+void CeleX5::getBringUpTimes(vector<BringUpPhase> &vecPhase)
+{
+	vecPhase = m_vecBringUpPhase;
 }
 
 void CeleX5::wireIn(uint32_t address, uint32_t value, uint32_t mask)
 {
 	if (m_pCeleDriver)
 	{
-		if (isAutoISPEnabled())
+		uint32_t cachedValue = 0;
+		if (m_bRegisterCacheEnabled && m_pRegisterCache->lookup(address, cachedValue) && cachedValue == value)
+		{
+			m_ulElidedRegisterWriteCount++;
+			return;
+		}
+		//in a batch ALS is already disabled, see beginRegisterBatch
+		bool bToggleALS = isAutoISPEnabled() && 0 == m_uiRegisterBatchDepth;
+		if (bToggleALS)
 		{
 			setALSEnabled(false);
 #ifdef _WIN32
@@ -473,72 +1106,137 @@ void CeleX5::wireIn(uint32_t address, uint32_t value, uint32_t mask)
 		if (m_pCeleDriver->i2c_set(address, value))
 		{
 			//cout << "CeleX5::wireIn(i2c_set): address = " << address << ", value = " << value << endl;
+			m_pRegisterCache->update(address, value);
+		}
+		else
+		{
+			m_pRegisterCache->invalidate(address);
+			m_ulFailedRegisterWriteCount++;
+			if (address < REGISTER_NUMBER && m_vecModeConfigRegister[address])
+				m_bModeConfigApplied = false; //the register may not hold the value of the mode
 		}
-		if (isAutoISPEnabled())
+		m_ulRegisterWriteCount++;
+		if (bToggleALS)
 		{
 			setALSEnabled(true);
 		}
+		if (!m_bApplyingModeConfig && address < REGISTER_NUMBER && m_vecModeConfigRegister[address])
+			m_bModeConfigApplied = false; //no longer known to hold the configuration of the mode
+		if (CSR::EVENT_PACKET_SELECT.highAddr == address)
+			m_uiEventPacketFormat = value;
+		if (m_pRecorder->isRecording() || m_pRingRecorder->isEnabled())
+		{
+			RecordRegisterWrite registerWrite = { address, value, mask, 0 };
+			writeRecord(RECORD_TYPE_REGISTER_WRITE, 0, (const uint8_t*)&registerWrite, sizeof(registerWrite), m_ulPacketSequence); //sequence of the next packet
+		}
+	}
+	else
+	{
+		m_ulFailedRegisterWriteCount++;
 	}
 }
 
-void CeleX5::writeRegister(CfgInfo cfgInfo)
+// The auto ISP reads the sensor over ALS, which must be off while registers are written:
+// a batch turns it off once for all of its writes instead of around every write
+void CeleX5::beginRegisterBatch()
 {
-	if (cfgInfo.low_addr == -1)
-	{
-		wireIn(cfgInfo.high_addr, cfgInfo.value, 0xFF);
-	}
-	else
+	if (0 == m_uiRegisterBatchDepth++ && m_pCeleDriver && isAutoISPEnabled())
 	{
-		if (cfgInfo.middle_addr == -1)
-		{
-			uint32_t valueH = cfgInfo.value >> 8;
-			uint32_t valueL = 0xFF & cfgInfo.value;
-			wireIn(cfgInfo.high_addr, valueH, 0xFF);
-			wireIn(cfgInfo.low_addr, valueL, 0xFF);
-		}
+		setALSEnabled(false);
+#ifdef _WIN32
+		Sleep(2);
+#else
+		usleep(1000 * 2);
+#endif
 	}
 }
 
-void CeleX5::setAutoISPEnabled(bool enable)
+void CeleX5::endRegisterBatch()
 {
-	m_bAutoISPEnabled = enable;
-	if (enable)
-	{
-		enterCFGMode();
+	if (0 == m_uiRegisterBatchDepth)
+		return;
+	if (0 == --m_uiRegisterBatchDepth && m_pCeleDriver && isAutoISPEnabled())
+		setALSEnabled(true);
+}
 
-		wireIn(221, 1, 0xFF); //AUTOISP_BRT_EN, enable auto ISP
-		if (isLoopModeEnabled())
-			wireIn(223, 1, 0xFF); //AUTOISP_TRIGGER
-		else
-			wireIn(223, 0, 0xFF); //AUTOISP_TRIGGER
+void CeleX5::setRegisterCacheEnabled(bool enable)
+{
+	m_bRegisterCacheEnabled = enable;
+}
+
+bool CeleX5::isRegisterCacheEnabled()
+{
+	return m_bRegisterCacheEnabled;
+}
+
+// The core parameters are banked by profile: only profile 0 is what the sensor runs
+// with, and only while the auto ISP isn't switching profiles
+bool CeleX5::readRegister(uint32_t address, uint32_t &value)
+{
+	if (NULL == m_pCeleDriver)
+		return false;
+	bool bCacheable = m_bRegisterCacheEnabled && !RegisterCache::isVolatile(address);
+	if (RegisterCache::isCoreParameter(address))
+		bCacheable = bCacheable && !m_bAutoISPEnabled && 0 == m_pRegisterCache->getSelectedProfile();
+	if (bCacheable && m_pRegisterCache->lookup(address, value))
+		return true;
 
-		wireIn(220, 0, 0xFF); //AUTOISP_PROFILE_ADDR, Write core parameters to profile0
-		writeRegister(233, -1, 232, 1500); //AUTOISP_BRT_VALUE, Set initial brightness value 1500
-		writeRegister(22, -1, 23, 80); //BIAS_BRT_I, Override the brightness value in profile0, avoid conflict with AUTOISP profile0		
+	uint16_t data = 0;
+	if (!m_pCeleDriver->i2c_get(address, data))
+		return false;
+	value = data;
+	if (bCacheable)
+		m_pRegisterCache->update(address, value);
+	return true;
+}
 
-		enterStartMode();
+uint64_t CeleX5::getRegisterWriteCount()
+{
+	return m_ulRegisterWriteCount;
+}
 
-		setALSEnabled(true);
+uint64_t CeleX5::getElidedRegisterWriteCount()
+{
+	return m_ulElidedRegisterWriteCount;
+}
+
+uint64_t CeleX5::getFailedRegisterWriteCount()
+{
+	return m_ulFailedRegisterWriteCount;
+}
+
+bool CeleX5::setAutoISPEnabled(bool enable)
+{
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
+	//ALS stays off from here, and is back on at the end if the auto ISP is enabled
+	beginRegisterBatch();
+	if (!enable)
+		setALSEnabled(false); //Disable ALS read and write
+	m_bAutoISPEnabled = enable;
+
+	enterCFGMode();
+	if (enable)
+	{
+		writeField(CSR::AUTOISP_BRT_EN, 1); //enable auto ISP
 	}
 	else
 	{
-		setALSEnabled(false); //Disable ALS read and write
-
-		enterCFGMode();
-
 		//Disable brightness adjustment (auto isp), always load sensor core parameters from profile0
-		wireIn(221, 0, 0xFF); //AUTOISP_BRT_EN, disable auto ISP
-		if (isLoopModeEnabled())
-			wireIn(223, 1, 0xFF); //AUTOISP_TRIGGER
-		else
-			wireIn(223, 0, 0xFF); //AUTOISP_TRIGGER
-
-		wireIn(220, 0, 0xFF); //AUTOISP_PROFILE_ADDR, Write core parameters to profile0
-		writeRegister(233, -1, 232, 1500); //AUTOISP_BRT_VALUE, Set initial brightness value 1500
-		writeRegister(22, -1, 23, 140); //BIAS_BRT_I, Override the brightness value in profile0, avoid conflict with AUTOISP profile0
-		
-		enterStartMode();
+		writeField(CSR::AUTOISP_BRT_EN, 0); //disable auto ISP
 	}
+	if (isLoopModeEnabled())
+		writeField(CSR::AUTOISP_TRIGGER, 1);
+	else
+		writeField(CSR::AUTOISP_TRIGGER, 0);
+
+	writeField(CSR::AUTOISP_PROFILE_ADDR, 0); //Write core parameters to profile0
+	writeField(CSR::AUTOISP_BRT_VALUE, 1500); //Set initial brightness value 1500
+	//Override the brightness value in profile0, avoid conflict with AUTOISP profile0
+	writeField(CSR::BIAS_BRT_I, enable ? 80 : 140);
+	enterStartMode();
+
+	endRegisterBatch();
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
 }
 
 bool CeleX5::isAutoISPEnabled()
@@ -549,59 +1247,122 @@ bool CeleX5::isAutoISPEnabled()
 void CeleX5::setALSEnabled(bool enable)
 {
 	if (enable)
-		m_pCeleDriver->i2c_set(254, 0);
+		m_pCeleDriver->i2c_set(CSR::ALS_CONTROL.highAddr, 0);
 	else
-		m_pCeleDriver->i2c_set(254, 2);
+		m_pCeleDriver->i2c_set(CSR::ALS_CONTROL.highAddr, 2);
 }
 
-void CeleX5::setISPThreshold(uint32_t value, int num)
+// num: 1 ~ 3
+bool CeleX5::setISPThreshold(uint32_t value, int num)
 {
+	if (num < 1 || num > 3)
+	{
+		cout << "CeleX5::setISPThreshold: wrong threshold number!" << endl;
+		return false;
+	}
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
 	m_arrayISPThreshold[num - 1] = value;
-	if (num == 1)
-		writeRegister(235, -1, 234, m_arrayISPThreshold[0]); //AUTOISP_BRT_THRES1
-	else if (num == 2)
-		writeRegister(237, -1, 236, m_arrayISPThreshold[1]); //AUTOISP_BRT_THRES2
-	else if (num == 3)
-		writeRegister(239, -1, 238, m_arrayISPThreshold[2]); //AUTOISP_BRT_THRES3
+	m_bBringUpSequenceChanged = true;
+	beginRegisterBatch();
+	writeField(CSR::AUTOISP_BRT_THRES[num - 1], m_arrayISPThreshold[num - 1]);
+	endRegisterBatch();
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
 }
 
-void CeleX5::setISPBrightness(uint32_t value, int num)
+// num: 1 ~ 4, the auto ISP profile num - 1
+bool CeleX5::setISPBrightness(uint32_t value, int num)
 {
+	if (num < 1 || num > 4)
+	{
+		cout << "CeleX5::setISPBrightness: wrong brightness number!" << endl;
+		return false;
+	}
+	uint64_t ulFailedCount = m_ulFailedRegisterWriteCount;
 	m_arrayBrightness[num - 1] = value;
-	wireIn(220, num - 1, 0xFF); //AUTOISP_PROFILE_ADDR
-	writeRegister(22, -1, 23, m_arrayBrightness[num - 1]);
+	m_bBringUpSequenceChanged = true;
+	beginRegisterBatch();
+	writeField(CSR::AUTOISP_PROFILE_ADDR, num - 1);
+	writeField(CSR::BIAS_BRT_I, m_arrayBrightness[num - 1]);
+	endRegisterBatch();
+	return ulFailedCount == m_ulFailedRegisterWriteCount;
+}
+
+void CeleX5::postThreshold(uint32_t value, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_Threshold, [this, value] { return setThreshold(value); }, callback);
+}
+
+void CeleX5::postContrast(uint32_t value, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_Contrast, [this, value] { return setContrast(value); }, callback);
+}
+
+void CeleX5::postBrightness(uint32_t value, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_Brightness, [this, value] { return setBrightness(value); }, callback);
+}
+
+void CeleX5::postClockRate(uint32_t value, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_ClockRate, [this, value] { return setClockRate(value); }, callback);
+}
+
+void CeleX5::postSensorFixedMode(CeleX5Mode mode, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_SensorFixedMode, [this, mode] { return setSensorFixedMode(mode); }, callback);
+}
+
+void CeleX5::postAutoISPEnabled(bool enable, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_AutoISPEnabled, [this, enable] { return setAutoISPEnabled(enable); }, callback);
+}
+
+void CeleX5::postISPThreshold(uint32_t value, int num, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_ISPThreshold | (num & 0xFF),
+		[this, value, num] { return setISPThreshold(value, num); }, callback);
+}
+
+void CeleX5::postISPBrightness(uint32_t value, int num, ConfigCallback callback)
+{
+	m_pConfigQueue->post(Config_ISPBrightness | (num & 0xFF),
+		[this, value, num] { return setISPBrightness(value, num); }, callback);
+}
+
+void CeleX5::waitForConfig()
+{
+	m_pConfigQueue->wait();
+}
+
+uint64_t CeleX5::getCoalescedConfigCount()
+{
+	return m_pConfigQueue->getCoalescedCount();
 }
 
-//Enter CFG Mode
+//Enter CFG Mode, the writes up to enterStartMode are one register batch
 void CeleX5::enterCFGMode()
 {
-	wireIn(93, 0, 0xFF);
-	wireIn(90, 1, 0xFF);
+	beginRegisterBatch();
+	writeField(CSR::SOFT_TRIGGER, 0);
+	writeField(CSR::SOFT_RESET, 1);
 }
 
 //Enter Start Mode
 void CeleX5::enterStartMode()
 {
-	wireIn(90, 0, 0xFF);
-	wireIn(93, 1, 0xFF);
+	writeField(CSR::SOFT_RESET, 0);
+	writeField(CSR::SOFT_TRIGGER, 1);
+	endRegisterBatch();
 }
 
 void CeleX5::disableMIPI()
 {
-	wireIn(139, 0, 0xFF);
-	wireIn(140, 0, 0xFF);
-	wireIn(141, 0, 0xFF);
-	wireIn(142, 0, 0xFF);
-	wireIn(143, 0, 0xFF);
-	wireIn(144, 0, 0xFF);
+	for (int i = 0; i < 6; i++)
+		writeField(CSR::MIPI_POWER[i], 0);
 }
 
 void CeleX5::enableMIPI()
 {
-	wireIn(139, 1, 0xFF);
-	wireIn(140, 1, 0xFF);
-	wireIn(141, 1, 0xFF);
-	wireIn(142, 1, 0xFF);
-	wireIn(143, 1, 0xFF);
-	wireIn(144, 1, 0xFF);
+	for (int i = 0; i < 6; i++)
+		writeField(CSR::MIPI_POWER[i], 1);
 }
\ No newline at end of file
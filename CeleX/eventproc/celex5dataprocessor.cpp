@@ -0,0 +1,620 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "../include/celex5/celex5dataprocessor.h"
+#include "hotpixeldetector.h"
+#include "celex5registers.h"
+#include <iostream>
+#include <cstring>
+
+#define PIXEL_BITMAP_SIZE (CELEX5_PIXELS_NUMBER / 8)
+
+CeleX5DataProcessor::CeleX5DataProcessor()
+	: m_emSensorMode(CeleX5::Event_Address_Only_Mode)
+	, m_uiEventPacketFormat(2)
+	, m_iCurrentRow(-1)
+	, m_uiLastRowTime(0)
+	, m_bRowTimeValid(false)
+	, m_uiEventTCounter(0)
+	, m_uiEventCountBeforeRowTime(0)
+	, m_bPixelFilterEnabled(false)
+	, m_pROIMask(NULL)
+	, m_pNewROIFilter(NULL)
+	, m_pNewHotPixelMask(NULL)
+	, m_bIntensityImageEnabled(false)
+{
+	m_pFullPic = new uint8_t[CELEX5_PIXELS_NUMBER];
+	memset(m_pFullPic, 0, CELEX5_PIXELS_NUMBER);
+	m_pPixelFilter = new uint8_t[PIXEL_BITMAP_SIZE];
+	memset(m_pPixelFilter, 0xFF, PIXEL_BITMAP_SIZE);
+	memset(m_arrayRowKept, 1, CELEX5_ROW);
+	m_pROIFilter = new ROIFilter;
+	buildROIFilter(m_pROIFilter);
+	m_pIntensityPic = new uint8_t[CELEX5_PIXELS_NUMBER];
+	memset(m_pIntensityPic, 0, CELEX5_PIXELS_NUMBER);
+	m_pIntensityBackPic = new uint8_t[CELEX5_PIXELS_NUMBER];
+	memset(m_pIntensityBackPic, 0, CELEX5_PIXELS_NUMBER);
+	memset(m_arrayIntensityRowDirty, 0, CELEX5_ROW);
+	m_pHotPixelDetector = new HotPixelDetector;
+}
+
+CeleX5DataProcessor::~CeleX5DataProcessor()
+{
+	if (m_pFullPic)
+	{
+		delete[] m_pFullPic;
+		m_pFullPic = NULL;
+	}
+	if (m_pROIMask)
+	{
+		delete[] m_pROIMask;
+		m_pROIMask = NULL;
+	}
+	if (m_pPixelFilter)
+	{
+		delete[] m_pPixelFilter;
+		m_pPixelFilter = NULL;
+	}
+	if (m_pROIFilter)
+	{
+		delete m_pROIFilter;
+		m_pROIFilter = NULL;
+	}
+	delete m_pNewROIFilter.exchange(NULL);
+	delete[] m_pNewHotPixelMask.exchange(NULL);
+	if (m_pIntensityPic)
+	{
+		delete[] m_pIntensityPic;
+		m_pIntensityPic = NULL;
+	}
+	if (m_pIntensityBackPic)
+	{
+		delete[] m_pIntensityBackPic;
+		m_pIntensityBackPic = NULL;
+	}
+	if (m_pHotPixelDetector)
+	{
+		delete m_pHotPixelDetector;
+		m_pHotPixelDetector = NULL;
+	}
+}
+
+bool CeleX5DataProcessor::processMIPIData(const uint8_t* pData, uint32_t dataSize)
+{
+	if (NULL == pData || dataSize <= MIPI_FRAME_TRAILER_SIZE)
+		return false;
+
+	uint32_t payloadSize = dataSize - MIPI_FRAME_TRAILER_SIZE;
+	ROIFilter* pNewROIFilter = m_pNewROIFilter.exchange(NULL);
+	if (pNewROIFilter)
+	{
+		delete m_pROIFilter;
+		m_pROIFilter = pNewROIFilter;
+	}
+	uint8_t* pNewHotPixelMask = m_pNewHotPixelMask.exchange(NULL);
+	if (pNewHotPixelMask)
+	{
+		m_pHotPixelDetector->setHotPixelMask(pNewHotPixelMask);
+		delete[] pNewHotPixelMask;
+	}
+	if (pNewROIFilter || pNewHotPixelMask)
+		updatePixelFilter();
+	m_emSensorMode = CeleX5::CeleX5Mode(0x07 & pData[payloadSize]);
+	m_vecEventData.clear();
+	m_uiEventCountBeforeRowTime = 0;
+
+	if (m_emSensorMode >= CeleX5::Full_Picture_Mode)
+	{
+		if (!processFullPicData(pData, payloadSize))
+			return false;
+		if (m_bIntensityImageEnabled && CeleX5::Full_Picture_Mode == m_emSensorMode)
+		{
+			memcpy(m_pIntensityBackPic, m_pFullPic, CELEX5_PIXELS_NUMBER);
+			swapIntensityPic(true);
+		}
+	}
+	else
+	{
+		//every frame starts with a row packet
+		m_iCurrentRow = -1;
+		if (0 == m_uiEventPacketFormat)
+		{
+			if (m_bIntensityImageEnabled && CeleX5::Event_Intensity_Mode == m_emSensorMode)
+			{
+				parseEventDataFormat0(pData, payloadSize, m_pIntensityBackPic);
+				swapIntensityPic(false);
+			}
+			else
+			{
+				parseEventDataFormat0(pData, payloadSize, NULL);
+			}
+		}
+		else
+			parseEventDataFormat2(pData, payloadSize);
+		if (!m_bRowTimeValid)
+			m_uiEventCountBeforeRowTime = m_vecEventData.size();
+
+		if (m_pHotPixelDetector->update(m_uiEventTCounter))
+			updatePixelFilter();
+	}
+	return true;
+}
+
+void CeleX5DataProcessor::getEventDataVector(vector<EventData> &vecEvent)
+{
+	//hand over the decoded events and reuse the caller's storage for the next frame
+	vecEvent.swap(m_vecEventData);
+	m_vecEventData.clear();
+}
+
+bool CeleX5DataProcessor::getFullPicBuffer(uint8_t* buffer)
+{
+	if (NULL == buffer)
+		return false;
+	memcpy(buffer, m_pFullPic, CELEX5_PIXELS_NUMBER);
+	return true;
+}
+
+CeleX5::CeleX5Mode CeleX5DataProcessor::getSensorMode()
+{
+	return m_emSensorMode;
+}
+
+void CeleX5DataProcessor::setEventPacketFormat(uint32_t format)
+{
+	if (format != 0 && format != 2)
+	{
+		cout << "CeleX5DataProcessor::setEventPacketFormat: unsupported format " << format << endl;
+		return;
+	}
+	if (format != m_uiEventPacketFormat)
+		resetDecoderState();
+	m_uiEventPacketFormat = format;
+}
+
+uint32_t CeleX5DataProcessor::getEventPacketFormat()
+{
+	return m_uiEventPacketFormat;
+}
+
+void CeleX5DataProcessor::processRegisterWrite(uint32_t address, uint32_t value)
+{
+	if (CSR::EVENT_PACKET_SELECT.highAddr == address)
+		setEventPacketFormat(value);
+}
+
+void CeleX5DataProcessor::resetDecoderState()
+{
+	m_iCurrentRow = -1;
+	m_bRowTimeValid = false;
+	m_vecEventData.clear();
+}
+
+void CeleX5DataProcessor::getDecoderState(DecoderState &state)
+{
+	state.eventTCounter = m_uiEventTCounter;
+	state.lastRowTime = m_uiLastRowTime;
+	state.rowTimeValid = m_bRowTimeValid;
+}
+
+void CeleX5DataProcessor::setDecoderState(const DecoderState &state)
+{
+	m_iCurrentRow = -1;
+	m_uiEventTCounter = state.eventTCounter;
+	m_uiLastRowTime = state.lastRowTime;
+	m_bRowTimeValid = state.rowTimeValid;
+}
+
+uint32_t CeleX5DataProcessor::getEventCountBeforeRowTime()
+{
+	return m_uiEventCountBeforeRowTime;
+}
+
+uint32_t CeleX5DataProcessor::getRowTimePeriod()
+{
+	return 0 == m_uiEventPacketFormat ? 0x10000 : 0x1000;
+}
+
+void CeleX5DataProcessor::addROI(uint32_t col, uint32_t row, uint32_t width, uint32_t height)
+{
+	if (col >= CELEX5_COL || row >= CELEX5_ROW || 0 == width || 0 == height)
+	{
+		cout << "CeleX5DataProcessor::addROI: ROI is out of the pixel array!" << endl;
+		return;
+	}
+	if (col + width > CELEX5_COL)
+		width = CELEX5_COL - col;
+	if (row + height > CELEX5_ROW)
+		height = CELEX5_ROW - row;
+
+	lock_guard<mutex> lock(m_mutexROI);
+	m_vecROIRect.push_back(col);
+	m_vecROIRect.push_back(row);
+	m_vecROIRect.push_back(width);
+	m_vecROIRect.push_back(height);
+	publishROIFilter();
+}
+
+void CeleX5DataProcessor::clearROI()
+{
+	lock_guard<mutex> lock(m_mutexROI);
+	m_vecROIRect.clear();
+	publishROIFilter();
+}
+
+void CeleX5DataProcessor::setROIMask(const uint8_t* pMask)
+{
+	lock_guard<mutex> lock(m_mutexROI);
+	if (NULL == pMask)
+	{
+		if (m_pROIMask)
+		{
+			delete[] m_pROIMask;
+			m_pROIMask = NULL;
+		}
+	}
+	else
+	{
+		if (NULL == m_pROIMask)
+			m_pROIMask = new uint8_t[PIXEL_BITMAP_SIZE];
+		memcpy(m_pROIMask, pMask, PIXEL_BITMAP_SIZE);
+	}
+	publishROIFilter();
+}
+
+bool CeleX5DataProcessor::isROIEnabled()
+{
+	lock_guard<mutex> lock(m_mutexROI);
+	return !m_vecROIRect.empty() || NULL != m_pROIMask;
+}
+
+void CeleX5DataProcessor::setIntensityImageEnabled(bool enable)
+{
+	m_bIntensityImageEnabled = enable;
+}
+
+bool CeleX5DataProcessor::isIntensityImageEnabled()
+{
+	return m_bIntensityImageEnabled;
+}
+
+// Publish the decoded intensity image: only the pointers are swapped under the lock, so
+// getIntensityPicBuffer never waits for a frame to be decoded. The events of the next frame
+// update the image, so the back buffer catches up with the published one: only the rows
+// written since the last swap differ. Only this thread writes the buffers, so they are
+// copied without the lock.
+void CeleX5DataProcessor::swapIntensityPic(bool bWholePic)
+{
+	{
+		lock_guard<mutex> lock(m_mutexIntensityPic);
+		swap(m_pIntensityPic, m_pIntensityBackPic);
+	}
+	if (bWholePic)
+	{
+		memcpy(m_pIntensityBackPic, m_pIntensityPic, CELEX5_PIXELS_NUMBER);
+	}
+	else
+	{
+		for (size_t i = 0; i < m_vecIntensityDirtyRow.size(); i++)
+		{
+			uint32_t offset = m_vecIntensityDirtyRow[i] * CELEX5_COL;
+			memcpy(m_pIntensityBackPic + offset, m_pIntensityPic + offset, CELEX5_COL);
+		}
+	}
+	for (size_t i = 0; i < m_vecIntensityDirtyRow.size(); i++)
+		m_arrayIntensityRowDirty[m_vecIntensityDirtyRow[i]] = 0;
+	m_vecIntensityDirtyRow.clear();
+}
+
+bool CeleX5DataProcessor::getIntensityPicBuffer(uint8_t* buffer)
+{
+	if (NULL == buffer)
+		return false;
+	lock_guard<mutex> lock(m_mutexIntensityPic);
+	memcpy(buffer, m_pIntensityPic, CELEX5_PIXELS_NUMBER);
+	return true;
+}
+
+void CeleX5DataProcessor::setHotPixelDetectionEnabled(bool enable)
+{
+	m_pHotPixelDetector->setDetectionEnabled(enable);
+}
+
+bool CeleX5DataProcessor::isHotPixelDetectionEnabled()
+{
+	return m_pHotPixelDetector->isDetectionEnabled();
+}
+
+void CeleX5DataProcessor::setHotPixelThreshold(uint32_t count, uint32_t windowTime)
+{
+	m_pHotPixelDetector->setThreshold(count, windowTime);
+}
+
+uint32_t CeleX5DataProcessor::getHotPixelCount()
+{
+	return m_pHotPixelDetector->getHotPixelCount();
+}
+
+void CeleX5DataProcessor::clearHotPixelMask()
+{
+	uint8_t* pMask = new uint8_t[PIXEL_BITMAP_SIZE];
+	memset(pMask, 0, PIXEL_BITMAP_SIZE);
+	delete[] m_pNewHotPixelMask.exchange(pMask);
+}
+
+bool CeleX5DataProcessor::saveHotPixelMask(const string& filePath)
+{
+	return m_pHotPixelDetector->saveHotPixelMask(filePath);
+}
+
+// The file is read on the calling thread, the decoding thread takes the mask over
+bool CeleX5DataProcessor::loadHotPixelMask(const string& filePath)
+{
+	uint8_t* pMask = new uint8_t[PIXEL_BITMAP_SIZE];
+	if (!HotPixelDetector::readHotPixelMask(filePath, pMask))
+	{
+		delete[] pMask;
+		return false;
+	}
+	delete[] m_pNewHotPixelMask.exchange(pMask);
+	return true;
+}
+
+// Merge the rectangles and the ROI mask into one bitmap, called with m_mutexROI held.
+// Rows are kept by the ROI only: a row whose kept pixels are all hot is still parsed,
+// so that its events are counted and the pixels can recover
+void CeleX5DataProcessor::buildROIFilter(ROIFilter* pFilter)
+{
+	uint8_t* pPixelKept = pFilter->pixelKept;
+	pFilter->enabled = !m_vecROIRect.empty() || NULL != m_pROIMask;
+	if (m_vecROIRect.empty())
+	{
+		memset(pPixelKept, 0xFF, PIXEL_BITMAP_SIZE);
+	}
+	else
+	{
+		memset(pPixelKept, 0, PIXEL_BITMAP_SIZE);
+		for (size_t i = 0; i + 3 < m_vecROIRect.size(); i += 4)
+		{
+			uint32_t col = m_vecROIRect[i];
+			uint32_t row = m_vecROIRect[i + 1];
+			uint32_t width = m_vecROIRect[i + 2];
+			uint32_t height = m_vecROIRect[i + 3];
+			for (uint32_t r = row; r < row + height; r++)
+			{
+				for (uint32_t c = col; c < col + width; c++)
+				{
+					uint32_t index = r * CELEX5_COL + c;
+					pPixelKept[index >> 3] |= (1 << (index & 7));
+				}
+			}
+		}
+	}
+	if (m_pROIMask)
+	{
+		for (int i = 0; i < PIXEL_BITMAP_SIZE; i++)
+			pPixelKept[i] &= m_pROIMask[i];
+	}
+	//CELEX5_COL is a multiple of 8, so every row occupies whole bytes
+	for (int r = 0; r < CELEX5_ROW; r++)
+	{
+		const uint8_t* pRow = pPixelKept + r * CELEX5_COL / 8;
+		pFilter->rowKept[r] = 0;
+		for (int i = 0; i < CELEX5_COL / 8; i++)
+		{
+			if (pRow[i])
+			{
+				pFilter->rowKept[r] = 1;
+				break;
+			}
+		}
+	}
+}
+
+// Hand a new ROI filter over to the decoding thread, called with m_mutexROI held.
+// A filter published before and not taken over yet is replaced
+void CeleX5DataProcessor::publishROIFilter()
+{
+	ROIFilter* pFilter = new ROIFilter;
+	buildROIFilter(pFilter);
+	delete m_pNewROIFilter.exchange(pFilter);
+}
+
+// Merge the ROI and the hot pixel mask into one bitmap on the decoding thread, so that
+// the decoder only tests a row flag per row packet and one bit per column packet
+void CeleX5DataProcessor::updatePixelFilter()
+{
+	bool bHotPixelMask = m_pHotPixelDetector->getHotPixelCount() > 0;
+	m_bPixelFilterEnabled = m_pROIFilter->enabled || bHotPixelMask;
+	memcpy(m_pPixelFilter, m_pROIFilter->pixelKept, PIXEL_BITMAP_SIZE);
+	memcpy(m_arrayRowKept, m_pROIFilter->rowKept, CELEX5_ROW);
+	if (bHotPixelMask)
+	{
+		const uint8_t* pHotPixelMask = m_pHotPixelDetector->getHotPixelMask();
+		for (int i = 0; i < PIXEL_BITMAP_SIZE; i++)
+			m_pPixelFilter[i] &= ~pHotPixelMask[i];
+	}
+}
+
+void CeleX5DataProcessor::updateRowTimeStamp(uint32_t rowTime, uint32_t period)
+{
+	if (!m_bRowTimeValid)
+	{
+		m_bRowTimeValid = true; //first row time after a reset, EventData::t carries on from here
+		m_uiEventCountBeforeRowTime = m_vecEventData.size();
+	}
+	else if (rowTime >= m_uiLastRowTime)
+		m_uiEventTCounter += rowTime - m_uiLastRowTime;
+	else
+		m_uiEventTCounter += rowTime + period - m_uiLastRowTime;
+	m_uiLastRowTime = rowTime;
+}
+
+// Full frame: two 12-bit pixels in every three bytes, one row every CELEX5_COL * 3 / 2 bytes
+// A frame shorter than a whole picture is rejected, the full picture keeps the last frame
+bool CeleX5DataProcessor::processFullPicData(const uint8_t* pData, uint32_t dataSize)
+{
+	const uint32_t rowBytes = CELEX5_COL * 3 / 2;
+	if (dataSize < MIPI_FULL_PIC_FRAME_SIZE)
+	{
+		cout << "CeleX5DataProcessor::processFullPicData: incomplete full frame, size = " << dataSize << endl;
+		return false;
+	}
+	for (int row = 0; row < CELEX5_ROW; row++)
+	{
+		uint8_t* pPic = m_pFullPic + row * CELEX5_COL;
+		if (m_bPixelFilterEnabled && !m_arrayRowKept[row])
+		{
+			memset(pPic, 0, CELEX5_COL);
+			continue;
+		}
+		const uint8_t* pRow = pData + row * rowBytes;
+		for (int col = 0; col < CELEX5_COL; col += 2)
+		{
+			uint32_t adc1 = (pRow[0] << 4) + (0x0F & pRow[2]);
+			uint32_t adc2 = (pRow[1] << 4) + ((0xF0 & pRow[2]) >> 4);
+			pPic[col] = 255 - (adc1 >> 4);
+			pPic[col + 1] = 255 - (adc2 >> 4);
+			pRow += 3;
+		}
+		if (m_bPixelFilterEnabled)
+		{
+			for (int col = 0; col < CELEX5_COL; col++)
+			{
+				if (!isPixelKept(row, col))
+					pPic[col] = 0;
+			}
+		}
+	}
+	return true;
+}
+
+// EVENT_PACKET_SELECT = 0: packet0 = byte0..2 + byte3[3:0], packet1 = byte4..6 + byte3[7:4]
+// pIntensityPic: if not NULL, the pixel of every event is set to its ADC value
+void CeleX5DataProcessor::parseEventDataFormat0(const uint8_t* pData, uint32_t dataSize, uint8_t* pIntensityPic)
+{
+	HotPixelDetector* pHotPixelDetector = m_pHotPixelDetector->isDetectionEnabled() ? m_pHotPixelDetector : NULL;
+	bool bRowKept = false; //the current row is inside the ROI
+	bool bRowParsed = false; //kept, or counted for the hot pixel detection
+	for (uint32_t i = 0; i + 7 <= dataSize; i += 7)
+	{
+		const uint8_t* p = pData + i;
+		//both packets are column packets of a row outside every ROI: drop them unparsed
+		if (!bRowParsed && 0 == (0x22 & p[3]))
+			continue;
+
+		uint32_t packet[2];
+		packet[0] = (p[0] << 20) + (p[1] << 12) + (p[2] << 4) + (0x0F & p[3]);
+		packet[1] = (p[4] << 20) + (p[5] << 12) + (p[6] << 4) + ((0xF0 & p[3]) >> 4);
+		for (int j = 0; j < 2; j++)
+		{
+			uint32_t dataID = 0x03 & packet[j];
+			if (0x02 == dataID) //row packet
+			{
+				int row = (packet[j] >> 2) & 0x3FF;
+				m_iCurrentRow = row < CELEX5_ROW ? row : -1;
+				bRowKept = m_iCurrentRow >= 0 && (!m_bPixelFilterEnabled || m_arrayRowKept[m_iCurrentRow]);
+				bRowParsed = bRowKept || (m_iCurrentRow >= 0 && pHotPixelDetector);
+				updateRowTimeStamp((packet[j] >> 12) & 0xFFFF, 0x10000);
+			}
+			else if (0x01 == dataID && bRowParsed) //col packet
+			{
+				uint32_t col = (packet[j] >> 2) & 0x7FF;
+				if (col >= CELEX5_COL)
+					continue;
+				//hot pixels are still counted after being masked, so that they can recover;
+				//so are the pixels outside the ROI, should it change
+				if (pHotPixelDetector)
+					pHotPixelDetector->countEvent(m_iCurrentRow * CELEX5_COL + col);
+				if (!bRowKept || (m_bPixelFilterEnabled && !isPixelKept(m_iCurrentRow, col)))
+					continue;
+				EventData eventData;
+				eventData.col = col;
+				eventData.row = m_iCurrentRow;
+				eventData.brightness = (packet[j] >> 13) & 0xFFF;
+				eventData.polarity = 0;
+				eventData.t = m_uiEventTCounter;
+				m_vecEventData.push_back(eventData);
+				if (pIntensityPic)
+				{
+					pIntensityPic[m_iCurrentRow * CELEX5_COL + col] = 255 - (eventData.brightness >> 4);
+					if (!m_arrayIntensityRowDirty[m_iCurrentRow])
+					{
+						m_arrayIntensityRowDirty[m_iCurrentRow] = 1;
+						m_vecIntensityDirtyRow.push_back(m_iCurrentRow);
+					}
+				}
+			}
+		}
+	}
+}
+
+// EVENT_PACKET_SELECT = 2: byte0..3 hold packet[13:6] of packet0..3,
+// byte4..6 hold packet[5:0] of packet0..3 from the lowest bit up
+void CeleX5DataProcessor::parseEventDataFormat2(const uint8_t* pData, uint32_t dataSize)
+{
+	HotPixelDetector* pHotPixelDetector = m_pHotPixelDetector->isDetectionEnabled() ? m_pHotPixelDetector : NULL;
+	bool bRowKept = false; //the current row is inside the ROI
+	bool bRowParsed = false; //kept, or counted for the hot pixel detection
+	for (uint32_t i = 0; i + 7 <= dataSize; i += 7)
+	{
+		const uint8_t* p = pData + i;
+		//none of the four packets is a row or time packet and the current row
+		//is outside every ROI: drop the whole group unparsed
+		if (!bRowParsed && 0 == ((0x82 & p[4]) | (0x20 & p[5]) | (0x08 & p[6])))
+			continue;
+
+		uint32_t packet[4];
+		packet[0] = (p[0] << 6) + (0x3F & p[4]);
+		packet[1] = (p[1] << 6) + ((0xC0 & p[4]) >> 6) + ((0x0F & p[5]) << 2);
+		packet[2] = (p[2] << 6) + ((0xF0 & p[5]) >> 4) + ((0x03 & p[6]) << 4);
+		packet[3] = (p[3] << 6) + ((0xFC & p[6]) >> 2);
+		for (int j = 0; j < 4; j++)
+		{
+			uint32_t dataID = 0x03 & packet[j];
+			if (0x02 == dataID) //row packet
+			{
+				int row = (packet[j] >> 2) & 0x3FF;
+				m_iCurrentRow = row < CELEX5_ROW ? row : -1;
+				bRowKept = m_iCurrentRow >= 0 && (!m_bPixelFilterEnabled || m_arrayRowKept[m_iCurrentRow]);
+				bRowParsed = bRowKept || (m_iCurrentRow >= 0 && pHotPixelDetector);
+			}
+			else if (0x03 == dataID) //time packet
+			{
+				updateRowTimeStamp(packet[j] >> 2, 0x1000);
+			}
+			else if (0x01 == dataID && bRowParsed) //col packet
+			{
+				uint32_t col = (packet[j] >> 2) & 0x7FF;
+				if (col >= CELEX5_COL)
+					continue;
+				//hot pixels are still counted after being masked, so that they can recover;
+				//so are the pixels outside the ROI, should it change
+				if (pHotPixelDetector)
+					pHotPixelDetector->countEvent(m_iCurrentRow * CELEX5_COL + col);
+				if (!bRowKept || (m_bPixelFilterEnabled && !isPixelKept(m_iCurrentRow, col)))
+					continue;
+				EventData eventData;
+				eventData.col = col;
+				eventData.row = m_iCurrentRow;
+				eventData.brightness = 0;
+				eventData.polarity = 0;
+				eventData.t = m_uiEventTCounter;
+				m_vecEventData.push_back(eventData);
+			}
+		}
+	}
+}
@@ -0,0 +1,156 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "../include/celex5/celex5frameslicer.h"
+
+CeleX5FrameSlicer::CeleX5FrameSlicer()
+	: m_uiTargetEventCount(100000)
+	, m_uiAreaThreshold(0)
+	, m_uiMaxLatency(0)
+	, m_uiTileShift(5)
+	, m_uiTilesPerRow(0)
+{
+	setAreaActivityThreshold(0, 32);
+	m_currentFrame.startT = 0;
+	m_currentFrame.endT = 0;
+	m_currentFrame.reason = Slice_Flush;
+}
+
+CeleX5FrameSlicer::~CeleX5FrameSlicer()
+{
+}
+
+void CeleX5FrameSlicer::setTargetEventCount(uint32_t count)
+{
+	m_uiTargetEventCount = count;
+}
+
+uint32_t CeleX5FrameSlicer::getTargetEventCount()
+{
+	return m_uiTargetEventCount;
+}
+
+void CeleX5FrameSlicer::setAreaActivityThreshold(uint32_t count, uint32_t tileSize)
+{
+	m_uiAreaThreshold = count;
+
+	uint32_t shift = 0;
+	while ((2u << shift) <= tileSize && shift < 9)
+		shift++;
+	m_uiTileShift = shift;
+	m_uiTilesPerRow = ((CELEX5_COL - 1) >> shift) + 1;
+	uint32_t tilesPerCol = ((CELEX5_ROW - 1) >> shift) + 1;
+
+	//the open frame keeps its events, but its tile counts start over
+	m_vecTileCount.assign(m_uiTilesPerRow * tilesPerCol, 0);
+	m_vecTouchedTile.clear();
+}
+
+uint32_t CeleX5FrameSlicer::getAreaActivityThreshold()
+{
+	return m_uiAreaThreshold;
+}
+
+void CeleX5FrameSlicer::setMaxLatency(uint32_t time)
+{
+	m_uiMaxLatency = time;
+}
+
+uint32_t CeleX5FrameSlicer::getMaxLatency()
+{
+	return m_uiMaxLatency;
+}
+
+void CeleX5FrameSlicer::addEvents(const vector<EventData> &vecEvent)
+{
+	for (auto itr = vecEvent.begin(); itr != vecEvent.end(); itr++)
+	{
+		const EventData& eventData = *itr;
+		if (m_uiMaxLatency > 0 && !m_currentFrame.events.empty() &&
+			eventData.t - m_currentFrame.startT >= m_uiMaxLatency)
+		{
+			closeFrame(Slice_Max_Latency);
+		}
+		if (m_currentFrame.events.empty())
+			m_currentFrame.startT = eventData.t;
+		m_currentFrame.events.push_back(eventData);
+		m_currentFrame.endT = eventData.t;
+
+		if (m_uiAreaThreshold > 0)
+		{
+			uint32_t tile = (eventData.row >> m_uiTileShift) * m_uiTilesPerRow + (eventData.col >> m_uiTileShift);
+			uint32_t& count = m_vecTileCount[tile];
+			if (0 == count)
+				m_vecTouchedTile.push_back(tile);
+			if (++count >= m_uiAreaThreshold)
+			{
+				closeFrame(Slice_Area_Activity);
+				continue;
+			}
+		}
+		if (m_uiTargetEventCount > 0 && m_currentFrame.events.size() >= m_uiTargetEventCount)
+			closeFrame(Slice_Event_Count);
+	}
+}
+
+void CeleX5FrameSlicer::checkLatency(uint32_t t)
+{
+	if (m_uiMaxLatency > 0 && !m_currentFrame.events.empty() &&
+		t - m_currentFrame.startT >= m_uiMaxLatency)
+	{
+		closeFrame(Slice_Max_Latency);
+	}
+}
+
+void CeleX5FrameSlicer::flush()
+{
+	if (!m_currentFrame.events.empty())
+		closeFrame(Slice_Flush);
+}
+
+bool CeleX5FrameSlicer::getFrame(EventFrame &frame)
+{
+	if (m_queueFrame.empty())
+		return false;
+	frame.events.swap(m_queueFrame.front().events);
+	frame.startT = m_queueFrame.front().startT;
+	frame.endT = m_queueFrame.front().endT;
+	frame.reason = m_queueFrame.front().reason;
+	m_queueFrame.pop_front();
+	return true;
+}
+
+uint32_t CeleX5FrameSlicer::getFrameCount()
+{
+	return m_queueFrame.size();
+}
+
+// Only the tiles touched by the frame are cleared, so the cost stays proportional to its events
+void CeleX5FrameSlicer::closeFrame(SliceReason reason)
+{
+	m_queueFrame.push_back(EventFrame());
+	EventFrame& frame = m_queueFrame.back();
+	frame.events.swap(m_currentFrame.events);
+	frame.startT = m_currentFrame.startT;
+	frame.endT = m_currentFrame.endT;
+	frame.reason = reason;
+	if (m_uiTargetEventCount > 0)
+		m_currentFrame.events.reserve(m_uiTargetEventCount);
+
+	for (auto itr = m_vecTouchedTile.begin(); itr != m_vecTouchedTile.end(); itr++)
+		m_vecTileCount[*itr] = 0;
+	m_vecTouchedTile.clear();
+}
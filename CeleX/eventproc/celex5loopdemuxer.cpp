@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "../include/celex5/celex5loopdemuxer.h"
+#include "../include/celex5/celex5dataprocessor.h"
+#include "../base/dataqueue.h"
+#include <iostream>
+
+CeleX5LoopDemuxer::CeleX5LoopDemuxer(uint32_t queueCapacity)
+	: m_emLastMode(CeleX5::Unknown_Mode)
+	, m_ulSequence(0)
+	, m_ulModeTransitionCount(0)
+{
+	for (int i = 0; i < LOOP_DEMUXER_MODE_NUMBER; i++)
+	{
+		m_pQueue[i] = NULL;
+		m_pDataProcessor[i] = NULL;
+		if (isValidMode(CeleX5::CeleX5Mode(i)))
+		{
+			m_pQueue[i] = new DataQueue(queueCapacity);
+			m_pDataProcessor[i] = new CeleX5DataProcessor;
+		}
+	}
+}
+
+CeleX5LoopDemuxer::~CeleX5LoopDemuxer()
+{
+	stop();
+	for (int i = 0; i < LOOP_DEMUXER_MODE_NUMBER; i++)
+	{
+		if (m_pQueue[i])
+		{
+			delete m_pQueue[i];
+			m_pQueue[i] = NULL;
+		}
+		if (m_pDataProcessor[i])
+		{
+			delete m_pDataProcessor[i];
+			m_pDataProcessor[i] = NULL;
+		}
+	}
+}
+
+bool CeleX5LoopDemuxer::pushMIPIData(vector<uint8_t> &buffer)
+{
+	if (buffer.size() <= MIPI_FRAME_TRAILER_SIZE)
+		return false;
+
+	CeleX5::MIPIPacket packet;
+	packet.buffer = make_shared<vector<uint8_t>>();
+	packet.buffer->swap(buffer);
+	packet.data = packet.buffer->data();
+	packet.size = packet.buffer->size();
+	packet.mode = CeleX5::CeleX5Mode(0x07 & packet.data[packet.size - 1]);
+	packet.sequence = m_ulSequence;
+	return pushMIPIPacket(packet);
+}
+
+bool CeleX5LoopDemuxer::pushMIPIPacket(CeleX5::MIPIPacket &packet)
+{
+	if (!isValidMode(packet.mode))
+	{
+		cout << "CeleX5LoopDemuxer::pushMIPIPacket: unknown sensor mode " << packet.mode << endl;
+		return false;
+	}
+	if (packet.mode != m_emLastMode)
+	{
+		if (m_emLastMode != CeleX5::Unknown_Mode)
+			m_ulModeTransitionCount++;
+		m_emLastMode = packet.mode;
+	}
+	m_ulSequence = packet.sequence + 1;
+	return m_pQueue[packet.mode]->push(packet);
+}
+
+bool CeleX5LoopDemuxer::popMIPIPacket(CeleX5::CeleX5Mode mode, CeleX5::MIPIPacket &packet, uint32_t timeoutMs)
+{
+	if (!isValidMode(mode))
+		return false;
+	return m_pQueue[mode]->pop(packet, timeoutMs);
+}
+
+bool CeleX5LoopDemuxer::processNextPacket(CeleX5::CeleX5Mode mode, uint32_t timeoutMs)
+{
+	CeleX5::MIPIPacket packet;
+	if (!popMIPIPacket(mode, packet, timeoutMs))
+		return false;
+	return m_pDataProcessor[mode]->processMIPIData(packet.data, packet.size);
+}
+
+CeleX5DataProcessor* CeleX5LoopDemuxer::getDataProcessor(CeleX5::CeleX5Mode mode)
+{
+	if (!isValidMode(mode))
+		return NULL;
+	return m_pDataProcessor[mode];
+}
+
+void CeleX5LoopDemuxer::stop()
+{
+	for (int i = 0; i < LOOP_DEMUXER_MODE_NUMBER; i++)
+	{
+		if (m_pQueue[i])
+			m_pQueue[i]->stop();
+	}
+}
+
+void CeleX5LoopDemuxer::reset()
+{
+	for (int i = 0; i < LOOP_DEMUXER_MODE_NUMBER; i++)
+	{
+		if (m_pQueue[i])
+			m_pQueue[i]->clear();
+		if (m_pDataProcessor[i])
+			m_pDataProcessor[i]->resetDecoderState();
+	}
+	m_emLastMode = CeleX5::Unknown_Mode;
+}
+
+uint64_t CeleX5LoopDemuxer::getModeTransitionCount()
+{
+	return m_ulModeTransitionCount;
+}
+
+uint64_t CeleX5LoopDemuxer::getDroppedPacketCount(CeleX5::CeleX5Mode mode)
+{
+	if (!isValidMode(mode))
+		return 0;
+	return m_pQueue[mode]->droppedCount();
+}
+
+bool CeleX5LoopDemuxer::isValidMode(CeleX5::CeleX5Mode mode)
+{
+	return mode >= CeleX5::Event_Address_Only_Mode && mode <= CeleX5::Full_Optical_Flow_M_Mode && mode != 5;
+}
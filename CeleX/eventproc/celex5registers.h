@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#ifndef CELEX5REGISTERS_H
+#define CELEX5REGISTERS_H
+
+#include <stdint.h>
+
+// A field of the CeleX5 register file: one 8-bit register, or a high and a low register
+// holding the upper and the lower 8 bits of the value. Everything is constexpr, so for a
+// constant value the range check and the split are resolved at compile time.
+struct RegisterField
+{
+	const char* name;
+	uint16_t    highAddr;
+	int16_t     lowAddr; //-1: the field is a single register
+	uint32_t    minValue;
+	uint32_t    maxValue;
+
+	constexpr bool isSplit() const { return lowAddr >= 0; }
+	constexpr bool isInRange(uint32_t value) const { return value >= minValue && value <= maxValue; }
+	constexpr uint32_t clamp(uint32_t value) const
+	{
+		return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+	}
+	constexpr uint32_t highValue(uint32_t value) const { return isSplit() ? value >> 8 : value; }
+	constexpr uint32_t lowValue(uint32_t value) const { return 0xFF & value; }
+};
+
+// The registers the SDK writes itself, addresses and ranges as in CeleX5_Commands.xml
+namespace CSR
+{
+	//------- sensor core parameters -------
+	constexpr RegisterField BIAS_EVT_VL = { "BIAS_EVT_VL", 2, 3, 0, 1023 };
+	constexpr RegisterField BIAS_EVT_VH = { "BIAS_EVT_VH", 6, 7, 0, 1023 };
+	constexpr RegisterField BIAS_BRT_I = { "BIAS_BRT_I", 22, 23, 0, 1023 };
+	constexpr RegisterField COL_GAIN = { "COL_GAIN", 45, -1, 0, 3 };
+
+	//------- sensor operation mode control -------
+	constexpr RegisterField SENSOR_MODE[3] = {
+		{ "SENSOR_MODE_1", 53, -1, 0, 7 },
+		{ "SENSOR_MODE_2", 54, -1, 0, 7 },
+		{ "SENSOR_MODE_3", 55, -1, 0, 7 } };
+	constexpr RegisterField EVENT_DURATION = { "EVENT_DURATION", 58, 57, 0, 1023 };
+	constexpr RegisterField PICTURE_NUMBER[5] = {
+		{ "PICTURE_NUMBER_1", 59, -1, 0, 255 },
+		{ "PICTURE_NUMBER_2", 60, -1, 0, 255 },
+		{ "PICTURE_NUMBER_3", 61, -1, 0, 255 },
+		{ "PICTURE_NUMBER_4", 62, -1, 0, 255 },
+		{ "PICTURE_NUMBER_5", 63, -1, 0, 255 } };
+	constexpr RegisterField SENSOR_MODE_SELECT = { "SENSOR_MODE_SELECT", 64, -1, 0, 1 };
+
+	//------- sensor data transfer -------
+	constexpr RegisterField EVENT_PACKET_SELECT = { "EVENT_PACKET_SELECT", 73, -1, 0, 3 };
+
+	//------- sensor control -------
+	constexpr RegisterField SOFT_RESET = { "SOFT_RESET", 90, -1, 0, 1 };
+	constexpr RegisterField SOFT_TRIGGER = { "SOFT_TRIGGER", 93, -1, 0, 1 };
+	constexpr RegisterField PADDR_EN = { "PADDR_EN", 94, -1, 0, 1 };
+
+	//------- MIPI -------
+	constexpr RegisterField MIPI_PLL_DIV_I = { "MIPI_PLL_DIV_I", 113, -1, 0, 3 };
+	constexpr RegisterField MIPI_PLL_DIV_N = { "MIPI_PLL_DIV_N", 115, 114, 0, 511 };
+	//switched off and on around a change of the MIPI parameters, in this order
+	constexpr RegisterField MIPI_POWER[6] = {
+		{ "MIPI_NPOWD_PLL", 139, -1, 0, 1 },
+		{ "MIPI_NPOWD_BGR", 140, -1, 0, 1 },
+		{ "MIPI_NRSET_PLL", 141, -1, 0, 1 },
+		{ "MIPI_NPOWD_PHY", 142, -1, 0, 1 },
+		{ "MIPI_NRSET_PHY", 143, -1, 0, 1 },
+		{ "MIPI_NDIS_PHY", 144, -1, 0, 1 } };
+
+	//------- PLL -------
+	constexpr RegisterField PLL_PD_B = { "PLL_PD_B", 150, -1, 0, 1 };
+	constexpr RegisterField PLL_FOUT_DIV1 = { "PLL_FOUT_DIV1", 151, -1, 0, 3 };
+	constexpr RegisterField PLL_FOUT_DIV2 = { "PLL_FOUT_DIV2", 152, -1, 0, 3 };
+	constexpr RegisterField PLL_DIV_N = { "PLL_DIV_N", 159, -1, 12, 127 };
+	constexpr RegisterField PLL_DIV_L = { "PLL_DIV_L", 160, -1, 0, 15 };
+
+	//------- auto ISP -------
+	constexpr RegisterField AUTOISP_PROFILE_ADDR = { "AUTOISP_PROFILE_ADDR", 220, -1, 0, 15 };
+	constexpr RegisterField AUTOISP_BRT_EN = { "AUTOISP_BRT_EN", 221, -1, 0, 1 };
+	constexpr RegisterField AUTOISP_TEM_EN = { "AUTOISP_TEM_EN", 222, -1, 0, 1 };
+	constexpr RegisterField AUTOISP_TRIGGER = { "AUTOISP_TRIGGER", 223, -1, 0, 1 };
+	constexpr RegisterField AUTOISP_REFRESH_TIME = { "AUTOISP_REFRESH_TIME", 225, 224, 0, 4095 };
+	constexpr RegisterField AUTOISP_BRT_VALUE = { "AUTOISP_BRT_VALUE", 233, 232, 0, 4095 };
+	constexpr RegisterField AUTOISP_BRT_THRES[3] = {
+		{ "AUTOISP_BRT_THRES1", 235, 234, 0, 4095 },
+		{ "AUTOISP_BRT_THRES2", 237, 236, 0, 4095 },
+		{ "AUTOISP_BRT_THRES3", 239, 238, 0, 4095 } };
+
+	//------- not in CeleX5_Commands.xml -------
+	constexpr RegisterField ALS_CONTROL = { "ALS_CONTROL", 254, -1, 0, 2 }; //0: ALS enabled, 2: disabled
+}
+
+#endif // CELEX5REGISTERS_H
@@ -0,0 +1,219 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "hotpixeldetector.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <vector>
+
+#define HOT_PIXEL_MASK_SIZE (CELEX5_PIXELS_NUMBER / 8)
+#define HOT_PIXEL_FILE_MAGIC "CX5HOTPX"
+
+HotPixelDetector::HotPixelDetector()
+	: m_pCurrentCount(NULL)
+	, m_pLastCount(NULL)
+	, m_bDetectionEnabled(false)
+	, m_uiThresholdCount(1000)
+	, m_uiWindowTime(HARD_TIMER_CYCLE)
+	, m_uiHalfWindowStartT(0)
+	, m_bHalfWindowStarted(false)
+	, m_bLastCountValid(false)
+	, m_uiHotPixelCount(0)
+{
+	m_pHotPixelMask = new uint8_t[HOT_PIXEL_MASK_SIZE];
+	memset(m_pHotPixelMask, 0, HOT_PIXEL_MASK_SIZE);
+}
+
+HotPixelDetector::~HotPixelDetector()
+{
+	if (m_pCurrentCount)
+	{
+		delete[] m_pCurrentCount;
+		m_pCurrentCount = NULL;
+	}
+	if (m_pLastCount)
+	{
+		delete[] m_pLastCount;
+		m_pLastCount = NULL;
+	}
+	if (m_pHotPixelMask)
+	{
+		delete[] m_pHotPixelMask;
+		m_pHotPixelMask = NULL;
+	}
+}
+
+void HotPixelDetector::setThreshold(uint32_t count, uint32_t windowTime)
+{
+	if (count < 1 || windowTime < 2)
+	{
+		cout << "HotPixelDetector::setThreshold: invalid threshold!" << endl;
+		return;
+	}
+	m_uiThresholdCount = count;
+	m_uiWindowTime = windowTime;
+	if (m_pCurrentCount)
+		resetCount();
+}
+
+uint32_t HotPixelDetector::getThresholdCount()
+{
+	return m_uiThresholdCount;
+}
+
+uint32_t HotPixelDetector::getWindowTime()
+{
+	return m_uiWindowTime;
+}
+
+void HotPixelDetector::setDetectionEnabled(bool enable)
+{
+	if (enable && NULL == m_pCurrentCount)
+	{
+		m_pCurrentCount = new uint16_t[CELEX5_PIXELS_NUMBER];
+		m_pLastCount = new uint16_t[CELEX5_PIXELS_NUMBER];
+	}
+	if (enable && !m_bDetectionEnabled)
+		resetCount();
+	m_bDetectionEnabled = enable;
+}
+
+bool HotPixelDetector::isDetectionEnabled()
+{
+	return m_bDetectionEnabled;
+}
+
+bool HotPixelDetector::update(uint32_t t)
+{
+	if (!m_bDetectionEnabled)
+		return false;
+	//restart the counting when t went backwards, e.g. after the decoder state was reset:
+	//the window would end at once and judge the pixels on a partial count
+	if (m_bHalfWindowStarted && t < m_uiHalfWindowStartT)
+		resetCount();
+	if (!m_bHalfWindowStarted)
+	{
+		m_uiHalfWindowStartT = t;
+		m_bHalfWindowStarted = true;
+		return false;
+	}
+	if (t - m_uiHalfWindowStartT < m_uiWindowTime / 2)
+		return false;
+
+	//the mask is only judged on a full window, so a loaded mask survives the first half window
+	bool bChanged = false;
+	uint32_t hotPixelCount = 0;
+	for (int i = 0; i < CELEX5_PIXELS_NUMBER && m_bLastCountValid; i++)
+	{
+		bool bHot = uint32_t(m_pCurrentCount[i]) + m_pLastCount[i] >= m_uiThresholdCount;
+		uint8_t bit = 1 << (i & 7);
+		if (bHot != ((m_pHotPixelMask[i >> 3] & bit) != 0))
+		{
+			m_pHotPixelMask[i >> 3] ^= bit;
+			bChanged = true;
+		}
+		if (bHot)
+			hotPixelCount++;
+	}
+	if (m_bLastCountValid)
+		m_uiHotPixelCount = hotPixelCount;
+
+	uint16_t* pTemp = m_pLastCount;
+	m_pLastCount = m_pCurrentCount;
+	m_pCurrentCount = pTemp;
+	memset(m_pCurrentCount, 0, CELEX5_PIXELS_NUMBER * sizeof(uint16_t));
+	m_uiHalfWindowStartT = t;
+	m_bLastCountValid = true;
+	return bChanged;
+}
+
+const uint8_t* HotPixelDetector::getHotPixelMask()
+{
+	return m_pHotPixelMask;
+}
+
+uint32_t HotPixelDetector::getHotPixelCount()
+{
+	return m_uiHotPixelCount;
+}
+
+void HotPixelDetector::setHotPixelMask(const uint8_t* pMask)
+{
+	memcpy(m_pHotPixelMask, pMask, HOT_PIXEL_MASK_SIZE);
+	uint32_t hotPixelCount = 0;
+	for (int i = 0; i < HOT_PIXEL_MASK_SIZE; i++)
+	{
+		for (uint8_t value = m_pHotPixelMask[i]; value; value &= value - 1)
+			hotPixelCount++;
+	}
+	m_uiHotPixelCount = hotPixelCount;
+	if (m_pCurrentCount)
+		resetCount();
+}
+
+// File layout: magic (8 bytes), pixel number (uint32_t), mask (one bit per pixel)
+bool HotPixelDetector::saveHotPixelMask(const string& filePath)
+{
+	ofstream file(filePath.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "HotPixelDetector::saveHotPixelMask: can't open " << filePath << endl;
+		return false;
+	}
+	uint32_t pixelNumber = CELEX5_PIXELS_NUMBER;
+	file.write(HOT_PIXEL_FILE_MAGIC, 8);
+	file.write((const char*)&pixelNumber, sizeof(pixelNumber));
+	file.write((const char*)m_pHotPixelMask, HOT_PIXEL_MASK_SIZE);
+	return file.good();
+}
+
+// pMask: CELEX5_PIXELS_NUMBER / 8 bytes, left unchanged if the file can't be read
+bool HotPixelDetector::readHotPixelMask(const string& filePath, uint8_t* pMask)
+{
+	ifstream file(filePath.c_str(), ios::in | ios::binary);
+	if (!file.is_open())
+	{
+		cout << "HotPixelDetector::readHotPixelMask: can't open " << filePath << endl;
+		return false;
+	}
+	char magic[8];
+	uint32_t pixelNumber = 0;
+	file.read(magic, 8);
+	file.read((char*)&pixelNumber, sizeof(pixelNumber));
+	if (!file.good() || memcmp(magic, HOT_PIXEL_FILE_MAGIC, 8) != 0 || pixelNumber != CELEX5_PIXELS_NUMBER)
+	{
+		cout << "HotPixelDetector::readHotPixelMask: " << filePath << " is not a CeleX5 hot pixel file!" << endl;
+		return false;
+	}
+	vector<uint8_t> vecMask(HOT_PIXEL_MASK_SIZE);
+	file.read((char*)vecMask.data(), HOT_PIXEL_MASK_SIZE);
+	if (!file.good())
+	{
+		cout << "HotPixelDetector::readHotPixelMask: " << filePath << " is truncated!" << endl;
+		return false;
+	}
+	memcpy(pMask, vecMask.data(), HOT_PIXEL_MASK_SIZE);
+	return true;
+}
+
+void HotPixelDetector::resetCount()
+{
+	memset(m_pCurrentCount, 0, CELEX5_PIXELS_NUMBER * sizeof(uint16_t));
+	memset(m_pLastCount, 0, CELEX5_PIXELS_NUMBER * sizeof(uint16_t));
+	m_bHalfWindowStarted = false;
+	m_bLastCountValid = false;
+}
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef HOTPIXELDETECTOR_H
+#define HOTPIXELDETECTOR_H
+
+#include <stdint.h>
+#include <string>
+#include "../include/celextypes.h"
+
+using namespace std;
+
+// Find pixels that fire continuously.
+// The events of every pixel are counted in two half windows; each time a half window ends,
+// a pixel with at least the threshold count in the last full window is marked hot and a
+// marked pixel whose count dropped below the threshold is released again.
+class HotPixelDetector
+{
+public:
+	HotPixelDetector();
+	~HotPixelDetector();
+
+	void setThreshold(uint32_t count, uint32_t windowTime);
+	uint32_t getThresholdCount();
+	uint32_t getWindowTime();
+
+	void setDetectionEnabled(bool enable);
+	bool isDetectionEnabled();
+
+	inline void countEvent(uint32_t index)
+	{
+		if (m_pCurrentCount[index] < 0xFFFF)
+			m_pCurrentCount[index]++;
+	}
+	//t: EventData::t of the latest event, returns true if the mask has changed
+	bool update(uint32_t t);
+
+	const uint8_t* getHotPixelMask(); //one bit per pixel, 1: hot
+	uint32_t getHotPixelCount();
+	void setHotPixelMask(const uint8_t* pMask); //restarts the counting
+	bool saveHotPixelMask(const string& filePath);
+	static bool readHotPixelMask(const string& filePath, uint8_t* pMask);
+
+private:
+	void resetCount();
+
+private:
+	uint16_t*     m_pCurrentCount;
+	uint16_t*     m_pLastCount;
+	uint8_t*      m_pHotPixelMask;
+
+	bool          m_bDetectionEnabled;
+	uint32_t      m_uiThresholdCount;
+	uint32_t      m_uiWindowTime;
+	uint32_t      m_uiHalfWindowStartT;
+	bool          m_bHalfWindowStarted;
+	bool          m_bLastCountValid;
+	uint32_t      m_uiHotPixelCount;
+};
+
+#endif // HOTPIXELDETECTOR_H
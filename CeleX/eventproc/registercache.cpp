@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "registercache.h"
+#include "celex5registers.h"
+#include <cstring>
+
+RegisterCache::RegisterCache()
+{
+	invalidateAll();
+}
+
+RegisterCache::~RegisterCache()
+{
+}
+
+bool RegisterCache::isVolatile(uint32_t address)
+{
+	return CSR::SOFT_RESET.highAddr == address ||
+		CSR::SOFT_TRIGGER.highAddr == address ||
+		CSR::AUTOISP_TRIGGER.highAddr == address ||
+		CSR::ALS_CONTROL.highAddr == address;
+}
+
+bool RegisterCache::isCoreParameter(uint32_t address)
+{
+	return address < REGISTER_CORE_NUMBER;
+}
+
+bool RegisterCache::lookup(uint32_t address, uint32_t &value)
+{
+	bool* pValid = NULL;
+	uint16_t* pValue = findValue(address, &pValid);
+	if (NULL == pValue || !*pValid)
+		return false;
+	value = *pValue;
+	return true;
+}
+
+void RegisterCache::update(uint32_t address, uint32_t value)
+{
+	if (isCoreParameter(address) && getSelectedProfile() < 0)
+	{
+		invalidate(address);
+		return;
+	}
+	bool* pValid = NULL;
+	uint16_t* pValue = findValue(address, &pValid);
+	if (NULL == pValue)
+		return;
+	*pValue = value;
+	*pValid = true;
+}
+
+void RegisterCache::invalidate(uint32_t address)
+{
+	if (CSR::AUTOISP_PROFILE_ADDR.highAddr == address)
+	{
+		//the core parameters stay known per profile, only which one is selected is lost
+		m_arrayValid[address] = false;
+		return;
+	}
+	if (isCoreParameter(address))
+	{
+		//the write may have landed in any profile
+		for (int i = 0; i < REGISTER_PROFILE_NUMBER; i++)
+			m_arrayCoreValid[i][address] = false;
+		return;
+	}
+	if (address < REGISTER_NUMBER)
+		m_arrayValid[address] = false;
+}
+
+void RegisterCache::invalidateAll()
+{
+	memset(m_arrayValue, 0, sizeof(m_arrayValue));
+	memset(m_arrayValid, 0, sizeof(m_arrayValid));
+	memset(m_arrayCoreValue, 0, sizeof(m_arrayCoreValue));
+	memset(m_arrayCoreValid, 0, sizeof(m_arrayCoreValid));
+}
+
+int RegisterCache::getSelectedProfile()
+{
+	const uint32_t address = CSR::AUTOISP_PROFILE_ADDR.highAddr;
+	if (!m_arrayValid[address] || m_arrayValue[address] >= REGISTER_PROFILE_NUMBER)
+		return -1;
+	return m_arrayValue[address];
+}
+
+uint16_t* RegisterCache::findValue(uint32_t address, bool** ppValid)
+{
+	if (address >= REGISTER_NUMBER || isVolatile(address))
+		return NULL;
+	if (isCoreParameter(address))
+	{
+		int profile = getSelectedProfile();
+		if (profile < 0)
+			return NULL;
+		*ppValid = &m_arrayCoreValid[profile][address];
+		return &m_arrayCoreValue[profile][address];
+	}
+	*ppValid = &m_arrayValid[address];
+	return &m_arrayValue[address];
+}
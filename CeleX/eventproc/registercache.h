@@ -0,0 +1,59 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REGISTERCACHE_H
+#define REGISTERCACHE_H
+
+#include <stdint.h>
+
+#define REGISTER_NUMBER             256
+#define REGISTER_PROFILE_NUMBER     4
+#define REGISTER_CORE_NUMBER        47 //sensor core parameters 0 - 46, one bank per profile
+
+// Shadow copy of the CeleX5 register file, as far as it is known from the writes.
+// The sensor core parameters are banked: a write to them lands in the auto ISP profile
+// selected by AUTOISP_PROFILE_ADDR, so they are cached per profile and not cached at all
+// while the selected profile is unknown. Registers that trigger an action (soft reset,
+// soft trigger, auto ISP trigger, ALS control) are never cached: every write to them
+// must reach the sensor.
+class RegisterCache
+{
+public:
+	RegisterCache();
+	~RegisterCache();
+
+	static bool isVolatile(uint32_t address);
+	static bool isCoreParameter(uint32_t address);
+
+	//false if the value isn't known
+	bool lookup(uint32_t address, uint32_t &value);
+	void update(uint32_t address, uint32_t value);
+	void invalidate(uint32_t address);
+	void invalidateAll(); //after a reset or when the sensor is reopened
+	//the profile selected by AUTOISP_PROFILE_ADDR, -1 if unknown
+	int getSelectedProfile();
+
+private:
+	uint16_t* findValue(uint32_t address, bool** ppValid);
+
+private:
+	uint16_t      m_arrayValue[REGISTER_NUMBER];
+	bool          m_arrayValid[REGISTER_NUMBER];
+	uint16_t      m_arrayCoreValue[REGISTER_PROFILE_NUMBER][REGISTER_CORE_NUMBER];
+	bool          m_arrayCoreValid[REGISTER_PROFILE_NUMBER][REGISTER_CORE_NUMBER];
+};
+
+#endif // REGISTERCACHE_H
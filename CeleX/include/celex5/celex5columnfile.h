@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CELEX5_COLUMNFILE_H
+#define CELEX5_COLUMNFILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "celex5.h"
+
+using namespace std;
+
+class MappedFile;
+
+// Columnar export of decoded events for analysis tools: the fields of EventData are
+// stored as separate column chunks, cut into row groups of a fixed number of events,
+// and every chunk records the time stamp range of its row group. The writer holds one
+// row group in memory, so a session of any length streams through it.
+class CELEX_EXPORTS CeleX5ColumnFileWriter
+{
+public:
+	CeleX5ColumnFileWriter(uint32_t rowGroupSize = 1048576);
+	~CeleX5ColumnFileWriter();
+
+	bool openFile(const string& filePath);
+	bool closeFile(); //writes the last row group and the chunk statistics
+	bool isOpened();
+
+	bool writeEvents(const vector<EventData> &vecEvent);
+
+	uint64_t getEventCount();
+	uint64_t getWrittenBytes();
+
+private:
+	bool writeRowGroup();
+	bool writeChunk(uint32_t column, uint32_t type, const void* pData, uint32_t size, int32_t minValue, int32_t maxValue);
+
+private:
+	ofstream                       m_ofstream;
+	uint32_t                       m_uiRowGroupSize;
+	//columns of the row group being filled
+	vector<uint16_t>               m_vecCol;
+	vector<uint16_t>               m_vecRow;
+	vector<uint16_t>               m_vecBrightness;
+	vector<int8_t>                 m_vecPolarity;
+	vector<uint32_t>               m_vecT;
+	vector<uint8_t>                m_vecMeta; //ColumnChunkMeta of every written chunk
+	uint32_t                       m_uiRowGroupCount;
+	uint32_t                       m_uiMinT;
+	uint32_t                       m_uiMaxT;
+
+	uint64_t                       m_ulEventCount;
+	uint64_t                       m_ulWrittenBytes;
+};
+
+class CELEX_EXPORTS CeleX5ColumnFileReader
+{
+public:
+	enum Column {
+		Column_Col = 0, //uint16_t
+		Column_Row, //uint16_t
+		Column_Brightness, //uint16_t
+		Column_Polarity, //int8_t
+		Column_T, //uint32_t
+		Column_Number
+	};
+
+	typedef struct RowGroupInfo
+	{
+		uint32_t    rowCount;
+		uint32_t    minT; //smallest and largest EventData::t of the row group
+		uint32_t    maxT;
+	} RowGroupInfo;
+
+	CeleX5ColumnFileReader();
+	~CeleX5ColumnFileReader();
+
+	bool openFile(const string& filePath);
+	void closeFile();
+	bool isOpened();
+
+	uint32_t getRowGroupCount();
+	bool getRowGroupInfo(uint32_t index, RowGroupInfo &info);
+	uint64_t getEventCount();
+	//row groups that may hold events with tBegin <= t <= tEnd
+	void findRowGroups(uint32_t tBegin, uint32_t tEnd, vector<uint32_t> &vecIndex);
+
+	//values of one column of a row group, pointing into the file mapping (valid until closeFile)
+	const void* getColumnData(uint32_t rowGroup, Column column, uint32_t &rowCount);
+	bool readRowGroup(uint32_t index, vector<EventData> &vecEvent);
+	//events with tBegin <= t <= tEnd, reading only the row groups that can hold them
+	bool readTimeRange(uint32_t tBegin, uint32_t tEnd, vector<EventData> &vecEvent);
+
+private:
+	bool loadMeta();
+
+private:
+	MappedFile*                    m_pMappedFile;
+	vector<RowGroupInfo>           m_vecRowGroupInfo;
+	vector<const uint8_t*>         m_vecColumnData; //Column_Number per row group
+	uint64_t                       m_ulEventCount;
+};
+
+#endif // CELEX5_COLUMNFILE_H
@@ -0,0 +1,167 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CELEX5_DATAPROCESSOR_H
+#define CELEX5_DATAPROCESSOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "celex5.h"
+
+//Every MIPI frame returned by CeleX5::getMIPIData ends with one byte
+//appended by the CX3 firmware, bits [2:0] of which hold the sensor mode
+#define MIPI_FRAME_TRAILER_SIZE 1
+#define MIPI_FULL_PIC_FRAME_SIZE 1536000 //1280 * 800 pixels, 12 bits per pixel
+
+using namespace std;
+
+class HotPixelDetector;
+
+// Decode the MIPI frames returned by CeleX5::getMIPIData
+//
+// Full frame modes: 12 bits per pixel, two pixels packed in three bytes
+//   adc0 = (byte0 << 4) + byte2[3:0], adc1 = (byte1 << 4) + byte2[7:4]
+// Event modes, EVENT_PACKET_SELECT = 0: two 28-bit packets in seven bytes, ID = packet[1:0]
+//   row packet (ID = 2'b10): row = packet[11:2], row time stamp = packet[27:12]
+//   col packet (ID = 2'b01): col = packet[12:2], adc = packet[24:13]
+// Event modes, EVENT_PACKET_SELECT = 2: four 14-bit packets in seven bytes, ID = packet[1:0]
+//   row packet (ID = 2'b10): row = packet[11:2]
+//   time packet (ID = 2'b11): row time stamp = packet[13:2]
+//   col packet (ID = 2'b01): col = packet[12:2]
+class CELEX_EXPORTS CeleX5DataProcessor
+{
+public:
+	//What the event decoding carries from one frame to the next
+	typedef struct DecoderState
+	{
+		uint32_t    eventTCounter; //EventData::t of the last row
+		uint32_t    lastRowTime; //raw row time stamp of the last row
+		bool        rowTimeValid; //false: the next row time starts counting, t doesn't move
+	} DecoderState;
+
+	CeleX5DataProcessor();
+	~CeleX5DataProcessor();
+
+	bool processMIPIData(const uint8_t* pData, uint32_t dataSize);
+	void getEventDataVector(vector<EventData> &vecEvent);
+	bool getFullPicBuffer(uint8_t* buffer);
+	CeleX5::CeleX5Mode getSensorMode();
+
+	void setEventPacketFormat(uint32_t format); //EVENT_PACKET_SELECT: 0 or 2
+	uint32_t getEventPacketFormat();
+	//follow a register write of the sensor, e.g. one logged in a recording
+	void processRegisterWrite(uint32_t address, uint32_t value);
+	//forget the row and row time carried over from the previous frame, call it when
+	//the stream is discontinuous (e.g. after seeking in a recording); EventData::t stays monotonic
+	void resetDecoderState();
+	void getDecoderState(DecoderState &state);
+	void setDecoderState(const DecoderState &state);
+	//events of the last frame decoded while the row time wasn't valid yet, i.e. before
+	//EventData::t started to count from the first row time; they come first in the frame
+	uint32_t getEventCountBeforeRowTime();
+	uint32_t getRowTimePeriod(); //the raw row time stamp wraps around at this value
+
+	//------- region of interest -------
+	//Events outside every ROI are dropped while decoding; with no ROI set, all events are kept.
+	//Can be called from any thread, the decoding takes the new ROI over at the next frame
+	void addROI(uint32_t col, uint32_t row, uint32_t width, uint32_t height);
+	void clearROI();
+	//pMask: one bit per pixel, row-major, bit (index & 7) of byte (index >> 3); NULL to remove
+	void setROIMask(const uint8_t* pMask);
+	bool isROIEnabled();
+
+	//------- intensity image -------
+	//Updated pixel by pixel from the ADC value of Event_Intensity_Mode events and
+	//refreshed by full frames; can be read at any rate from any thread
+	void setIntensityImageEnabled(bool enable);
+	bool isIntensityImageEnabled();
+	bool getIntensityPicBuffer(uint8_t* buffer);
+
+	//------- hot pixels -------
+	//Events of hot pixels are dropped while decoding, pixels of full frames read 0.
+	//A pixel is hot while it fires at least count times per windowTime (unit: EventData::t).
+	//clearHotPixelMask and loadHotPixelMask can be called from any thread, the decoding
+	//takes the new mask over at the next frame; the other settings belong to the decoding thread
+	void setHotPixelDetectionEnabled(bool enable);
+	bool isHotPixelDetectionEnabled();
+	void setHotPixelThreshold(uint32_t count, uint32_t windowTime);
+	uint32_t getHotPixelCount();
+	void clearHotPixelMask();
+	bool saveHotPixelMask(const string& filePath);
+	bool loadHotPixelMask(const string& filePath);
+
+private:
+	//the pixels kept by the ROI, built by the ROI setters for the decoding thread
+	typedef struct ROIFilter
+	{
+		uint8_t     pixelKept[CELEX5_PIXELS_NUMBER / 8];
+		uint8_t     rowKept[CELEX5_ROW]; //any pixel of the row kept
+		bool        enabled; //false: every pixel kept
+	} ROIFilter;
+
+	bool processFullPicData(const uint8_t* pData, uint32_t dataSize);
+	void parseEventDataFormat0(const uint8_t* pData, uint32_t dataSize, uint8_t* pIntensityPic);
+	void parseEventDataFormat2(const uint8_t* pData, uint32_t dataSize);
+	void updateRowTimeStamp(uint32_t rowTime, uint32_t period);
+	void buildROIFilter(ROIFilter* pFilter);
+	void publishROIFilter();
+	void updatePixelFilter();
+	void swapIntensityPic(bool bWholePic);
+
+	inline bool isPixelKept(uint32_t row, uint32_t col)
+	{
+		uint32_t index = row * CELEX5_COL + col;
+		return (m_pPixelFilter[index >> 3] >> (index & 7)) & 1;
+	}
+
+private:
+	uint8_t*                       m_pFullPic;
+	vector<EventData>              m_vecEventData;
+
+	CeleX5::CeleX5Mode             m_emSensorMode;
+	uint32_t                       m_uiEventPacketFormat;
+
+	int                            m_iCurrentRow;
+	uint32_t                       m_uiLastRowTime;
+	bool                           m_bRowTimeValid;
+	uint32_t                       m_uiEventTCounter;
+	uint32_t                       m_uiEventCountBeforeRowTime;
+
+	bool                           m_bPixelFilterEnabled;
+	uint8_t*                       m_pPixelFilter; //the ROI without the hot pixels
+	uint8_t                        m_arrayRowKept[CELEX5_ROW];
+
+	mutex                          m_mutexROI; //guards the ROI settings
+	vector<uint32_t>               m_vecROIRect; //col, row, width, height
+	uint8_t*                       m_pROIMask;
+	ROIFilter*                     m_pROIFilter; //used by the decoding thread
+	atomic<ROIFilter*>             m_pNewROIFilter; //published by the setters, NULL: unchanged
+	atomic<uint8_t*>               m_pNewHotPixelMask; //published by clear/loadHotPixelMask
+
+	atomic<bool>                   m_bIntensityImageEnabled;
+	uint8_t*                       m_pIntensityPic; //read by getIntensityPicBuffer
+	uint8_t*                       m_pIntensityBackPic; //decoded into, then swapped with m_pIntensityPic
+	uint8_t                        m_arrayIntensityRowDirty[CELEX5_ROW]; //written since the last swap
+	vector<uint16_t>               m_vecIntensityDirtyRow;
+	mutex                          m_mutexIntensityPic;
+
+	HotPixelDetector*              m_pHotPixelDetector;
+};
+
+#endif // CELEX5_DATAPROCESSOR_H
@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CELEX5_LOOPDEMUXER_H
+#define CELEX5_LOOPDEMUXER_H
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include "celex5.h"
+
+#define LOOP_DEMUXER_MODE_NUMBER 8 //mode field of the MIPI frame trailer is 3 bits wide
+
+using namespace std;
+
+class DataQueue;
+class CeleX5DataProcessor;
+
+// Split the interleaved loop mode stream into one substream per sensor mode.
+// Each frame is routed by the mode in its trailer byte without being copied;
+// every mode has its own queue and CeleX5DataProcessor, so one consumer thread
+// per mode can decode full pictures and events concurrently.
+class CELEX_EXPORTS CeleX5LoopDemuxer
+{
+public:
+	CeleX5LoopDemuxer(uint32_t queueCapacity = 16);
+	~CeleX5LoopDemuxer();
+
+	//------- producer side -------
+	//takes over the contents of buffer, which is left empty
+	bool pushMIPIData(vector<uint8_t> &buffer);
+	bool pushMIPIPacket(CeleX5::MIPIPacket &packet);
+
+	//------- consumer side, one thread per mode -------
+	bool popMIPIPacket(CeleX5::CeleX5Mode mode, CeleX5::MIPIPacket &packet, uint32_t timeoutMs);
+	//pop the next frame of the mode and decode it with the processor of the mode
+	bool processNextPacket(CeleX5::CeleX5Mode mode, uint32_t timeoutMs);
+	CeleX5DataProcessor* getDataProcessor(CeleX5::CeleX5Mode mode);
+
+	void stop(); //wake up all consumers
+	//drop the queued frames and reset the decoders, e.g. after seeking in a recording
+	void reset();
+	uint64_t getModeTransitionCount();
+	uint64_t getDroppedPacketCount(CeleX5::CeleX5Mode mode);
+
+private:
+	bool isValidMode(CeleX5::CeleX5Mode mode);
+
+private:
+	DataQueue*                     m_pQueue[LOOP_DEMUXER_MODE_NUMBER];
+	CeleX5DataProcessor*           m_pDataProcessor[LOOP_DEMUXER_MODE_NUMBER];
+
+	CeleX5::CeleX5Mode             m_emLastMode;
+	uint64_t                       m_ulSequence;
+	atomic<uint64_t>               m_ulModeTransitionCount;
+};
+
+#endif // CELEX5_LOOPDEMUXER_H
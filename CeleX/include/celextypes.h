@@ -42,6 +42,7 @@
 #define FILE_SLIDERS        "sliders.xml"
 #define FILE_CELEX5_CFG		"CeleX5_Commands.xml"
 #define FILE_CELEX5_CFG_NEW	"CeleX5_Commands_New.xml"
+#define FILE_CELEX5_CFG_PROFILE	"CeleX5_Commands.bin" //compiled from FILE_CELEX5_CFG
 
 #define SEQUENCE_LAYOUT_WIDTH 3 //7
 #define SLIDER_LAYOUT_WIDTH   1 //4
@@ -0,0 +1,387 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "../include/celex5/celex5columnfile.h"
+#include "../base/mappedfile.h"
+#include "columnfileformat.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+static_assert(int(CeleX5ColumnFileReader::Column_Number) == int(COLUMN_NUMBER), "column ids differ from the file format");
+
+static const uint32_t s_columnType[COLUMN_NUMBER] = {
+	COLUMN_TYPE_UINT16, COLUMN_TYPE_UINT16, COLUMN_TYPE_UINT16, COLUMN_TYPE_INT8, COLUMN_TYPE_UINT32 };
+
+static uint32_t columnTypeSize(uint32_t type)
+{
+	switch (type)
+	{
+	case COLUMN_TYPE_UINT16:
+		return sizeof(uint16_t);
+	case COLUMN_TYPE_INT8:
+		return sizeof(int8_t);
+	case COLUMN_TYPE_UINT32:
+		return sizeof(uint32_t);
+	}
+	return 0;
+}
+
+template <typename T>
+static void getValueRange(const vector<T> &vecValue, int32_t &minValue, int32_t &maxValue)
+{
+	auto range = minmax_element(vecValue.begin(), vecValue.end());
+	minValue = int32_t(*range.first);
+	maxValue = int32_t(*range.second);
+}
+
+CeleX5ColumnFileWriter::CeleX5ColumnFileWriter(uint32_t rowGroupSize)
+	: m_uiRowGroupSize(rowGroupSize > 0 ? rowGroupSize : 1048576)
+	, m_uiRowGroupCount(0)
+	, m_uiMinT(0)
+	, m_uiMaxT(0)
+	, m_ulEventCount(0)
+	, m_ulWrittenBytes(0)
+{
+}
+
+CeleX5ColumnFileWriter::~CeleX5ColumnFileWriter()
+{
+	closeFile();
+}
+
+bool CeleX5ColumnFileWriter::openFile(const string& filePath)
+{
+	closeFile();
+	m_ofstream.open(filePath.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!m_ofstream.is_open())
+	{
+		cout << "CeleX5ColumnFileWriter::openFile: can't open " << filePath << endl;
+		return false;
+	}
+	ColumnFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, COLUMN_FILE_MAGIC, sizeof(COLUMN_FILE_MAGIC));
+	header.version = COLUMN_FILE_VERSION;
+	header.rowGroupSize = m_uiRowGroupSize;
+	header.columnNumber = COLUMN_NUMBER;
+	m_ofstream.write((const char*)&header, sizeof(header));
+
+	m_vecCol.clear();
+	m_vecRow.clear();
+	m_vecBrightness.clear();
+	m_vecPolarity.clear();
+	m_vecT.clear();
+	m_vecMeta.clear();
+	m_uiRowGroupCount = 0;
+	m_ulEventCount = 0;
+	m_ulWrittenBytes = sizeof(header);
+	return m_ofstream.good();
+}
+
+bool CeleX5ColumnFileWriter::closeFile()
+{
+	if (!m_ofstream.is_open())
+		return false;
+	bool bOk = writeRowGroup();
+
+	ColumnFileFooter footer;
+	footer.metaOffset = m_ulWrittenBytes;
+	footer.rowGroupCount = m_uiRowGroupCount;
+	footer.magic = COLUMN_FOOTER_MAGIC;
+	m_ofstream.write((const char*)m_vecMeta.data(), m_vecMeta.size());
+	m_ofstream.write((const char*)&footer, sizeof(footer));
+	bOk = bOk && m_ofstream.good();
+	m_ofstream.close();
+	//give the row group buffers back, they can be large
+	vector<uint16_t>().swap(m_vecCol);
+	vector<uint16_t>().swap(m_vecRow);
+	vector<uint16_t>().swap(m_vecBrightness);
+	vector<int8_t>().swap(m_vecPolarity);
+	vector<uint32_t>().swap(m_vecT);
+	return bOk;
+}
+
+bool CeleX5ColumnFileWriter::isOpened()
+{
+	return m_ofstream.is_open();
+}
+
+bool CeleX5ColumnFileWriter::writeEvents(const vector<EventData> &vecEvent)
+{
+	if (!m_ofstream.is_open())
+		return false;
+	for (size_t i = 0; i < vecEvent.size(); i++)
+	{
+		const EventData& event = vecEvent[i];
+		if (m_vecT.empty())
+		{
+			m_uiMinT = event.t;
+			m_uiMaxT = event.t;
+		}
+		m_uiMinT = min(m_uiMinT, event.t);
+		m_uiMaxT = max(m_uiMaxT, event.t);
+		m_vecCol.push_back(event.col);
+		m_vecRow.push_back(event.row);
+		m_vecBrightness.push_back(event.brightness);
+		m_vecPolarity.push_back(int8_t(int16_t(event.polarity)));
+		m_vecT.push_back(event.t);
+		if (m_vecT.size() >= m_uiRowGroupSize && !writeRowGroup())
+			return false;
+	}
+	return true;
+}
+
+uint64_t CeleX5ColumnFileWriter::getEventCount()
+{
+	return m_ulEventCount;
+}
+
+uint64_t CeleX5ColumnFileWriter::getWrittenBytes()
+{
+	return m_ulWrittenBytes;
+}
+
+bool CeleX5ColumnFileWriter::writeRowGroup()
+{
+	if (m_vecT.empty())
+		return true;
+	uint32_t rowCount = m_vecT.size();
+	int32_t minValue, maxValue;
+	bool bOk = true;
+	getValueRange(m_vecCol, minValue, maxValue);
+	bOk = bOk && writeChunk(COLUMN_COL, COLUMN_TYPE_UINT16, m_vecCol.data(), rowCount * sizeof(uint16_t), minValue, maxValue);
+	getValueRange(m_vecRow, minValue, maxValue);
+	bOk = bOk && writeChunk(COLUMN_ROW, COLUMN_TYPE_UINT16, m_vecRow.data(), rowCount * sizeof(uint16_t), minValue, maxValue);
+	getValueRange(m_vecBrightness, minValue, maxValue);
+	bOk = bOk && writeChunk(COLUMN_BRIGHTNESS, COLUMN_TYPE_UINT16, m_vecBrightness.data(), rowCount * sizeof(uint16_t), minValue, maxValue);
+	getValueRange(m_vecPolarity, minValue, maxValue);
+	bOk = bOk && writeChunk(COLUMN_POLARITY, COLUMN_TYPE_INT8, m_vecPolarity.data(), rowCount * sizeof(int8_t), minValue, maxValue);
+	//t may not fit an int32_t, its range is in minT and maxT
+	bOk = bOk && writeChunk(COLUMN_T, COLUMN_TYPE_UINT32, m_vecT.data(), rowCount * sizeof(uint32_t), 0, 0);
+
+	m_uiRowGroupCount++;
+	m_ulEventCount += rowCount;
+	m_vecCol.clear();
+	m_vecRow.clear();
+	m_vecBrightness.clear();
+	m_vecPolarity.clear();
+	m_vecT.clear();
+	return bOk;
+}
+
+bool CeleX5ColumnFileWriter::writeChunk(uint32_t column, uint32_t type, const void* pData, uint32_t size, int32_t minValue, int32_t maxValue)
+{
+	ColumnChunkMeta meta;
+	memset(&meta, 0, sizeof(meta));
+	meta.offset = m_ulWrittenBytes;
+	meta.size = size;
+	meta.rowCount = size / columnTypeSize(type);
+	meta.column = column;
+	meta.type = type;
+	meta.rowGroup = m_uiRowGroupCount;
+	meta.minT = m_uiMinT;
+	meta.maxT = m_uiMaxT;
+	meta.minValue = minValue;
+	meta.maxValue = maxValue;
+	m_vecMeta.insert(m_vecMeta.end(), (const uint8_t*)&meta, (const uint8_t*)&meta + sizeof(meta));
+
+	static const char padding[COLUMN_CHUNK_ALIGNMENT] = { 0 };
+	uint32_t paddingSize = (COLUMN_CHUNK_ALIGNMENT - size % COLUMN_CHUNK_ALIGNMENT) % COLUMN_CHUNK_ALIGNMENT;
+	m_ofstream.write((const char*)pData, size);
+	m_ofstream.write(padding, paddingSize);
+	m_ulWrittenBytes += size + paddingSize;
+	return m_ofstream.good();
+}
+
+CeleX5ColumnFileReader::CeleX5ColumnFileReader()
+	: m_ulEventCount(0)
+{
+	m_pMappedFile = new MappedFile;
+}
+
+CeleX5ColumnFileReader::~CeleX5ColumnFileReader()
+{
+	if (m_pMappedFile)
+	{
+		delete m_pMappedFile;
+		m_pMappedFile = NULL;
+	}
+}
+
+bool CeleX5ColumnFileReader::openFile(const string& filePath)
+{
+	closeFile();
+	if (!m_pMappedFile->open(filePath, false))
+		return false;
+	const ColumnFileHeader* pHeader = (const ColumnFileHeader*)m_pMappedFile->data();
+	if (m_pMappedFile->size() < sizeof(ColumnFileHeader) ||
+		memcmp(pHeader->magic, COLUMN_FILE_MAGIC, sizeof(COLUMN_FILE_MAGIC)) != 0 ||
+		pHeader->version != COLUMN_FILE_VERSION || pHeader->columnNumber != COLUMN_NUMBER)
+	{
+		cout << "CeleX5ColumnFileReader::openFile: " << filePath << " is not a CeleX5 column file!" << endl;
+		closeFile();
+		return false;
+	}
+	//the statistics are written on close, a file that wasn't closed can't be read
+	if (!loadMeta())
+	{
+		cout << "CeleX5ColumnFileReader::openFile: " << filePath << " has no valid chunk statistics!" << endl;
+		closeFile();
+		return false;
+	}
+	return true;
+}
+
+void CeleX5ColumnFileReader::closeFile()
+{
+	m_pMappedFile->close();
+	m_vecRowGroupInfo.clear();
+	m_vecColumnData.clear();
+	m_ulEventCount = 0;
+}
+
+bool CeleX5ColumnFileReader::isOpened()
+{
+	return m_pMappedFile->isOpened();
+}
+
+uint32_t CeleX5ColumnFileReader::getRowGroupCount()
+{
+	return m_vecRowGroupInfo.size();
+}
+
+bool CeleX5ColumnFileReader::getRowGroupInfo(uint32_t index, RowGroupInfo &info)
+{
+	if (index >= m_vecRowGroupInfo.size())
+		return false;
+	info = m_vecRowGroupInfo[index];
+	return true;
+}
+
+uint64_t CeleX5ColumnFileReader::getEventCount()
+{
+	return m_ulEventCount;
+}
+
+// t wraps around with the sensor counter, so the row groups aren't assumed to be sorted
+void CeleX5ColumnFileReader::findRowGroups(uint32_t tBegin, uint32_t tEnd, vector<uint32_t> &vecIndex)
+{
+	vecIndex.clear();
+	for (uint32_t i = 0; i < m_vecRowGroupInfo.size(); i++)
+	{
+		const RowGroupInfo& info = m_vecRowGroupInfo[i];
+		if (info.minT <= tEnd && info.maxT >= tBegin)
+			vecIndex.push_back(i);
+	}
+}
+
+const void* CeleX5ColumnFileReader::getColumnData(uint32_t rowGroup, Column column, uint32_t &rowCount)
+{
+	if (rowGroup >= m_vecRowGroupInfo.size() || column >= Column_Number)
+	{
+		rowCount = 0;
+		return NULL;
+	}
+	rowCount = m_vecRowGroupInfo[rowGroup].rowCount;
+	return m_vecColumnData[rowGroup * COLUMN_NUMBER + column];
+}
+
+bool CeleX5ColumnFileReader::readRowGroup(uint32_t index, vector<EventData> &vecEvent)
+{
+	if (index >= m_vecRowGroupInfo.size())
+		return false;
+	uint32_t rowCount = m_vecRowGroupInfo[index].rowCount;
+	const uint8_t* const* pColumn = &m_vecColumnData[index * COLUMN_NUMBER];
+	const uint16_t* pCol = (const uint16_t*)pColumn[COLUMN_COL];
+	const uint16_t* pRow = (const uint16_t*)pColumn[COLUMN_ROW];
+	const uint16_t* pBrightness = (const uint16_t*)pColumn[COLUMN_BRIGHTNESS];
+	const int8_t* pPolarity = (const int8_t*)pColumn[COLUMN_POLARITY];
+	const uint32_t* pT = (const uint32_t*)pColumn[COLUMN_T];
+	vecEvent.resize(rowCount);
+	for (uint32_t i = 0; i < rowCount; i++)
+	{
+		EventData& event = vecEvent[i];
+		event.col = pCol[i];
+		event.row = pRow[i];
+		event.brightness = pBrightness[i];
+		event.polarity = int16_t(pPolarity[i]);
+		event.t = pT[i];
+	}
+	return true;
+}
+
+bool CeleX5ColumnFileReader::readTimeRange(uint32_t tBegin, uint32_t tEnd, vector<EventData> &vecEvent)
+{
+	vecEvent.clear();
+	vector<uint32_t> vecIndex;
+	findRowGroups(tBegin, tEnd, vecIndex);
+	vector<EventData> vecRowGroup;
+	for (auto itr = vecIndex.begin(); itr != vecIndex.end(); itr++)
+	{
+		if (!readRowGroup(*itr, vecRowGroup))
+			return false;
+		for (auto event = vecRowGroup.begin(); event != vecRowGroup.end(); event++)
+		{
+			if (event->t >= tBegin && event->t <= tEnd)
+				vecEvent.push_back(*event);
+		}
+	}
+	return true;
+}
+
+bool CeleX5ColumnFileReader::loadMeta()
+{
+	uint64_t fileSize = m_pMappedFile->size();
+	if (fileSize < sizeof(ColumnFileHeader) + sizeof(ColumnFileFooter))
+		return false;
+	ColumnFileFooter footer;
+	memcpy(&footer, m_pMappedFile->data() + fileSize - sizeof(footer), sizeof(footer));
+	uint64_t chunkCount = uint64_t(footer.rowGroupCount) * COLUMN_NUMBER;
+	if (footer.magic != COLUMN_FOOTER_MAGIC ||
+		footer.metaOffset + chunkCount * sizeof(ColumnChunkMeta) + sizeof(footer) != fileSize)
+		return false;
+
+	const uint8_t* pMeta = m_pMappedFile->data() + footer.metaOffset;
+	m_vecRowGroupInfo.resize(footer.rowGroupCount);
+	m_vecColumnData.resize(chunkCount);
+	m_ulEventCount = 0;
+	for (uint64_t i = 0; i < chunkCount; i++, pMeta += sizeof(ColumnChunkMeta))
+	{
+		ColumnChunkMeta meta;
+		memcpy(&meta, pMeta, sizeof(meta));
+		uint32_t rowGroup = i / COLUMN_NUMBER;
+		uint32_t column = i % COLUMN_NUMBER;
+		if (meta.rowGroup != rowGroup || meta.column != column || meta.type != s_columnType[column] ||
+			meta.size != meta.rowCount * columnTypeSize(meta.type) || meta.offset % COLUMN_CHUNK_ALIGNMENT != 0 ||
+			meta.offset < sizeof(ColumnFileHeader) || meta.offset + meta.size > footer.metaOffset)
+			return false;
+		RowGroupInfo& info = m_vecRowGroupInfo[rowGroup];
+		if (0 == column)
+		{
+			info.rowCount = meta.rowCount;
+			info.minT = meta.minT;
+			info.maxT = meta.maxT;
+			m_ulEventCount += meta.rowCount;
+		}
+		else if (meta.rowCount != info.rowCount)
+		{
+			return false;
+		}
+		m_vecColumnData[i] = m_pMappedFile->data() + meta.offset;
+	}
+	return true;
+}
@@ -0,0 +1,475 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "../include/celex5/celex5eventfile.h"
+#include "../base/lzcompressor.h"
+#include "../base/mappedfile.h"
+#include "eventfileformat.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#define VARINT_MAX_SIZE 5
+//the most raw bytes an event can take, the stream capacities of encodeEvents
+#define EVENT_MAX_RAW_SIZE (VARINT_MAX_SIZE * 3 + 3 + 3 + 1)
+
+static inline uint32_t zigzagEncode(int32_t value)
+{
+	return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+static inline int32_t zigzagDecode(uint32_t value)
+{
+	return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+static inline uint8_t* writeVarint(uint8_t* p, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		*p++ = uint8_t(value) | 0x80;
+		value >>= 7;
+	}
+	*p++ = uint8_t(value);
+	return p;
+}
+
+static inline bool readVarint(const uint8_t*& p, const uint8_t* pEnd, uint32_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35 && p < pEnd; shift += 7)
+	{
+		uint8_t byte = *p++;
+		value |= uint32_t(byte & 0x7F) << shift;
+		if (0 == (byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// Delta code the events into the streams described in eventfileformat.h
+static void encodeEvents(const vector<EventData> &vecEvent, vector<uint8_t> &vecRaw)
+{
+	uint32_t eventCount = vecEvent.size();
+	uint32_t streamCapacity[EVENT_STREAM_NUMBER] = { eventCount * VARINT_MAX_SIZE * 3, eventCount * 3,
+		eventCount * 3, eventCount }; //EVENT_MAX_RAW_SIZE per event
+	uint32_t streamOffset[EVENT_STREAM_NUMBER];
+	uint32_t totalSize = EVENT_STREAM_NUMBER * sizeof(uint32_t);
+	for (int i = 0; i < EVENT_STREAM_NUMBER; i++)
+	{
+		streamOffset[i] = totalSize;
+		totalSize += streamCapacity[i];
+	}
+	vecRaw.resize(totalSize);
+
+	uint8_t* pStream[EVENT_STREAM_NUMBER];
+	for (int i = 0; i < EVENT_STREAM_NUMBER; i++)
+		pStream[i] = vecRaw.data() + streamOffset[i];
+	uint32_t lastT = eventCount > 0 ? vecEvent[0].t : 0;
+	int32_t lastRow = 0;
+	int32_t lastGroupCol = 0;
+	for (uint32_t i = 0; i < eventCount; )
+	{
+		const EventData& first = vecEvent[i];
+		uint32_t count = 1;
+		while (i + count < eventCount && vecEvent[i + count].t == first.t && vecEvent[i + count].row == first.row)
+			count++;
+		pStream[0] = writeVarint(pStream[0], zigzagEncode(int32_t(first.t - lastT)));
+		pStream[0] = writeVarint(pStream[0], zigzagEncode(int32_t(first.row) - lastRow));
+		pStream[0] = writeVarint(pStream[0], count);
+		lastT = first.t;
+		lastRow = first.row;
+
+		int32_t lastCol = lastGroupCol;
+		lastGroupCol = first.col;
+		for (uint32_t j = i; j < i + count; j++)
+		{
+			const EventData& event = vecEvent[j];
+			pStream[1] = writeVarint(pStream[1], zigzagEncode(int32_t(event.col) - lastCol));
+			pStream[2] = writeVarint(pStream[2], event.brightness);
+			*pStream[3]++ = uint8_t(int16_t(event.polarity));
+			lastCol = event.col;
+		}
+		i += count;
+	}
+
+	//close the gaps between the streams
+	uint32_t size = EVENT_STREAM_NUMBER * sizeof(uint32_t);
+	for (int i = 0; i < EVENT_STREAM_NUMBER; i++)
+	{
+		uint32_t streamSize = pStream[i] - (vecRaw.data() + streamOffset[i]);
+		memcpy(vecRaw.data() + i * sizeof(uint32_t), &streamSize, sizeof(uint32_t));
+		memmove(vecRaw.data() + size, vecRaw.data() + streamOffset[i], streamSize);
+		size += streamSize;
+	}
+	vecRaw.resize(size);
+}
+
+static bool decodeEvents(const uint8_t* pRaw, uint32_t rawSize, uint32_t eventCount, uint32_t firstT, vector<EventData> &vecEvent)
+{
+	uint32_t headerSize = EVENT_STREAM_NUMBER * sizeof(uint32_t);
+	if (rawSize < headerSize)
+		return false;
+	const uint8_t* pStream[EVENT_STREAM_NUMBER];
+	const uint8_t* pStreamEnd[EVENT_STREAM_NUMBER];
+	uint32_t offset = headerSize;
+	for (int i = 0; i < EVENT_STREAM_NUMBER; i++)
+	{
+		uint32_t streamSize;
+		memcpy(&streamSize, pRaw + i * sizeof(uint32_t), sizeof(uint32_t));
+		if (streamSize > rawSize - offset)
+			return false;
+		pStream[i] = pRaw + offset;
+		offset += streamSize;
+		pStreamEnd[i] = pRaw + offset;
+	}
+	if (uint32_t(pStreamEnd[3] - pStream[3]) != eventCount)
+		return false;
+
+	vecEvent.resize(eventCount);
+	uint32_t lastT = firstT;
+	int32_t lastRow = 0;
+	int32_t lastGroupCol = 0;
+	for (uint32_t i = 0; i < eventCount; )
+	{
+		uint32_t t, row, count;
+		if (!readVarint(pStream[0], pStreamEnd[0], t) || !readVarint(pStream[0], pStreamEnd[0], row) ||
+			!readVarint(pStream[0], pStreamEnd[0], count) || 0 == count || count > eventCount - i)
+			return false;
+		lastT += zigzagDecode(t);
+		lastRow += zigzagDecode(row);
+
+		int32_t lastCol = lastGroupCol;
+		for (uint32_t j = i; j < i + count; j++)
+		{
+			uint32_t col, brightness;
+			if (!readVarint(pStream[1], pStreamEnd[1], col) || !readVarint(pStream[2], pStreamEnd[2], brightness))
+				return false;
+			lastCol += zigzagDecode(col);
+			EventData& event = vecEvent[j];
+			event.t = lastT;
+			event.row = lastRow;
+			event.col = lastCol;
+			event.brightness = brightness;
+			event.polarity = int16_t(int8_t(*pStream[3]++));
+			if (j == i)
+				lastGroupCol = lastCol;
+		}
+		i += count;
+	}
+	return true;
+}
+
+CeleX5EventFileWriter::CeleX5EventFileWriter(uint32_t blockEventCount)
+	: m_uiBlockEventCount(blockEventCount > 0 ? blockEventCount : 65536)
+	, m_ulEventCount(0)
+	, m_ulWrittenBytes(0)
+{
+	m_pCompressor = new LZCompressor;
+}
+
+CeleX5EventFileWriter::~CeleX5EventFileWriter()
+{
+	closeFile();
+	if (m_pCompressor)
+	{
+		delete m_pCompressor;
+		m_pCompressor = NULL;
+	}
+}
+
+bool CeleX5EventFileWriter::openFile(const string& filePath)
+{
+	closeFile();
+	m_ofstream.open(filePath.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!m_ofstream.is_open())
+	{
+		cout << "CeleX5EventFileWriter::openFile: can't open " << filePath << endl;
+		return false;
+	}
+	EventFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC));
+	header.version = EVENT_FILE_VERSION;
+	header.blockEventCount = m_uiBlockEventCount;
+	m_ofstream.write((const char*)&header, sizeof(header));
+
+	m_vecEventData.clear();
+	m_vecEventData.reserve(m_uiBlockEventCount);
+	m_vecIndex.clear();
+	m_ulEventCount = 0;
+	m_ulWrittenBytes = sizeof(header);
+	return m_ofstream.good();
+}
+
+bool CeleX5EventFileWriter::closeFile()
+{
+	if (!m_ofstream.is_open())
+		return false;
+	bool bOk = writeBlock();
+
+	EventFileFooter footer;
+	footer.indexOffset = m_ulWrittenBytes;
+	footer.blockCount = m_vecIndex.size() / sizeof(EventIndexEntry);
+	footer.magic = EVENT_FOOTER_MAGIC;
+	m_ofstream.write((const char*)m_vecIndex.data(), m_vecIndex.size());
+	m_ofstream.write((const char*)&footer, sizeof(footer));
+	bOk = bOk && m_ofstream.good();
+	m_ofstream.close();
+	return bOk;
+}
+
+bool CeleX5EventFileWriter::isOpened()
+{
+	return m_ofstream.is_open();
+}
+
+bool CeleX5EventFileWriter::writeEvents(const vector<EventData> &vecEvent)
+{
+	if (!m_ofstream.is_open())
+		return false;
+	for (size_t i = 0; i < vecEvent.size(); )
+	{
+		size_t count = min<size_t>(vecEvent.size() - i, m_uiBlockEventCount - m_vecEventData.size());
+		m_vecEventData.insert(m_vecEventData.end(), vecEvent.begin() + i, vecEvent.begin() + i + count);
+		i += count;
+		if (m_vecEventData.size() >= m_uiBlockEventCount && !writeBlock())
+			return false;
+	}
+	return true;
+}
+
+uint64_t CeleX5EventFileWriter::getEventCount()
+{
+	return m_ulEventCount;
+}
+
+uint64_t CeleX5EventFileWriter::getWrittenBytes()
+{
+	return m_ulWrittenBytes;
+}
+
+bool CeleX5EventFileWriter::writeBlock()
+{
+	if (m_vecEventData.empty())
+		return true;
+	encodeEvents(m_vecEventData, m_vecRawBlock);
+
+	EventBlockHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = EVENT_BLOCK_MAGIC;
+	header.rawSize = m_vecRawBlock.size();
+	header.eventCount = m_vecEventData.size();
+	header.firstT = m_vecEventData.front().t;
+	header.lastT = m_vecEventData.back().t;
+
+	m_vecStoredBlock.resize(LZCompressor::compressBound(header.rawSize));
+	uint32_t compressedSize = m_pCompressor->compress(m_vecRawBlock.data(), header.rawSize, m_vecStoredBlock.data());
+	const uint8_t* pStored = m_vecStoredBlock.data();
+	if (compressedSize < header.rawSize)
+	{
+		header.flags = EVENT_BLOCK_COMPRESSED;
+		header.storedSize = compressedSize;
+	}
+	else
+	{
+		header.storedSize = header.rawSize;
+		pStored = m_vecRawBlock.data();
+	}
+
+	EventIndexEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.offset = m_ulWrittenBytes;
+	entry.eventCount = header.eventCount;
+	entry.firstT = header.firstT;
+	entry.lastT = header.lastT;
+	m_vecIndex.insert(m_vecIndex.end(), (const uint8_t*)&entry, (const uint8_t*)&entry + sizeof(entry));
+
+	m_ofstream.write((const char*)&header, sizeof(header));
+	m_ofstream.write((const char*)pStored, header.storedSize);
+	m_ulWrittenBytes += sizeof(header) + header.storedSize;
+	m_ulEventCount += header.eventCount;
+	m_vecEventData.clear();
+	return m_ofstream.good();
+}
+
+CeleX5EventFileReader::CeleX5EventFileReader()
+	: m_uiBlockEventCount(0)
+	, m_ulEventCount(0)
+{
+	m_pMappedFile = new MappedFile;
+}
+
+CeleX5EventFileReader::~CeleX5EventFileReader()
+{
+	if (m_pMappedFile)
+	{
+		delete m_pMappedFile;
+		m_pMappedFile = NULL;
+	}
+}
+
+bool CeleX5EventFileReader::openFile(const string& filePath)
+{
+	closeFile();
+	if (!m_pMappedFile->open(filePath, false))
+		return false;
+	const EventFileHeader* pHeader = (const EventFileHeader*)m_pMappedFile->data();
+	if (m_pMappedFile->size() < sizeof(EventFileHeader) ||
+		memcmp(pHeader->magic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC)) != 0 ||
+		pHeader->version != EVENT_FILE_VERSION)
+	{
+		cout << "CeleX5EventFileReader::openFile: " << filePath << " is not a CeleX5 event file!" << endl;
+		closeFile();
+		return false;
+	}
+	m_uiBlockEventCount = pHeader->blockEventCount;
+	if (!loadIndex())
+		scanBlocks();
+	m_ulEventCount = 0;
+	for (auto itr = m_vecBlockInfo.begin(); itr != m_vecBlockInfo.end(); itr++)
+		m_ulEventCount += itr->eventCount;
+	return true;
+}
+
+void CeleX5EventFileReader::closeFile()
+{
+	m_pMappedFile->close();
+	m_vecBlockInfo.clear();
+	m_ulEventCount = 0;
+}
+
+bool CeleX5EventFileReader::isOpened()
+{
+	return m_pMappedFile->isOpened();
+}
+
+uint32_t CeleX5EventFileReader::getBlockCount()
+{
+	return m_vecBlockInfo.size();
+}
+
+bool CeleX5EventFileReader::getBlockInfo(uint32_t index, BlockInfo &info)
+{
+	if (index >= m_vecBlockInfo.size())
+		return false;
+	info = m_vecBlockInfo[index];
+	return true;
+}
+
+uint64_t CeleX5EventFileReader::getEventCount()
+{
+	return m_ulEventCount;
+}
+
+uint32_t CeleX5EventFileReader::findBlock(uint32_t t)
+{
+	auto itr = lower_bound(m_vecBlockInfo.begin(), m_vecBlockInfo.end(), t,
+		[](const BlockInfo& info, uint32_t value) { return info.lastT < value; });
+	return itr - m_vecBlockInfo.begin();
+}
+
+bool CeleX5EventFileReader::readBlock(uint32_t index, vector<EventData> &vecEvent)
+{
+	if (index >= m_vecBlockInfo.size())
+		return false;
+	//the offset comes from the index, which may be corrupted: check it before reading
+	uint64_t offset = m_vecBlockInfo[index].offset;
+	uint64_t fileSize = m_pMappedFile->size();
+	if (offset > fileSize || fileSize - offset < sizeof(EventBlockHeader))
+	{
+		cout << "CeleX5EventFileReader::readBlock: block " << index << " is out of the file!" << endl;
+		return false;
+	}
+	//blocks are byte-packed, copy the header out rather than read it in place
+	EventBlockHeader header;
+	memcpy(&header, m_pMappedFile->data() + offset, sizeof(header));
+	if (header.magic != EVENT_BLOCK_MAGIC ||
+		header.eventCount != m_vecBlockInfo[index].eventCount ||
+		header.eventCount > m_uiBlockEventCount ||
+		header.rawSize > EVENT_STREAM_NUMBER * sizeof(uint32_t) + uint64_t(header.eventCount) * EVENT_MAX_RAW_SIZE ||
+		header.storedSize > fileSize - offset - sizeof(header))
+	{
+		cout << "CeleX5EventFileReader::readBlock: block " << index << " is corrupted!" << endl;
+		return false;
+	}
+	const uint8_t* pStored = m_pMappedFile->data() + offset + sizeof(header);
+
+	bool bOk = false;
+	if (0 == (header.flags & EVENT_BLOCK_COMPRESSED))
+	{
+		bOk = header.storedSize == header.rawSize &&
+			decodeEvents(pStored, header.rawSize, header.eventCount, header.firstT, vecEvent);
+	}
+	else
+	{
+		static thread_local vector<uint8_t> vecRaw;
+		vecRaw.resize(header.rawSize);
+		bOk = LZCompressor::decompress(pStored, header.storedSize, vecRaw.data(), header.rawSize) &&
+			decodeEvents(vecRaw.data(), header.rawSize, header.eventCount, header.firstT, vecEvent);
+	}
+	if (!bOk)
+		cout << "CeleX5EventFileReader::readBlock: block " << index << " is corrupted!" << endl;
+	return bOk;
+}
+
+bool CeleX5EventFileReader::loadIndex()
+{
+	uint64_t fileSize = m_pMappedFile->size();
+	if (fileSize < sizeof(EventFileHeader) + sizeof(EventFileFooter))
+		return false;
+	EventFileFooter footer;
+	memcpy(&footer, m_pMappedFile->data() + fileSize - sizeof(footer), sizeof(footer));
+	if (footer.magic != EVENT_FOOTER_MAGIC ||
+		footer.indexOffset + uint64_t(footer.blockCount) * sizeof(EventIndexEntry) + sizeof(footer) != fileSize)
+		return false;
+
+	const uint8_t* pEntry = m_pMappedFile->data() + footer.indexOffset;
+	m_vecBlockInfo.resize(footer.blockCount);
+	for (uint32_t i = 0; i < footer.blockCount; i++, pEntry += sizeof(EventIndexEntry))
+	{
+		EventIndexEntry entry;
+		memcpy(&entry, pEntry, sizeof(entry));
+		m_vecBlockInfo[i].offset = entry.offset;
+		m_vecBlockInfo[i].eventCount = entry.eventCount;
+		m_vecBlockInfo[i].firstT = entry.firstT;
+		m_vecBlockInfo[i].lastT = entry.lastT;
+	}
+	return true;
+}
+
+// No footer: the file wasn't closed, keep every complete block
+void CeleX5EventFileReader::scanBlocks()
+{
+	m_vecBlockInfo.clear();
+	uint64_t fileSize = m_pMappedFile->size();
+	uint64_t offset = sizeof(EventFileHeader);
+	while (offset + sizeof(EventBlockHeader) <= fileSize)
+	{
+		EventBlockHeader header;
+		memcpy(&header, m_pMappedFile->data() + offset, sizeof(header));
+		if (header.magic != EVENT_BLOCK_MAGIC || offset + sizeof(header) + header.storedSize > fileSize)
+			break;
+		BlockInfo info;
+		info.offset = offset;
+		info.eventCount = header.eventCount;
+		info.firstT = header.firstT;
+		info.lastT = header.lastT;
+		m_vecBlockInfo.push_back(info);
+		offset += sizeof(header) + header.storedSize;
+	}
+	cout << "CeleX5EventFileReader::scanBlocks: no block index, " << m_vecBlockInfo.size() << " blocks found" << endl;
+}
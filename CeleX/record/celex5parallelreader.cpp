@@ -0,0 +1,300 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "../include/celex5/celex5parallelreader.h"
+#include "../include/celex5/celex5dataprocessor.h"
+#include "../include/celex5/celex5eventfile.h"
+#include "../base/mappedfile.h"
+#include "recordformat.h"
+#include "eventfileformat.h"
+#include <iostream>
+#include <cstring>
+
+struct CeleX5ParallelReader::Chunk
+{
+	bool                               ready;
+	vector<EventData>                  events;
+	//MIPI chunks only
+	bool                               hasEventPacket;
+	bool                               hasRowTime;
+	uint32_t                           firstRowTime;
+	size_t                             eventCountBeforeRowTime; //t of these doesn't count from firstRowTime
+	uint32_t                           firstEventPacketFormat;
+	uint32_t                           lastEventPacketFormat;
+	CeleX5DataProcessor::DecoderState  endState;
+};
+
+CeleX5ParallelReader::CeleX5ParallelReader(uint32_t threadNumber)
+	: m_bEventFile(false)
+	, m_uiThreadNumber(threadNumber)
+	, m_uiChunkCount(0)
+	, m_uiNextChunk(0)
+	, m_uiReadChunk(0)
+	, m_bStopped(true)
+	, m_uiEventTCounter(0)
+	, m_uiLastRowTime(0)
+	, m_uiEventPacketFormat(2)
+	, m_bRowTimeValid(false)
+{
+	if (0 == m_uiThreadNumber)
+		m_uiThreadNumber = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+	m_pMappedFile = new MappedFile;
+	m_pEventFileReader = new CeleX5EventFileReader;
+}
+
+CeleX5ParallelReader::~CeleX5ParallelReader()
+{
+	closeFile();
+	if (m_pMappedFile)
+	{
+		delete m_pMappedFile;
+		m_pMappedFile = NULL;
+	}
+	if (m_pEventFileReader)
+	{
+		delete m_pEventFileReader;
+		m_pEventFileReader = NULL;
+	}
+}
+
+bool CeleX5ParallelReader::openFile(const string& filePath)
+{
+	closeFile();
+	if (!m_pMappedFile->open(filePath, true))
+		return false;
+	const char* pMagic = (const char*)m_pMappedFile->data();
+	if (m_pMappedFile->size() >= RECORD_FILE_HEADER_SIZE &&
+		memcmp(pMagic, RECORD_FILE_MAGIC, sizeof(RECORD_FILE_MAGIC)) == 0 &&
+		((const RecordFileHeader*)pMagic)->version == RECORD_FILE_VERSION &&
+		((const RecordFileHeader*)pMagic)->blockSize == RECORD_BLOCK_SIZE)
+	{
+		m_bEventFile = false;
+		m_uiChunkCount = (m_pMappedFile->size() - RECORD_FILE_HEADER_SIZE) / RECORD_BLOCK_SIZE;
+	}
+	else if (m_pMappedFile->size() >= sizeof(EVENT_FILE_MAGIC) &&
+		memcmp(pMagic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC)) == 0)
+	{
+		m_pMappedFile->close();
+		if (!m_pEventFileReader->openFile(filePath))
+			return false;
+		m_bEventFile = true;
+		m_uiChunkCount = m_pEventFileReader->getBlockCount();
+	}
+	else
+	{
+		cout << "CeleX5ParallelReader::openFile: unknown file format " << filePath << endl;
+		m_pMappedFile->close();
+		return false;
+	}
+
+	m_vecChunk.resize(2 * m_uiThreadNumber);
+	for (size_t i = 0; i < m_vecChunk.size(); i++)
+	{
+		m_vecChunk[i] = new Chunk;
+		m_vecChunk[i]->ready = false;
+	}
+	m_uiNextChunk = 0;
+	m_uiReadChunk = 0;
+	m_uiEventTCounter = 0;
+	m_uiLastRowTime = 0;
+	m_uiEventPacketFormat = 2;
+	m_bRowTimeValid = false;
+	m_bStopped = false;
+	for (uint32_t i = 0; i < m_uiThreadNumber; i++)
+		m_vecThread.push_back(thread(&CeleX5ParallelReader::decodeThread, this));
+	return true;
+}
+
+void CeleX5ParallelReader::closeFile()
+{
+	{
+		lock_guard<mutex> lock(m_mutexChunk);
+		m_bStopped = true;
+	}
+	m_conditionChunk.notify_all();
+	for (auto itr = m_vecThread.begin(); itr != m_vecThread.end(); itr++)
+		itr->join();
+	m_vecThread.clear();
+	for (auto itr = m_vecChunk.begin(); itr != m_vecChunk.end(); itr++)
+		delete *itr;
+	m_vecChunk.clear();
+	m_pMappedFile->close();
+	m_pEventFileReader->closeFile();
+	m_uiChunkCount = 0;
+}
+
+bool CeleX5ParallelReader::isOpened()
+{
+	return !m_bStopped;
+}
+
+uint32_t CeleX5ParallelReader::getChunkCount()
+{
+	return m_uiChunkCount;
+}
+
+bool CeleX5ParallelReader::getNextChunk(vector<EventData> &vecEvent)
+{
+	Chunk* pChunk = NULL;
+	{
+		unique_lock<mutex> lock(m_mutexChunk);
+		if (m_bStopped || m_uiReadChunk >= m_uiChunkCount)
+			return false;
+		pChunk = m_vecChunk[m_uiReadChunk % m_vecChunk.size()];
+		m_conditionChunk.wait(lock, [this, pChunk] { return m_bStopped || pChunk->ready; });
+		if (!pChunk->ready)
+			return false;
+	}
+	if (!m_bEventFile)
+		rebaseTimeStamps(pChunk);
+	vecEvent.swap(pChunk->events);
+	pChunk->events.clear();
+	{
+		lock_guard<mutex> lock(m_mutexChunk);
+		pChunk->ready = false;
+		m_uiReadChunk++;
+	}
+	m_conditionChunk.notify_all();
+	return true;
+}
+
+void CeleX5ParallelReader::decodeThread()
+{
+	CeleX5DataProcessor* pProcessor = m_bEventFile ? NULL : new CeleX5DataProcessor;
+	while (true)
+	{
+		uint32_t index = 0;
+		Chunk* pChunk = NULL;
+		{
+			unique_lock<mutex> lock(m_mutexChunk);
+			//a slot of the ring is free once the chunk a lap ahead has been handed out
+			m_conditionChunk.wait(lock, [this] { return m_bStopped || m_uiNextChunk >= m_uiChunkCount ||
+				m_uiNextChunk < m_uiReadChunk + m_vecChunk.size(); });
+			if (m_bStopped || m_uiNextChunk >= m_uiChunkCount)
+				break;
+			index = m_uiNextChunk++;
+			pChunk = m_vecChunk[index % m_vecChunk.size()];
+		}
+		if (m_bEventFile)
+			m_pEventFileReader->readBlock(index, pChunk->events);
+		else
+			decodeMIPIChunk(index, pChunk, pProcessor);
+		{
+			lock_guard<mutex> lock(m_mutexChunk);
+			pChunk->ready = true;
+		}
+		m_conditionChunk.notify_all();
+	}
+	delete pProcessor;
+}
+
+void CeleX5ParallelReader::decodeMIPIChunk(uint32_t index, Chunk* pChunk, CeleX5DataProcessor* pProcessor)
+{
+	pChunk->events.clear();
+	pChunk->hasEventPacket = false;
+	pChunk->hasRowTime = false;
+	pChunk->eventCountBeforeRowTime = 0;
+
+	const uint8_t* pBlock = m_pMappedFile->data() + RECORD_FILE_HEADER_SIZE + uint64_t(index) * RECORD_BLOCK_SIZE;
+	const RecordBlockHeader* pBlockHeader = (const RecordBlockHeader*)pBlock;
+	if (!isRecordBlockValid(pBlockHeader))
+	{
+		cout << "CeleX5ParallelReader::decodeMIPIChunk: invalid block " << index << endl;
+		return;
+	}
+	vector<EventData> vecEvent;
+	const uint8_t* pRecord = pBlock + sizeof(RecordBlockHeader);
+	const uint8_t* pRecordEnd = pRecord + pBlockHeader->dataSize;
+	for (uint32_t i = 0; i < pBlockHeader->recordCount; i++)
+	{
+		const RecordPacketHeader* pHeader = (const RecordPacketHeader*)pRecord;
+		if (pHeader->dataSize > RECORD_MAX_PACKET_SIZE ||
+			uint64_t(pRecordEnd - pRecord) < sizeof(RecordPacketHeader) + recordPaddedSize(pHeader->dataSize))
+		{
+			cout << "CeleX5ParallelReader::decodeMIPIChunk: corrupted block " << index << endl;
+			break;
+		}
+		pRecord += sizeof(RecordPacketHeader) + recordPaddedSize(pHeader->dataSize);
+		if (pHeader->type != RECORD_TYPE_MIPI_PACKET || pHeader->mode >= CeleX5::Full_Picture_Mode)
+			continue;
+
+		if (!pChunk->hasEventPacket)
+		{
+			//t of the chunk counts from its first row
+			CeleX5DataProcessor::DecoderState state = { 0, 0, false };
+			pProcessor->setEventPacketFormat(pHeader->state.eventPacketFormat);
+			pProcessor->setDecoderState(state);
+			pChunk->hasEventPacket = true;
+			pChunk->firstEventPacketFormat = pProcessor->getEventPacketFormat();
+		}
+		else
+		{
+			pProcessor->setEventPacketFormat(pHeader->state.eventPacketFormat);
+		}
+		pProcessor->processMIPIData((const uint8_t*)(pHeader + 1), pHeader->dataSize);
+		pProcessor->getEventDataVector(vecEvent);
+		pChunk->events.insert(pChunk->events.end(), vecEvent.begin(), vecEvent.end());
+		if (!pChunk->hasRowTime)
+		{
+			pChunk->eventCountBeforeRowTime += pProcessor->getEventCountBeforeRowTime();
+			CeleX5DataProcessor::DecoderState state;
+			pProcessor->getDecoderState(state);
+			if (state.rowTimeValid)
+			{
+				//the counter has moved by the row times after the first one
+				pChunk->hasRowTime = true;
+				pChunk->firstRowTime = (state.lastRowTime - state.eventTCounter) & (pProcessor->getRowTimePeriod() - 1);
+			}
+		}
+	}
+	if (pChunk->hasEventPacket)
+	{
+		pChunk->lastEventPacketFormat = pProcessor->getEventPacketFormat();
+		pProcessor->getDecoderState(pChunk->endState);
+	}
+}
+
+// Same arithmetic as CeleX5DataProcessor::updateRowTimeStamp across the chunk boundary.
+// The events decoded before the first row time of the chunk were captured at the last
+// row time of the previous chunk, the others count from the first row time of the chunk
+void CeleX5ParallelReader::rebaseTimeStamps(Chunk* pChunk)
+{
+	if (!pChunk->hasEventPacket)
+		return;
+	if (pChunk->firstEventPacketFormat != m_uiEventPacketFormat)
+		m_bRowTimeValid = false;
+	for (size_t i = 0; i < pChunk->eventCountBeforeRowTime && i < pChunk->events.size(); i++)
+		pChunk->events[i].t += m_uiEventTCounter;
+	if (!pChunk->hasRowTime)
+	{
+		if (pChunk->lastEventPacketFormat != pChunk->firstEventPacketFormat)
+			m_bRowTimeValid = false;
+		m_uiEventPacketFormat = pChunk->lastEventPacketFormat;
+		return;
+	}
+
+	uint32_t period = 0 == pChunk->firstEventPacketFormat ? 0x10000 : 0x1000;
+	uint32_t base = m_uiEventTCounter;
+	if (m_bRowTimeValid)
+		base += (pChunk->firstRowTime - m_uiLastRowTime) & (period - 1);
+	for (size_t i = pChunk->eventCountBeforeRowTime; i < pChunk->events.size(); i++)
+		pChunk->events[i].t += base;
+
+	m_uiEventTCounter = base + pChunk->endState.eventTCounter;
+	m_uiLastRowTime = pChunk->endState.lastRowTime;
+	m_bRowTimeValid = pChunk->endState.rowTimeValid;
+	m_uiEventPacketFormat = pChunk->lastEventPacketFormat;
+}
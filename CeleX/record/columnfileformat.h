@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef COLUMNFILEFORMAT_H
+#define COLUMNFILEFORMAT_H
+
+#include <stdint.h>
+
+// Layout of a columnar event file (all fields little endian):
+//   ColumnFileHeader
+//   row groups of up to rowGroupSize events, each COLUMN_NUMBER column chunks in the
+//   order of ColumnId (the same as CeleX5ColumnFileReader::Column); a chunk is a plain array of rowCount values of its ColumnType,
+//   starting at an offset aligned to COLUMN_CHUNK_ALIGNMENT
+//   ColumnChunkMeta for every chunk, row group by row group, then ColumnFileFooter
+// Every chunk carries the smallest and largest EventData::t of its row group, so a
+// reader looking for a time range skips whole row groups from the footer alone, and
+// reads only the columns it needs. The chunks are uncompressed fixed width arrays that
+// map straight onto typed arrays (numpy.memmap, Arrow buffers).
+
+#define COLUMN_FILE_MAGIC       "CX5COL"
+#define COLUMN_FILE_VERSION     1
+#define COLUMN_FOOTER_MAGIC     0x58444C43 //"CLDX"
+#define COLUMN_CHUNK_ALIGNMENT  8
+
+enum ColumnId {
+	COLUMN_COL = 0,
+	COLUMN_ROW,
+	COLUMN_BRIGHTNESS,
+	COLUMN_POLARITY,
+	COLUMN_T,
+	COLUMN_NUMBER
+};
+
+enum ColumnType {
+	COLUMN_TYPE_UINT16 = 0,
+	COLUMN_TYPE_INT8,
+	COLUMN_TYPE_UINT32
+};
+
+typedef struct ColumnFileHeader
+{
+	char        magic[8];
+	uint32_t    version;
+	uint32_t    rowGroupSize;
+	uint32_t    columnNumber;
+	uint32_t    reserved;
+} ColumnFileHeader;
+
+typedef struct ColumnChunkMeta
+{
+	uint64_t    offset;
+	uint32_t    size; //bytes, rowCount * size of the type
+	uint32_t    rowCount;
+	uint16_t    column; //ColumnId
+	uint16_t    type; //ColumnType
+	uint32_t    rowGroup;
+	uint32_t    minT; //EventData::t range of the row group
+	uint32_t    maxT;
+	int32_t     minValue; //value range of the chunk
+	int32_t     maxValue;
+} ColumnChunkMeta;
+
+typedef struct ColumnFileFooter
+{
+	uint64_t    metaOffset;
+	uint32_t    rowGroupCount;
+	uint32_t    magic;
+} ColumnFileFooter;
+
+#endif // COLUMNFILEFORMAT_H
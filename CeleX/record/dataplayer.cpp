@@ -0,0 +1,430 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "dataplayer.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+DataPlayer::DataPlayer()
+	: m_pFileData(NULL)
+	, m_ulFileSize(0)
+	, m_ulEndOffset(0)
+	, m_pBlockHeader(NULL)
+	, m_ulBlockOffset(0)
+	, m_uiRecordOffset(0)
+	, m_uiRecordIndex(0)
+	, m_ulPacketNumber(0)
+	, m_bIndexFileLoaded(false)
+	, m_bRealTimeEnabled(false)
+	, m_bPacingStarted(false)
+	, m_ulPacingStartTimeStamp(0)
+{
+}
+
+DataPlayer::~DataPlayer()
+{
+	closeFile();
+}
+
+bool DataPlayer::openFile(const string& filePath)
+{
+	closeFile();
+	if (!m_mappedFile.open(filePath, true))
+		return false;
+	m_pFileData = m_mappedFile.data();
+	m_ulFileSize = m_mappedFile.size();
+
+	const RecordFileHeader* pFileHeader = getFileHeader();
+	if (m_ulFileSize < RECORD_FILE_HEADER_SIZE ||
+		memcmp(pFileHeader->magic, RECORD_FILE_MAGIC, sizeof(RECORD_FILE_MAGIC)) != 0 ||
+		pFileHeader->version != RECORD_FILE_VERSION ||
+		pFileHeader->blockSize != RECORD_BLOCK_SIZE)
+	{
+		cout << "DataPlayer::openFile: " << filePath << " is not a CeleX5 MIPI recording!" << endl;
+		closeFile();
+		return false;
+	}
+	findEndOffset();
+	m_bIndexFileLoaded = loadIndexFile(filePath + RECORD_INDEX_SUFFIX);
+	if (!m_bIndexFileLoaded)
+		buildIndex();
+	rewind();
+	return true;
+}
+
+void DataPlayer::closeFile()
+{
+	m_mappedFile.close();
+	m_pFileData = NULL;
+	m_ulFileSize = 0;
+	m_ulEndOffset = 0;
+	m_pBlockHeader = NULL;
+	m_vecIndexEntry.clear();
+	m_bIndexFileLoaded = false;
+}
+
+bool DataPlayer::isOpened()
+{
+	return NULL != m_pFileData;
+}
+
+void DataPlayer::setRealTimeEnabled(bool enable)
+{
+	m_bRealTimeEnabled = enable;
+	m_bPacingStarted = false;
+}
+
+bool DataPlayer::isRealTimeEnabled()
+{
+	return m_bRealTimeEnabled;
+}
+
+const RecordPacketHeader* DataPlayer::getNextRecord(const uint8_t** ppData)
+{
+	const RecordPacketHeader* pHeader = peekRecord();
+	if (NULL == pHeader)
+		return NULL;
+	skipRecord(pHeader);
+	if (m_bRealTimeEnabled)
+		waitForRecordTime(pHeader->timeStamp);
+	*ppData = (const uint8_t*)(pHeader + 1);
+	return pHeader;
+}
+
+bool DataPlayer::isEndOfFile()
+{
+	return NULL == m_pBlockHeader;
+}
+
+void DataPlayer::rewind()
+{
+	m_bPacingStarted = false;
+	m_ulPacketNumber = 0;
+	loadBlock(RECORD_FILE_HEADER_SIZE);
+}
+
+bool DataPlayer::seekToTime(uint64_t time)
+{
+	if (m_vecIndexEntry.empty())
+		return false;
+	uint64_t timeStamp = m_vecIndexEntry[0].timeStamp + time;
+	auto itr = upper_bound(m_vecIndexEntry.begin(), m_vecIndexEntry.end(), timeStamp,
+		[](uint64_t value, const RecordIndexEntry& entry) { return value < entry.timeStamp; });
+	if (itr != m_vecIndexEntry.begin())
+		itr--;
+	if (!seekToEntry(*itr))
+		return rebuildIndex() && seekToTime(time);
+
+	const RecordPacketHeader* pHeader = NULL;
+	while ((pHeader = peekRecord()) != NULL)
+	{
+		if (RECORD_TYPE_MIPI_PACKET == pHeader->type && pHeader->timeStamp >= timeStamp)
+			return true;
+		skipRecord(pHeader);
+	}
+	return false;
+}
+
+bool DataPlayer::seekToPacket(uint64_t packetNumber)
+{
+	if (m_vecIndexEntry.empty())
+		return false;
+	auto itr = upper_bound(m_vecIndexEntry.begin(), m_vecIndexEntry.end(), packetNumber,
+		[](uint64_t value, const RecordIndexEntry& entry) { return value < entry.packetNumber; });
+	if (itr != m_vecIndexEntry.begin())
+		itr--;
+	if (!seekToEntry(*itr))
+		return rebuildIndex() && seekToPacket(packetNumber);
+
+	const RecordPacketHeader* pHeader = NULL;
+	while ((pHeader = peekRecord()) != NULL)
+	{
+		if (RECORD_TYPE_MIPI_PACKET == pHeader->type && m_ulPacketNumber == packetNumber)
+			return true;
+		skipRecord(pHeader);
+	}
+	return false;
+}
+
+uint64_t DataPlayer::getPacketNumber()
+{
+	return m_ulPacketNumber;
+}
+
+uint64_t DataPlayer::getStartTimeStamp()
+{
+	return m_vecIndexEntry.empty() ? 0 : m_vecIndexEntry[0].timeStamp;
+}
+
+const RecordFileHeader* DataPlayer::getFileHeader()
+{
+	return (const RecordFileHeader*)m_pFileData;
+}
+
+// The torn tail of an interrupted recording is behind m_ulEndOffset and ends the playback
+bool DataPlayer::loadBlock(uint64_t offset)
+{
+	m_pBlockHeader = NULL;
+	m_ulBlockOffset = offset;
+	m_uiRecordOffset = 0;
+	m_uiRecordIndex = 0;
+	if (NULL == m_pFileData || offset + RECORD_BLOCK_SIZE > m_ulEndOffset)
+		return false;
+
+	const RecordBlockHeader* pBlockHeader = (const RecordBlockHeader*)(m_pFileData + offset);
+	if (!isRecordBlockValid(pBlockHeader))
+	{
+		cout << "DataPlayer::loadBlock: invalid block at offset " << offset << endl;
+		return false;
+	}
+	m_pBlockHeader = pBlockHeader;
+	return true;
+}
+
+const RecordPacketHeader* DataPlayer::peekRecord()
+{
+	while (m_pBlockHeader)
+	{
+		if (m_uiRecordIndex < m_pBlockHeader->recordCount)
+		{
+			if (uint64_t(m_uiRecordOffset) + sizeof(RecordPacketHeader) > m_pBlockHeader->dataSize)
+			{
+				cout << "DataPlayer::peekRecord: corrupted block " << m_pBlockHeader->blockIndex << endl;
+				m_pBlockHeader = NULL;
+				break;
+			}
+			const uint8_t* pRecord = (const uint8_t*)(m_pBlockHeader + 1) + m_uiRecordOffset;
+			const RecordPacketHeader* pHeader = (const RecordPacketHeader*)pRecord;
+			uint32_t recordSize = sizeof(RecordPacketHeader) + recordPaddedSize(pHeader->dataSize);
+			if (pHeader->dataSize > RECORD_MAX_PACKET_SIZE || m_uiRecordOffset + recordSize > m_pBlockHeader->dataSize)
+			{
+				cout << "DataPlayer::peekRecord: corrupted block " << m_pBlockHeader->blockIndex << endl;
+				m_pBlockHeader = NULL;
+				break;
+			}
+			return pHeader;
+		}
+		loadBlock(m_ulBlockOffset + RECORD_BLOCK_SIZE);
+	}
+	return NULL;
+}
+
+void DataPlayer::skipRecord(const RecordPacketHeader* pHeader)
+{
+	m_uiRecordOffset += sizeof(RecordPacketHeader) + recordPaddedSize(pHeader->dataSize);
+	m_uiRecordIndex++;
+	if (RECORD_TYPE_MIPI_PACKET == pHeader->type)
+		m_ulPacketNumber++;
+}
+
+void DataPlayer::waitForRecordTime(uint64_t timeStamp)
+{
+	//restart the pacing when the host clock stepped backwards during the recording
+	if (!m_bPacingStarted || timeStamp < m_ulPacingStartTimeStamp)
+	{
+		m_ulPacingStartTimeStamp = timeStamp;
+		m_tpPacingStart = chrono::steady_clock::now();
+		m_bPacingStarted = true;
+		return;
+	}
+	this_thread::sleep_until(m_tpPacingStart + chrono::microseconds(timeStamp - m_ulPacingStartTimeStamp));
+}
+
+bool DataPlayer::loadIndexFile(const string& filePath)
+{
+	ifstream file(filePath.c_str(), ios::in | ios::binary);
+	if (!file.is_open())
+		return false;
+	RecordIndexHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file.good() || memcmp(header.magic, RECORD_INDEX_MAGIC, sizeof(RECORD_INDEX_MAGIC)) != 0 ||
+		header.version != RECORD_INDEX_VERSION)
+	{
+		cout << "DataPlayer::loadIndexFile: " << filePath << " is not a CeleX5 recording index!" << endl;
+		return false;
+	}
+	//an index of another recording at the same path, or of a recording cut short later on
+	if (header.startTime != getFileHeader()->startTime ||
+		header.blockCount != (m_ulEndOffset - RECORD_FILE_HEADER_SIZE) / RECORD_BLOCK_SIZE)
+	{
+		cout << "DataPlayer::loadIndexFile: " << filePath << " doesn't belong to the recording!" << endl;
+		return false;
+	}
+	//the entry count is checked against the file size before anything is allocated for it
+	file.seekg(0, ios::end);
+	uint64_t entryBytes = uint64_t(file.tellg()) - sizeof(header);
+	if (!file.good() || header.entryCount > entryBytes / sizeof(RecordIndexEntry) ||
+		header.entryCount * sizeof(RecordIndexEntry) != entryBytes)
+	{
+		cout << "DataPlayer::loadIndexFile: " << filePath << " is truncated or corrupted!" << endl;
+		return false;
+	}
+	file.seekg(sizeof(header), ios::beg);
+	m_vecIndexEntry.resize(header.entryCount);
+	if (header.entryCount > 0)
+		file.read((char*)m_vecIndexEntry.data(), header.entryCount * sizeof(RecordIndexEntry));
+	if (!file.good())
+	{
+		m_vecIndexEntry.clear();
+		return false;
+	}
+	return true;
+}
+
+// Blocks are written in order, so only the last blocks of a recording cut short by a
+// crash can be incomplete: step back from the end of the file to the last valid block
+void DataPlayer::findEndOffset()
+{
+	uint64_t blockCount = (m_ulFileSize - RECORD_FILE_HEADER_SIZE) / RECORD_BLOCK_SIZE;
+	while (blockCount > 0)
+	{
+		const uint8_t* pBlock = m_pFileData + RECORD_FILE_HEADER_SIZE + (blockCount - 1) * RECORD_BLOCK_SIZE;
+		if (isRecordBlockValid((const RecordBlockHeader*)pBlock))
+			break;
+		blockCount--;
+	}
+	m_ulEndOffset = RECORD_FILE_HEADER_SIZE + blockCount * RECORD_BLOCK_SIZE;
+	if (m_ulEndOffset < m_ulFileSize)
+		cout << "DataPlayer::findEndOffset: " << m_ulFileSize - m_ulEndOffset << " bytes of torn tail skipped" << endl;
+}
+
+// No index file: take the entries saved in the checkpoints, then add one entry per
+// block, at its first MIPI packet, for the records after the last checkpoint
+void DataPlayer::buildIndex()
+{
+	m_vecIndexEntry.clear();
+	uint32_t checkpointCount = loadCheckpoints();
+	uint64_t checkpointEntryCount = m_vecIndexEntry.size();
+	const RecordPacketHeader* pHeader = NULL;
+	uint64_t lastBlockOffset = 0;
+	while ((pHeader = peekRecord()) != NULL)
+	{
+		if (RECORD_TYPE_MIPI_PACKET == pHeader->type && m_ulBlockOffset != lastBlockOffset)
+		{
+			RecordIndexEntry entry;
+			entry.timeStamp = pHeader->timeStamp;
+			entry.packetNumber = m_ulPacketNumber;
+			entry.blockOffset = m_ulBlockOffset;
+			entry.recordOffset = m_uiRecordOffset;
+			entry.recordIndex = m_uiRecordIndex;
+			entry.mode = pHeader->mode;
+			entry.reserved = 0;
+			m_vecIndexEntry.push_back(entry);
+			lastBlockOffset = m_ulBlockOffset;
+		}
+		skipRecord(pHeader);
+	}
+	cout << "DataPlayer::buildIndex: " << checkpointEntryCount << " entries from "
+		<< checkpointCount << " checkpoints, " << m_vecIndexEntry.size() - checkpointEntryCount << " rebuilt" << endl;
+}
+
+// Follow the checkpoint chain back from the last valid block and leave the player
+// positioned behind the last checkpoint; from the start of the file if it fails
+uint32_t DataPlayer::loadCheckpoints()
+{
+	rewind();
+	if (NULL == m_pBlockHeader)
+		return 0;
+	const RecordBlockHeader* pLastBlock = (const RecordBlockHeader*)(m_pFileData + m_ulEndOffset - RECORD_BLOCK_SIZE);
+	uint64_t lastOffset = pLastBlock->checkpointOffset;
+	RecordCheckpoint lastCheckpoint;
+	memset(&lastCheckpoint, 0, sizeof(lastCheckpoint));
+
+	vector<RecordIndexEntry> vecEntry; //backwards
+	uint32_t checkpointCount = 0;
+	uint64_t offset = lastOffset;
+	while (offset > 0)
+	{
+		uint64_t blockOffset = RECORD_FILE_HEADER_SIZE + (offset - RECORD_FILE_HEADER_SIZE) / RECORD_BLOCK_SIZE * RECORD_BLOCK_SIZE;
+		uint64_t blockEnd = blockOffset + RECORD_BLOCK_SIZE;
+		const RecordPacketHeader* pHeader = (const RecordPacketHeader*)(m_pFileData + offset);
+		RecordCheckpoint checkpoint;
+		bool bValid = offset >= RECORD_FILE_HEADER_SIZE + sizeof(RecordBlockHeader) && blockEnd <= m_ulEndOffset &&
+			offset + sizeof(RecordPacketHeader) + sizeof(RecordCheckpoint) <= blockEnd &&
+			RECORD_TYPE_CHECKPOINT == pHeader->type && offset + sizeof(RecordPacketHeader) + pHeader->dataSize <= blockEnd;
+		if (bValid)
+		{
+			memcpy(&checkpoint, pHeader + 1, sizeof(checkpoint));
+			bValid = pHeader->dataSize == sizeof(RecordCheckpoint) + uint64_t(checkpoint.entryCount) * sizeof(RecordIndexEntry) &&
+				checkpoint.previousOffset < offset;
+		}
+		if (!bValid)
+		{
+			cout << "DataPlayer::loadCheckpoints: invalid checkpoint at offset " << offset << endl;
+			m_vecIndexEntry.clear();
+			rewind();
+			return 0;
+		}
+		const RecordIndexEntry* pEntry = (const RecordIndexEntry*)((const uint8_t*)(pHeader + 1) + sizeof(RecordCheckpoint));
+		for (uint32_t i = checkpoint.entryCount; i > 0; i--)
+			vecEntry.push_back(pEntry[i - 1]);
+		if (offset == lastOffset)
+			lastCheckpoint = checkpoint;
+		offset = checkpoint.previousOffset;
+		checkpointCount++;
+	}
+	m_vecIndexEntry.assign(vecEntry.rbegin(), vecEntry.rend());
+	if (0 == checkpointCount)
+		return 0;
+
+	//position behind the last checkpoint record
+	loadBlock(RECORD_FILE_HEADER_SIZE + (lastOffset - RECORD_FILE_HEADER_SIZE) / RECORD_BLOCK_SIZE * RECORD_BLOCK_SIZE);
+	const RecordPacketHeader* pHeader = NULL;
+	while ((pHeader = peekRecord()) != NULL)
+	{
+		bool bCheckpoint = (const uint8_t*)pHeader == m_pFileData + lastOffset;
+		skipRecord(pHeader);
+		if (bCheckpoint)
+			break;
+	}
+	m_ulPacketNumber = lastCheckpoint.packetNumber;
+	return checkpointCount;
+}
+
+// The entry may come from a corrupted index file: it must point at a record header
+// inside a valid block
+bool DataPlayer::seekToEntry(const RecordIndexEntry& entry)
+{
+	m_bPacingStarted = false;
+	bool bValid = entry.blockOffset >= RECORD_FILE_HEADER_SIZE &&
+		0 == (entry.blockOffset - RECORD_FILE_HEADER_SIZE) % RECORD_BLOCK_SIZE &&
+		0 == (entry.recordOffset & 7) && loadBlock(entry.blockOffset) &&
+		entry.recordIndex < m_pBlockHeader->recordCount &&
+		uint64_t(entry.recordOffset) + sizeof(RecordPacketHeader) <= m_pBlockHeader->dataSize;
+	if (!bValid)
+	{
+		cout << "DataPlayer::seekToEntry: invalid index entry, packet " << entry.packetNumber << endl;
+		m_pBlockHeader = NULL;
+		return false;
+	}
+	m_uiRecordOffset = entry.recordOffset;
+	m_uiRecordIndex = entry.recordIndex;
+	m_ulPacketNumber = entry.packetNumber;
+	return true;
+}
+
+// An entry of the index file is invalid: replace the index by the one built from the recording
+bool DataPlayer::rebuildIndex()
+{
+	if (!m_bIndexFileLoaded)
+		return false;
+	m_bIndexFileLoaded = false;
+	buildIndex();
+	return !m_vecIndexEntry.empty();
+}
@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef DATAPLAYER_H
+#define DATAPLAYER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "recordformat.h"
+#include "../base/mappedfile.h"
+
+using namespace std;
+
+// Read back a recording written by DataRecorder.
+// The file is memory mapped and records are handed out as pointers into the mapping,
+// which stay valid until closeFile. In real time mode getNextRecord sleeps until the
+// stored time stamp of the record is due, relative to the first record played.
+// Seeking uses the index written next to the recording; for a recording without one
+// (e.g. an interrupted recording) the index is taken from the checkpoints in the file and
+// completed by walking the record headers after the last one. Blocks are checked against
+// their checksum and a torn tail is cut off when the file is opened.
+class DataPlayer
+{
+public:
+	DataPlayer();
+	~DataPlayer();
+
+	bool openFile(const string& filePath);
+	void closeFile();
+	bool isOpened();
+
+	void setRealTimeEnabled(bool enable);
+	bool isRealTimeEnabled();
+
+	//returns NULL at the end of the file, *ppData points to header->dataSize bytes
+	const RecordPacketHeader* getNextRecord(const uint8_t** ppData);
+	bool isEndOfFile();
+	void rewind();
+
+	//position at the first MIPI packet at or after the time, unit: us from the first packet
+	bool seekToTime(uint64_t time);
+	bool seekToPacket(uint64_t packetNumber);
+	uint64_t getPacketNumber(); //of the next MIPI packet
+	uint64_t getStartTimeStamp(); //of the first MIPI packet, 0 if there is none
+
+	const RecordFileHeader* getFileHeader();
+
+private:
+	bool loadBlock(uint64_t offset);
+	const RecordPacketHeader* peekRecord();
+	void skipRecord(const RecordPacketHeader* pHeader);
+	void waitForRecordTime(uint64_t timeStamp);
+	bool loadIndexFile(const string& filePath);
+	void findEndOffset();
+	void buildIndex();
+	uint32_t loadCheckpoints();
+	bool seekToEntry(const RecordIndexEntry& entry);
+	bool rebuildIndex();
+
+private:
+	MappedFile                     m_mappedFile;
+	const uint8_t*                 m_pFileData;
+	uint64_t                       m_ulFileSize;
+	uint64_t                       m_ulEndOffset; //end of the last valid block
+
+	const RecordBlockHeader*       m_pBlockHeader; //NULL once the end of the file is reached
+	uint64_t                       m_ulBlockOffset;
+	uint32_t                       m_uiRecordOffset; //relative to the first record of the block
+	uint32_t                       m_uiRecordIndex;
+	uint64_t                       m_ulPacketNumber;
+
+	vector<RecordIndexEntry>       m_vecIndexEntry;
+	bool                           m_bIndexFileLoaded; //the entries come from the index file
+
+	bool                           m_bRealTimeEnabled;
+	bool                           m_bPacingStarted;
+	uint64_t                       m_ulPacingStartTimeStamp;
+	chrono::steady_clock::time_point m_tpPacingStart;
+};
+
+#endif // DATAPLAYER_H
@@ -0,0 +1,478 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "datarecorder.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+static uint8_t* allocAlignedBlock(uint32_t size)
+{
+#ifdef _WIN32
+	return (uint8_t*)_aligned_malloc(size, RECORD_ALIGNMENT);
+#else
+	void* pBlock = NULL;
+	if (posix_memalign(&pBlock, RECORD_ALIGNMENT, size) != 0)
+		return NULL;
+	return (uint8_t*)pBlock;
+#endif
+}
+
+static void freeAlignedBlock(uint8_t* pBlock)
+{
+#ifdef _WIN32
+	_aligned_free(pBlock);
+#else
+	free(pBlock);
+#endif
+}
+
+DataRecorder::DataRecorder(uint32_t blockNumber)
+	: m_iFile(-1)
+	, m_ulStartTime(0)
+	, m_bDirectIO(false)
+	, m_bRecording(false)
+	, m_bStopWriting(false)
+	, m_bWriteError(false)
+	, m_uiBlockNumber(blockNumber < 2 ? 2 : blockNumber)
+	, m_pCurrentBlock(NULL)
+	, m_uiCurrentDataSize(0)
+	, m_uiCurrentRecordCount(0)
+	, m_uiBlockIndex(0)
+	, m_ulPacketCount(0)
+	, m_ulMIPIPacketCount(0)
+	, m_ulDroppedPacketCount(0)
+	, m_ulWrittenBytes(0)
+	, m_uiIndexInterval(100)
+	, m_uiCheckpointInterval(1000)
+	, m_bCheckpointStarted(false)
+	, m_ulCheckpointTimeStamp(0)
+	, m_ulCheckpointOffset(0)
+	, m_uiCheckpointEntry(0)
+	, m_bCurrentBlockCheckpoint(false)
+{
+}
+
+DataRecorder::~DataRecorder()
+{
+	stopRecording();
+	for (auto itr = m_vecBlock.begin(); itr != m_vecBlock.end(); itr++)
+		freeAlignedBlock(*itr);
+	m_vecBlock.clear();
+}
+
+bool DataRecorder::startRecording(const string& filePath, bool bDirectIO)
+{
+	lock_guard<mutex> lock(m_mutexWrite);
+	if (m_bRecording)
+	{
+		cout << "DataRecorder::startRecording: already recording!" << endl;
+		return false;
+	}
+	if (m_vecBlock.empty())
+	{
+		for (uint32_t i = 0; i < m_uiBlockNumber; i++)
+		{
+			uint8_t* pBlock = allocAlignedBlock(RECORD_BLOCK_SIZE);
+			if (NULL == pBlock)
+			{
+				cout << "DataRecorder::startRecording: out of memory!" << endl;
+				return false;
+			}
+			m_vecBlock.push_back(pBlock);
+		}
+	}
+	//an index left by an earlier recording at this path would be taken for this one's
+	//if the recording is interrupted, and no index file is written then
+	remove((filePath + RECORD_INDEX_SUFFIX).c_str());
+	if (!openFile(filePath, bDirectIO))
+		return false;
+
+	//the file header takes a whole aligned block of its own
+	uint8_t* pHeader = m_vecBlock[0];
+	memset(pHeader, 0, RECORD_FILE_HEADER_SIZE);
+	RecordFileHeader* pFileHeader = (RecordFileHeader*)pHeader;
+	memcpy(pFileHeader->magic, RECORD_FILE_MAGIC, sizeof(RECORD_FILE_MAGIC));
+	pFileHeader->version = RECORD_FILE_VERSION;
+	pFileHeader->blockSize = RECORD_BLOCK_SIZE;
+	pFileHeader->startTime = chrono::duration_cast<chrono::microseconds>(
+		chrono::system_clock::now().time_since_epoch()).count();
+	if (!writeFile(pHeader, RECORD_FILE_HEADER_SIZE))
+	{
+		closeFile();
+		return false;
+	}
+
+	m_strFilePath = filePath;
+	m_ulStartTime = pFileHeader->startTime;
+	m_vecIndexEntry.clear();
+	m_bCheckpointStarted = false;
+	m_ulCheckpointOffset = 0;
+	m_uiCheckpointEntry = 0;
+	m_bCurrentBlockCheckpoint = false;
+	m_vecFreeBlock.assign(m_vecBlock.begin(), m_vecBlock.end());
+	m_queueFullBlock.clear();
+	m_pCurrentBlock = NULL;
+	m_uiBlockIndex = 0;
+	m_ulPacketCount = 0;
+	m_ulMIPIPacketCount = 0;
+	m_ulDroppedPacketCount = 0;
+	m_ulWrittenBytes = RECORD_FILE_HEADER_SIZE;
+	m_bStopWriting = false;
+	m_bWriteError = false;
+	m_bRecording = true;
+	m_threadWrite = thread(&DataRecorder::writeThread, this);
+	cout << "DataRecorder::startRecording: " << filePath << (m_bDirectIO ? " (O_DIRECT)" : "") << endl;
+	return true;
+}
+
+void DataRecorder::stopRecording()
+{
+	lock_guard<mutex> lock(m_mutexWrite);
+	if (!m_bRecording)
+		return;
+	submitCurrentBlock();
+	{
+		lock_guard<mutex> lockBlock(m_mutexBlock);
+		m_bStopWriting = true;
+	}
+	m_conditionBlock.notify_all();
+	if (m_threadWrite.joinable())
+		m_threadWrite.join();
+	closeFile();
+	writeIndexFile();
+	m_bRecording = false;
+	cout << "DataRecorder::stopRecording: " << m_ulPacketCount << " packets, "
+		<< m_ulDroppedPacketCount << " dropped" << endl;
+}
+
+bool DataRecorder::isRecording()
+{
+	return m_bRecording;
+}
+
+bool DataRecorder::writePacket(const RecordPacketHeader& header, const uint8_t* pData, bool bWaitForBlock)
+{
+	lock_guard<mutex> lock(m_mutexWrite);
+	if (!m_bRecording)
+		return false;
+	if (header.dataSize > RECORD_MAX_PACKET_SIZE || m_bWriteError)
+	{
+		m_ulDroppedPacketCount++;
+		return false;
+	}
+	if (RECORD_TYPE_MIPI_PACKET == header.type && isCheckpointDue(header.timeStamp))
+		writeCheckpoint(header, bWaitForBlock);
+	if (!reserveRecord(header.dataSize, bWaitForBlock))
+	{
+		m_ulDroppedPacketCount++;
+		return false;
+	}
+	if (RECORD_TYPE_MIPI_PACKET == header.type && (m_vecIndexEntry.empty() ||
+		header.timeStamp >= m_vecIndexEntry.back().timeStamp + uint64_t(m_uiIndexInterval) * 1000))
+	{
+		RecordIndexEntry entry;
+		entry.timeStamp = header.timeStamp;
+		entry.packetNumber = m_ulMIPIPacketCount;
+		entry.blockOffset = RECORD_FILE_HEADER_SIZE + uint64_t(m_uiBlockIndex) * RECORD_BLOCK_SIZE;
+		entry.recordOffset = m_uiCurrentDataSize;
+		entry.recordIndex = m_uiCurrentRecordCount;
+		entry.mode = header.mode;
+		entry.reserved = 0;
+		m_vecIndexEntry.push_back(entry);
+	}
+	appendRecord(header, pData);
+	if (RECORD_TYPE_MIPI_PACKET == header.type)
+		m_ulMIPIPacketCount++;
+	return true;
+}
+
+void DataRecorder::setCheckpointInterval(uint32_t interval)
+{
+	lock_guard<mutex> lock(m_mutexWrite);
+	m_uiCheckpointInterval = interval;
+}
+
+uint32_t DataRecorder::getCheckpointInterval()
+{
+	return m_uiCheckpointInterval;
+}
+
+void DataRecorder::setIndexInterval(uint32_t interval)
+{
+	lock_guard<mutex> lock(m_mutexWrite);
+	m_uiIndexInterval = interval;
+}
+
+uint32_t DataRecorder::getIndexInterval()
+{
+	return m_uiIndexInterval;
+}
+
+uint64_t DataRecorder::getPacketCount()
+{
+	return m_ulPacketCount;
+}
+
+uint64_t DataRecorder::getDroppedPacketCount()
+{
+	return m_ulDroppedPacketCount;
+}
+
+uint64_t DataRecorder::getWrittenBytes()
+{
+	lock_guard<mutex> lock(m_mutexBlock);
+	return m_ulWrittenBytes;
+}
+
+bool DataRecorder::openFile(const string& filePath, bool bDirectIO)
+{
+	m_bDirectIO = false;
+#ifdef _WIN32
+	m_iFile = _open(filePath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+#ifdef O_DIRECT
+	if (bDirectIO)
+	{
+		m_iFile = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+		if (m_iFile >= 0)
+			m_bDirectIO = true;
+		else
+			cout << "DataRecorder::openFile: O_DIRECT is not supported, use buffered I/O" << endl;
+	}
+#endif
+	if (m_iFile < 0)
+		m_iFile = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (m_iFile < 0)
+	{
+		cout << "DataRecorder::openFile: can't open " << filePath << endl;
+		return false;
+	}
+	return true;
+}
+
+void DataRecorder::closeFile()
+{
+	if (m_iFile >= 0)
+	{
+#ifdef _WIN32
+		_close(m_iFile);
+#else
+		close(m_iFile);
+#endif
+		m_iFile = -1;
+	}
+}
+
+bool DataRecorder::writeFile(const uint8_t* pData, uint32_t size)
+{
+	while (size > 0)
+	{
+#ifdef _WIN32
+		int written = _write(m_iFile, pData, size);
+#else
+		ssize_t written = write(m_iFile, pData, size);
+#endif
+		if (written <= 0)
+		{
+			cout << "DataRecorder::writeFile: write error!" << endl;
+			return false;
+		}
+		pData += written;
+		size -= written;
+	}
+	return true;
+}
+
+bool DataRecorder::syncFile()
+{
+#ifdef _WIN32
+	bool bOk = _commit(m_iFile) == 0;
+#else
+	bool bOk = fsync(m_iFile) == 0;
+#endif
+	if (!bOk)
+		cout << "DataRecorder::syncFile: sync error!" << endl;
+	return bOk;
+}
+
+// Blocks are always written whole, which keeps every write aligned for O_DIRECT
+void DataRecorder::writeThread()
+{
+	while (true)
+	{
+		uint8_t* pBlock = NULL;
+		{
+			unique_lock<mutex> lock(m_mutexBlock);
+			m_conditionBlock.wait(lock, [this] { return m_bStopWriting || !m_queueFullBlock.empty(); });
+			if (m_queueFullBlock.empty())
+				break;
+			pBlock = m_queueFullBlock.front();
+			m_queueFullBlock.pop_front();
+		}
+		//the checksum is computed here, off the acquisition thread
+		RecordBlockHeader* pBlockHeader = (RecordBlockHeader*)pBlock;
+		pBlockHeader->checksum = recordBlockChecksum(pBlockHeader);
+		bool bOk = !m_bWriteError && writeFile(pBlock, RECORD_BLOCK_SIZE);
+		if (bOk && (pBlockHeader->flags & RECORD_BLOCK_CHECKPOINT))
+			bOk = syncFile();
+		{
+			lock_guard<mutex> lock(m_mutexBlock);
+			if (bOk)
+				m_ulWrittenBytes += RECORD_BLOCK_SIZE;
+			else
+				m_bWriteError = true;
+			m_vecFreeBlock.push_back(pBlock);
+		}
+		m_conditionFreeBlock.notify_one();
+	}
+}
+
+void DataRecorder::submitCurrentBlock()
+{
+	if (NULL == m_pCurrentBlock)
+		return;
+	RecordBlockHeader* pBlockHeader = (RecordBlockHeader*)m_pCurrentBlock;
+	pBlockHeader->magic = RECORD_BLOCK_MAGIC;
+	pBlockHeader->blockIndex = m_uiBlockIndex++;
+	pBlockHeader->dataSize = m_uiCurrentDataSize;
+	pBlockHeader->recordCount = m_uiCurrentRecordCount;
+	pBlockHeader->checksum = 0;
+	pBlockHeader->flags = m_bCurrentBlockCheckpoint ? RECORD_BLOCK_CHECKPOINT : 0;
+	pBlockHeader->checkpointOffset = m_ulCheckpointOffset;
+	m_bCurrentBlockCheckpoint = false;
+	uint32_t usedSize = sizeof(RecordBlockHeader) + m_uiCurrentDataSize;
+	memset(m_pCurrentBlock + usedSize, 0, RECORD_BLOCK_SIZE - usedSize);
+	{
+		lock_guard<mutex> lock(m_mutexBlock);
+		m_queueFullBlock.push_back(m_pCurrentBlock);
+	}
+	m_conditionBlock.notify_one();
+	m_pCurrentBlock = NULL;
+}
+
+// Make room for a record of dataSize bytes in the current block
+bool DataRecorder::reserveRecord(uint32_t dataSize, bool bWaitForBlock)
+{
+	uint32_t recordSize = sizeof(RecordPacketHeader) + recordPaddedSize(dataSize);
+	if (m_pCurrentBlock && sizeof(RecordBlockHeader) + m_uiCurrentDataSize + recordSize > RECORD_BLOCK_SIZE)
+		submitCurrentBlock();
+	if (NULL == m_pCurrentBlock)
+	{
+		unique_lock<mutex> lockBlock(m_mutexBlock);
+		if (bWaitForBlock)
+			m_conditionFreeBlock.wait(lockBlock, [this] { return !m_vecFreeBlock.empty() || m_bWriteError; });
+		//the disk can't keep up, drop the record rather than stall acquisition
+		if (m_vecFreeBlock.empty())
+			return false;
+		m_pCurrentBlock = m_vecFreeBlock.back();
+		m_vecFreeBlock.pop_back();
+		m_uiCurrentDataSize = 0;
+		m_uiCurrentRecordCount = 0;
+	}
+	return true;
+}
+
+void DataRecorder::appendRecord(const RecordPacketHeader& header, const uint8_t* pData)
+{
+	uint8_t* pRecord = m_pCurrentBlock + sizeof(RecordBlockHeader) + m_uiCurrentDataSize;
+	memcpy(pRecord, &header, sizeof(RecordPacketHeader));
+	memcpy(pRecord + sizeof(RecordPacketHeader), pData, header.dataSize);
+	memset(pRecord + sizeof(RecordPacketHeader) + header.dataSize, 0, recordPaddedSize(header.dataSize) - header.dataSize);
+	m_uiCurrentDataSize += sizeof(RecordPacketHeader) + recordPaddedSize(header.dataSize);
+	m_uiCurrentRecordCount++;
+	m_ulPacketCount++;
+}
+
+bool DataRecorder::isCheckpointDue(uint64_t timeStamp)
+{
+	if (0 == m_uiCheckpointInterval)
+		return false;
+	if (!m_bCheckpointStarted)
+	{
+		m_ulCheckpointTimeStamp = timeStamp;
+		m_bCheckpointStarted = true;
+		return false;
+	}
+	return timeStamp >= m_ulCheckpointTimeStamp + uint64_t(m_uiCheckpointInterval) * 1000 ||
+		m_vecIndexEntry.size() - m_uiCheckpointEntry >= RECORD_CHECKPOINT_MAX_ENTRIES;
+}
+
+// Store the index entries added since the last checkpoint in front of the packet; if
+// there is no room for it, the entries stay pending until the next packet
+void DataRecorder::writeCheckpoint(const RecordPacketHeader& packetHeader, bool bWaitForBlock)
+{
+	uint32_t entryCount = m_vecIndexEntry.size() - m_uiCheckpointEntry;
+	RecordPacketHeader header = packetHeader; //sequence and state of the packet that follows
+	header.type = RECORD_TYPE_CHECKPOINT;
+	header.mode = 0;
+	header.dataSize = sizeof(RecordCheckpoint) + entryCount * sizeof(RecordIndexEntry);
+	if (!reserveRecord(header.dataSize, bWaitForBlock))
+		return;
+
+	RecordCheckpoint checkpoint;
+	memset(&checkpoint, 0, sizeof(checkpoint));
+	checkpoint.previousOffset = m_ulCheckpointOffset;
+	checkpoint.packetNumber = m_ulMIPIPacketCount;
+	checkpoint.entryCount = entryCount;
+	m_vecCheckpoint.resize(header.dataSize);
+	memcpy(m_vecCheckpoint.data(), &checkpoint, sizeof(checkpoint));
+	if (entryCount > 0)
+		memcpy(m_vecCheckpoint.data() + sizeof(checkpoint), &m_vecIndexEntry[m_uiCheckpointEntry], entryCount * sizeof(RecordIndexEntry));
+
+	m_ulCheckpointOffset = RECORD_FILE_HEADER_SIZE + uint64_t(m_uiBlockIndex) * RECORD_BLOCK_SIZE +
+		sizeof(RecordBlockHeader) + m_uiCurrentDataSize;
+	appendRecord(header, m_vecCheckpoint.data());
+	m_uiCheckpointEntry = m_vecIndexEntry.size();
+	m_ulCheckpointTimeStamp = packetHeader.timeStamp;
+	m_bCurrentBlockCheckpoint = true;
+}
+
+bool DataRecorder::writeIndexFile()
+{
+	string indexPath = m_strFilePath + RECORD_INDEX_SUFFIX;
+	ofstream file(indexPath.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "DataRecorder::writeIndexFile: can't open " << indexPath << endl;
+		return false;
+	}
+	RecordIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORD_INDEX_MAGIC, sizeof(RECORD_INDEX_MAGIC));
+	header.version = RECORD_INDEX_VERSION;
+	header.interval = m_uiIndexInterval;
+	header.entryCount = m_vecIndexEntry.size();
+	header.startTime = m_ulStartTime;
+	header.blockCount = m_uiBlockIndex;
+	file.write((const char*)&header, sizeof(header));
+	if (!m_vecIndexEntry.empty())
+		file.write((const char*)m_vecIndexEntry.data(), m_vecIndexEntry.size() * sizeof(RecordIndexEntry));
+	return file.good();
+}
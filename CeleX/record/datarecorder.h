@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef DATARECORDER_H
+#define DATARECORDER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "recordformat.h"
+
+using namespace std;
+
+// Append MIPI packets to a recording file.
+// Packets are copied into a pool of aligned blocks on the acquisition thread and the
+// full blocks are written by a dedicated thread, so the disk never stalls acquisition:
+// if the disk falls behind and the pool runs dry, packets are dropped and counted.
+// A sparse seek index is kept in memory and written next to the recording when it stops;
+// it is also checkpointed into the recording itself, see recordformat.h, so a recording
+// cut short by a crash keeps its index up to the last checkpoint.
+class DataRecorder
+{
+public:
+	DataRecorder(uint32_t blockNumber = 8);
+	~DataRecorder();
+
+	bool startRecording(const string& filePath, bool bDirectIO);
+	void stopRecording();
+	bool isRecording();
+
+	//bWaitForBlock: wait for the disk instead of dropping the packet when the pool is empty
+	bool writePacket(const RecordPacketHeader& header, const uint8_t* pData, bool bWaitForBlock = false);
+
+	void setIndexInterval(uint32_t interval); //unit: ms
+	uint32_t getIndexInterval();
+	void setCheckpointInterval(uint32_t interval); //unit: ms, 0: no checkpoints
+	uint32_t getCheckpointInterval();
+
+	uint64_t getPacketCount();
+	uint64_t getDroppedPacketCount();
+	uint64_t getWrittenBytes();
+
+private:
+	bool openFile(const string& filePath, bool bDirectIO);
+	void closeFile();
+	bool writeFile(const uint8_t* pData, uint32_t size);
+	bool syncFile();
+	void writeThread();
+	void submitCurrentBlock();
+	bool reserveRecord(uint32_t dataSize, bool bWaitForBlock);
+	void appendRecord(const RecordPacketHeader& header, const uint8_t* pData);
+	bool isCheckpointDue(uint64_t timeStamp);
+	void writeCheckpoint(const RecordPacketHeader& packetHeader, bool bWaitForBlock);
+	bool writeIndexFile();
+
+private:
+	int                            m_iFile;
+	string                         m_strFilePath;
+	uint64_t                       m_ulStartTime; //RecordFileHeader::startTime
+	bool                           m_bDirectIO;
+	bool                           m_bRecording;
+	bool                           m_bStopWriting;
+	atomic<bool>                   m_bWriteError;
+
+	thread                         m_threadWrite;
+	mutex                          m_mutexWrite; //serializes writePacket and stopRecording
+	mutex                          m_mutexBlock;
+	condition_variable             m_conditionBlock;
+	condition_variable             m_conditionFreeBlock;
+
+	uint32_t                       m_uiBlockNumber;
+	vector<uint8_t*>               m_vecBlock;
+	vector<uint8_t*>               m_vecFreeBlock;
+	deque<uint8_t*>                m_queueFullBlock;
+
+	uint8_t*                       m_pCurrentBlock;
+	uint32_t                       m_uiCurrentDataSize;
+	uint32_t                       m_uiCurrentRecordCount;
+	uint32_t                       m_uiBlockIndex;
+
+	uint64_t                       m_ulPacketCount; //records of any type
+	uint64_t                       m_ulMIPIPacketCount;
+	uint64_t                       m_ulDroppedPacketCount;
+	uint64_t                       m_ulWrittenBytes;
+
+	uint32_t                       m_uiIndexInterval;
+	vector<RecordIndexEntry>       m_vecIndexEntry;
+
+	uint32_t                       m_uiCheckpointInterval;
+	bool                           m_bCheckpointStarted;
+	uint64_t                       m_ulCheckpointTimeStamp;
+	uint64_t                       m_ulCheckpointOffset; //of the last checkpoint record
+	uint32_t                       m_uiCheckpointEntry; //first index entry not checkpointed yet
+	bool                           m_bCurrentBlockCheckpoint;
+	vector<uint8_t>                m_vecCheckpoint;
+};
+
+#endif // DATARECORDER_H
@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef EVENTFILEFORMAT_H
+#define EVENTFILEFORMAT_H
+
+#include <stdint.h>
+
+// Layout of a compressed event file (all fields little endian):
+//   EventFileHeader
+//   blocks, each an EventBlockHeader followed by storedSize bytes
+//   EventIndexEntry for every block, then EventFileFooter (written on close)
+// A block holds up to blockEventCount events and decodes on its own: the delta coding
+// restarts from the first event of the block. Raw block layout:
+//   EVENT_STREAM_NUMBER uint32_t stream sizes, then the streams
+//   group:      per run of events sharing t and row, zigzag varints of the t and row
+//               differences to the previous run and the varint event count of the run
+//   col:        zigzag varint of the difference to the previous event of the run,
+//               for the first event of a run to the first event of the previous run
+//   brightness: varint
+//   polarity:   one signed byte
+// Rows arrive as runs of events with one row time stamp, so t and row cost a few bytes
+// per run instead of per event, and keeping the fields in separate streams leaves the
+// LZ stage long runs of identical bytes (brightness and polarity are constant in
+// Event_Address_Only_Mode). A file without footer (interrupted writing) is read by
+// walking the block headers.
+
+#define EVENT_FILE_MAGIC        "CX5EVT"
+#define EVENT_FILE_VERSION      1
+#define EVENT_BLOCK_MAGIC       0x4B425645 //"EVBK"
+#define EVENT_FOOTER_MAGIC      0x58445645 //"EVDX"
+#define EVENT_STREAM_NUMBER     4
+
+#define EVENT_BLOCK_COMPRESSED  0x01 //LZCompressor, otherwise stored raw
+
+typedef struct EventFileHeader
+{
+	char        magic[8];
+	uint32_t    version;
+	uint32_t    blockEventCount;
+} EventFileHeader;
+
+typedef struct EventBlockHeader
+{
+	uint32_t    magic;
+	uint32_t    flags;
+	uint32_t    storedSize;
+	uint32_t    rawSize;
+	uint32_t    eventCount;
+	uint32_t    firstT;
+	uint32_t    lastT;
+	uint32_t    reserved;
+} EventBlockHeader;
+
+typedef struct EventIndexEntry
+{
+	uint64_t    offset; //of the EventBlockHeader
+	uint32_t    eventCount;
+	uint32_t    firstT;
+	uint32_t    lastT;
+	uint32_t    reserved;
+} EventIndexEntry;
+
+typedef struct EventFileFooter
+{
+	uint64_t    indexOffset;
+	uint32_t    blockCount;
+	uint32_t    magic;
+} EventFileFooter;
+
+#endif // EVENTFILEFORMAT_H
@@ -0,0 +1,181 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef RECORDFORMAT_H
+#define RECORDFORMAT_H
+
+#include <stdint.h>
+#include "../base/crc32c.h"
+
+// Layout of a MIPI recording (all fields little endian):
+//   RecordFileHeader, padded to RECORD_FILE_HEADER_SIZE
+//   block 0, block 1, ... each exactly RECORD_BLOCK_SIZE bytes:
+//     RecordBlockHeader
+//     records, each a RecordPacketHeader followed by dataSize bytes padded to 8 bytes
+//     zero padding up to RECORD_BLOCK_SIZE
+// A record never crosses a block boundary, so every block can be parsed on its own.
+// A block carries the CRC-32C of its header and records: a block torn by a crash is
+// recognised and playback ends at the last complete block. As the blocks are written
+// in order and have a fixed size, the last complete block is found from the file size.
+//
+// Checkpoints: about every checkpoint interval a RECORD_TYPE_CHECKPOINT record holding
+// the seek index entries added since the previous checkpoint goes into the stream and
+// its block is flushed to the disk (RECORD_BLOCK_CHECKPOINT). Every block header points
+// to the last checkpoint written so far, and every checkpoint to the one before it, so
+// the index of an interrupted recording is rebuilt by following the chain back from the
+// last complete block, and walking only the records after the last checkpoint.
+//
+// Seek index, written next to the recording as <recording>.idx when it is closed:
+//   RecordIndexHeader, then entryCount RecordIndexEntry sorted by time and packet number,
+//   one for the first MIPI packet and one for the first packet of every index interval
+// The index is removed when a recording is started and only used with the recording
+// whose start time and number of complete blocks it names.
+//
+// A sharded recording spreads the records over several recordings of the layout above,
+// one per target directory, listed by a text manifest:
+//   CX5SHARDS <version>
+//   policy <RECORD_SHARD_*> <segment duration, unit: ms>
+//   shard <path of the recording>, one line per shard
+// Every shard is a valid recording on its own; played together the records are merged
+// back in RecordPacketHeader::sequence order.
+
+#define RECORD_FILE_MAGIC       "CX5MIPI"
+#define RECORD_FILE_VERSION     2
+#define RECORD_FILE_HEADER_SIZE 4096
+#define RECORD_BLOCK_MAGIC      0x42355843 //"CX5B"
+#define RECORD_BLOCK_SIZE       (4 * 1024 * 1024)
+#define RECORD_ALIGNMENT        4096 //block buffers are aligned for O_DIRECT
+#define RECORD_BLOCK_CHECKPOINT 0x01 //the block holds a checkpoint and was synced to the disk
+
+#define RECORD_TYPE_MIPI_PACKET     0
+#define RECORD_TYPE_REGISTER_WRITE  1 //payload: RecordRegisterWrite
+#define RECORD_TYPE_CHECKPOINT      2 //payload: RecordCheckpoint, then entryCount RecordIndexEntry
+#define RECORD_CHECKPOINT_MAX_ENTRIES 1024
+
+#define RECORD_SHARD_MAGIC          "CX5SHARDS"
+#define RECORD_SHARD_VERSION        1
+#define RECORD_SHARD_ROUND_ROBIN    0 //MIPI packets dealt to the shards in turn
+#define RECORD_SHARD_TIME_SEGMENT   1 //consecutive time segments dealt to the shards in turn
+
+#define RECORD_INDEX_MAGIC      "CX5MIDX"
+#define RECORD_INDEX_VERSION    2
+#define RECORD_INDEX_SUFFIX     ".idx"
+
+typedef struct RecordFileHeader
+{
+	char        magic[8];
+	uint32_t    version;
+	uint32_t    blockSize;
+	uint64_t    startTime; //host time, unit: us
+} RecordFileHeader;
+
+typedef struct RecordBlockHeader
+{
+	uint32_t    magic;
+	uint32_t    blockIndex;
+	uint32_t    dataSize; //bytes of records following this header
+	uint32_t    recordCount;
+	uint32_t    checksum; //CRC-32C of this header, with checksum 0, and of the dataSize bytes
+	uint32_t    flags;
+	uint64_t    checkpointOffset; //file offset of the last checkpoint record so far, 0: none
+} RecordBlockHeader;
+
+// Sensor settings in effect when a packet arrived
+typedef struct RecordSensorState
+{
+	uint16_t    threshold;
+	uint16_t    brightness;
+	uint8_t     contrast;
+	uint8_t     clockRate; //unit: MHz
+	uint8_t     loopModeEnabled;
+	uint8_t     autoISPEnabled;
+	uint8_t     eventPacketFormat; //EVENT_PACKET_SELECT
+	uint8_t     reserved[3];
+} RecordSensorState;
+
+typedef struct RecordPacketHeader
+{
+	uint64_t            timeStamp; //host time, unit: us
+	uint64_t            sequence;
+	uint32_t            dataSize;
+	uint16_t            type;
+	uint16_t            mode;
+	RecordSensorState   state;
+	uint32_t            configVersion; //CeleX5::SensorConfig::version, 0 in older recordings
+} RecordPacketHeader;
+
+// A write through CeleX5::wireIn; RecordPacketHeader::sequence is the sequence of the
+// first MIPI packet received after the write
+typedef struct RecordRegisterWrite
+{
+	uint32_t    address;
+	uint32_t    value;
+	uint32_t    mask;
+	uint32_t    reserved;
+} RecordRegisterWrite;
+
+typedef struct RecordCheckpoint
+{
+	uint64_t    previousOffset; //file offset of the previous checkpoint record, 0: none
+	uint64_t    packetNumber; //MIPI packets recorded before the checkpoint
+	uint32_t    entryCount;
+	uint32_t    reserved;
+} RecordCheckpoint;
+
+typedef struct RecordIndexHeader
+{
+	char        magic[8];
+	uint32_t    version;
+	uint32_t    interval; //unit: ms
+	uint64_t    entryCount;
+	uint64_t    startTime; //RecordFileHeader::startTime of the recording
+	uint64_t    blockCount; //blocks of the recording
+} RecordIndexHeader;
+
+typedef struct RecordIndexEntry
+{
+	uint64_t    timeStamp; //RecordPacketHeader::timeStamp
+	uint64_t    packetNumber; //position of the MIPI packet in the recording, from 0
+	uint64_t    blockOffset; //file offset of the block holding the packet
+	uint32_t    recordOffset; //offset of the record behind the RecordBlockHeader
+	uint32_t    recordIndex; //index of the record in the block
+	uint32_t    mode;
+	uint32_t    reserved;
+} RecordIndexEntry;
+
+#define RECORD_MAX_PACKET_SIZE (RECORD_BLOCK_SIZE - sizeof(RecordBlockHeader) - sizeof(RecordPacketHeader))
+
+inline uint32_t recordPaddedSize(uint32_t size)
+{
+	return (size + 7) & ~7u;
+}
+
+inline uint32_t recordBlockChecksum(const RecordBlockHeader* pBlockHeader)
+{
+	RecordBlockHeader header = *pBlockHeader;
+	header.checksum = 0;
+	return crc32c(pBlockHeader + 1, header.dataSize, crc32c(&header, sizeof(header)));
+}
+
+//pBlockHeader points to RECORD_BLOCK_SIZE readable bytes
+inline bool isRecordBlockValid(const RecordBlockHeader* pBlockHeader)
+{
+	return pBlockHeader->magic == RECORD_BLOCK_MAGIC &&
+		pBlockHeader->dataSize <= RECORD_BLOCK_SIZE - sizeof(RecordBlockHeader) &&
+		pBlockHeader->checksum == recordBlockChecksum(pBlockHeader);
+}
+
+#endif // RECORDFORMAT_H
@@ -0,0 +1,244 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "ringrecorder.h"
+#include <iostream>
+#include <cstring>
+#include <chrono>
+
+static uint64_t getHostTime()
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+RingRecorder::RingRecorder()
+	: m_uiDuration(0)
+	, m_ulMaxBytes(0)
+	, m_bEnabled(false)
+	, m_ulAllocatedBytes(0)
+	, m_ulBufferedBytes(0)
+	, m_ulDroppedPacketCount(0)
+	, m_bFlushing(false)
+	, m_bPostTrigger(false)
+	, m_ulTriggerEndTime(0)
+{
+}
+
+RingRecorder::~RingRecorder()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_bPostTrigger = false;
+	}
+	m_condition.notify_all();
+	if (m_threadFlush.joinable())
+		m_threadFlush.join();
+	clear();
+}
+
+void RingRecorder::setCapacity(uint32_t duration, uint64_t maxBytes)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_uiDuration = duration;
+	m_ulMaxBytes = maxBytes;
+	m_bEnabled = duration > 0 && maxBytes > 0;
+	clear();
+}
+
+bool RingRecorder::isEnabled()
+{
+	return m_bEnabled;
+}
+
+void RingRecorder::writePacket(const RecordPacketHeader& header, const uint8_t* pData)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!isEnabled())
+		return;
+	while (!m_queueRing.empty() && m_queueRing.front()->header.timeStamp + uint64_t(m_uiDuration) * 1000 < header.timeStamp)
+	{
+		recyclePacket(m_queueRing.front());
+		m_queueRing.pop_front();
+	}
+	Packet* pPacket = allocPacket(header.dataSize);
+	if (NULL == pPacket)
+	{
+		m_ulDroppedPacketCount++;
+		return;
+	}
+	pPacket->header = header;
+	memcpy(pPacket->data.data(), pData, header.dataSize);
+	m_ulBufferedBytes += header.dataSize;
+
+	if (m_bPostTrigger)
+	{
+		if (header.timeStamp <= m_ulTriggerEndTime)
+		{
+			m_queueFlush.push_back(pPacket);
+			m_condition.notify_one();
+			return;
+		}
+		m_bPostTrigger = false;
+		m_condition.notify_one();
+	}
+	m_queueRing.push_back(pPacket);
+}
+
+bool RingRecorder::trigger(const string& filePath, uint32_t postTriggerTime, bool bDirectIO)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (!isEnabled() || m_bFlushing)
+		{
+			cout << "RingRecorder::trigger: " << (m_bFlushing ? "the last trigger is still being saved!" : "not enabled!") << endl;
+			return false;
+		}
+	}
+	if (m_threadFlush.joinable())
+		m_threadFlush.join();
+	if (!m_dataRecorder.startRecording(filePath, bDirectIO))
+		return false;
+
+	lock_guard<mutex> lock(m_mutex);
+	m_queueFlush.insert(m_queueFlush.end(), m_queueRing.begin(), m_queueRing.end());
+	m_queueRing.clear();
+	m_ulTriggerEndTime = getHostTime() + uint64_t(postTriggerTime) * 1000;
+	m_bPostTrigger = true;
+	m_bFlushing = true;
+	m_threadFlush = thread(&RingRecorder::flushThread, this);
+	return true;
+}
+
+bool RingRecorder::isFlushing()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_bFlushing;
+}
+
+uint64_t RingRecorder::getBufferedBytes()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_ulBufferedBytes;
+}
+
+uint64_t RingRecorder::getDroppedPacketCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_ulDroppedPacketCount;
+}
+
+// Reuse a free buffer, allocate while under the byte limit, otherwise take the oldest
+// packet of the ring; packets waiting to be flushed are never taken
+RingRecorder::Packet* RingRecorder::allocPacket(uint32_t dataSize)
+{
+	Packet* pPacket = NULL;
+	if (!m_vecFreePacket.empty())
+	{
+		pPacket = m_vecFreePacket.back();
+		m_vecFreePacket.pop_back();
+	}
+	else if (m_ulAllocatedBytes + dataSize <= m_ulMaxBytes)
+	{
+		pPacket = new Packet;
+	}
+	else if (!m_queueRing.empty())
+	{
+		pPacket = m_queueRing.front();
+		m_queueRing.pop_front();
+		m_ulBufferedBytes -= pPacket->header.dataSize;
+	}
+	if (NULL == pPacket)
+		return NULL;
+
+	uint64_t capacity = pPacket->data.capacity();
+	if (capacity < dataSize)
+	{
+		//release the oldest buffers until the larger one fits
+		while (m_ulAllocatedBytes - capacity + dataSize > m_ulMaxBytes && !m_vecFreePacket.empty())
+		{
+			m_ulAllocatedBytes -= m_vecFreePacket.back()->data.capacity();
+			delete m_vecFreePacket.back();
+			m_vecFreePacket.pop_back();
+		}
+		while (m_ulAllocatedBytes - capacity + dataSize > m_ulMaxBytes && !m_queueRing.empty())
+		{
+			m_ulBufferedBytes -= m_queueRing.front()->header.dataSize;
+			m_ulAllocatedBytes -= m_queueRing.front()->data.capacity();
+			delete m_queueRing.front();
+			m_queueRing.pop_front();
+		}
+		if (m_ulAllocatedBytes - capacity + dataSize > m_ulMaxBytes)
+		{
+			m_vecFreePacket.push_back(pPacket);
+			return NULL;
+		}
+		pPacket->data.reserve(dataSize);
+		m_ulAllocatedBytes += pPacket->data.capacity() - capacity;
+	}
+	pPacket->data.resize(dataSize);
+	return pPacket;
+}
+
+void RingRecorder::recyclePacket(Packet* pPacket)
+{
+	m_ulBufferedBytes -= pPacket->header.dataSize;
+	m_vecFreePacket.push_back(pPacket);
+}
+
+// Release the ring and the pool, the packets being flushed are left alone
+void RingRecorder::clear()
+{
+	for (auto itr = m_queueRing.begin(); itr != m_queueRing.end(); itr++)
+		recyclePacket(*itr);
+	m_queueRing.clear();
+	for (auto itr = m_vecFreePacket.begin(); itr != m_vecFreePacket.end(); itr++)
+	{
+		m_ulAllocatedBytes -= (*itr)->data.capacity();
+		delete *itr;
+	}
+	m_vecFreePacket.clear();
+}
+
+void RingRecorder::flushThread()
+{
+	while (true)
+	{
+		Packet* pPacket = NULL;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			while (m_queueFlush.empty() && m_bPostTrigger)
+			{
+				//the window also closes when the packets stop coming
+				if (getHostTime() > m_ulTriggerEndTime)
+					m_bPostTrigger = false;
+				else
+					m_condition.wait_for(lock, chrono::milliseconds(100));
+			}
+			if (m_queueFlush.empty())
+				break;
+			pPacket = m_queueFlush.front();
+			m_queueFlush.pop_front();
+		}
+		m_dataRecorder.writePacket(pPacket->header, pPacket->data.data(), true);
+		{
+			lock_guard<mutex> lock(m_mutex);
+			recyclePacket(pPacket);
+		}
+	}
+	m_dataRecorder.stopRecording();
+	lock_guard<mutex> lock(m_mutex);
+	m_bFlushing = false;
+}
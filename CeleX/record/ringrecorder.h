@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef RINGRECORDER_H
+#define RINGRECORDER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "recordformat.h"
+#include "datarecorder.h"
+
+using namespace std;
+
+// Keep the last seconds of MIPI packets in memory and save them on demand.
+// Packets live in pooled buffers whose total size never exceeds the byte limit; the
+// oldest packet is recycled when a packet is older than the duration or room is needed.
+// trigger hands the buffered packets to a background thread that writes them, followed
+// by the packets of the post-trigger window, through a DataRecorder.
+class RingRecorder
+{
+public:
+	RingRecorder();
+	~RingRecorder();
+
+	void setCapacity(uint32_t duration, uint64_t maxBytes); //duration unit: ms, 0: disabled
+	bool isEnabled();
+
+	void writePacket(const RecordPacketHeader& header, const uint8_t* pData);
+
+	bool trigger(const string& filePath, uint32_t postTriggerTime, bool bDirectIO); //unit: ms
+	bool isFlushing();
+
+	uint64_t getBufferedBytes();
+	uint64_t getDroppedPacketCount();
+
+private:
+	struct Packet
+	{
+		RecordPacketHeader   header;
+		vector<uint8_t>      data;
+	};
+	Packet* allocPacket(uint32_t dataSize);
+	void recyclePacket(Packet* pPacket);
+	void clear();
+	void flushThread();
+
+private:
+	mutex                          m_mutex;
+	condition_variable             m_condition;
+	deque<Packet*>                 m_queueRing; //history before the trigger
+	deque<Packet*>                 m_queueFlush; //waiting for the flush thread
+	vector<Packet*>                m_vecFreePacket;
+
+	uint32_t                       m_uiDuration;
+	uint64_t                       m_ulMaxBytes;
+	atomic<bool>                   m_bEnabled; //polled without the lock by the acquisition thread
+	uint64_t                       m_ulAllocatedBytes; //capacity of all packet buffers
+	uint64_t                       m_ulBufferedBytes; //data in the ring and the flush queue
+	uint64_t                       m_ulDroppedPacketCount;
+
+	bool                           m_bFlushing;
+	bool                           m_bPostTrigger;
+	uint64_t                       m_ulTriggerEndTime; //host time, unit: us
+	thread                         m_threadFlush;
+	DataRecorder                   m_dataRecorder;
+};
+
+#endif // RINGRECORDER_H
@@ -0,0 +1,269 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "shardedplayer.h"
+#include <iostream>
+#include <fstream>
+#include <thread>
+
+ShardedPlayer::ShardedPlayer()
+	: m_ulStartTimeStamp(0)
+	, m_ulPacketNumber(0)
+	, m_bRealTimeEnabled(false)
+	, m_bPacingStarted(false)
+	, m_ulPacingStartTimeStamp(0)
+{
+}
+
+ShardedPlayer::~ShardedPlayer()
+{
+	closeFile();
+}
+
+bool ShardedPlayer::openFile(const string& filePath)
+{
+	closeFile();
+	vector<string> vecFilePath;
+	if (!loadManifest(filePath, vecFilePath))
+		vecFilePath.push_back(filePath);
+
+	for (auto itr = vecFilePath.begin(); itr != vecFilePath.end(); itr++)
+	{
+		Shard shard;
+		shard.pPlayer = new DataPlayer;
+		shard.pHeader = NULL;
+		shard.pData = NULL;
+		m_vecShard.push_back(shard);
+		if (!shard.pPlayer->openFile(*itr))
+		{
+			closeFile();
+			return false;
+		}
+		uint64_t startTimeStamp = shard.pPlayer->getStartTimeStamp();
+		if (startTimeStamp > 0 && (0 == m_ulStartTimeStamp || startTimeStamp < m_ulStartTimeStamp))
+			m_ulStartTimeStamp = startTimeStamp;
+	}
+	rewind();
+	return true;
+}
+
+void ShardedPlayer::closeFile()
+{
+	for (auto itr = m_vecShard.begin(); itr != m_vecShard.end(); itr++)
+		delete itr->pPlayer;
+	m_vecShard.clear();
+	m_ulStartTimeStamp = 0;
+	m_ulPacketNumber = 0;
+}
+
+bool ShardedPlayer::isOpened()
+{
+	return !m_vecShard.empty();
+}
+
+void ShardedPlayer::setRealTimeEnabled(bool enable)
+{
+	m_bRealTimeEnabled = enable;
+	m_bPacingStarted = false;
+}
+
+bool ShardedPlayer::isRealTimeEnabled()
+{
+	return m_bRealTimeEnabled;
+}
+
+const RecordPacketHeader* ShardedPlayer::getNextRecord(const uint8_t** ppData)
+{
+	Shard* pShard = NULL;
+	const RecordPacketHeader* pHeader = peekRecord(&pShard);
+	if (NULL == pHeader)
+		return NULL;
+	*ppData = pShard->pData;
+	pShard->pHeader = NULL;
+	if (RECORD_TYPE_MIPI_PACKET == pHeader->type)
+		m_ulPacketNumber++;
+	if (m_bRealTimeEnabled)
+		waitForRecordTime(pHeader->timeStamp);
+	return pHeader;
+}
+
+bool ShardedPlayer::isEndOfFile()
+{
+	for (auto itr = m_vecShard.begin(); itr != m_vecShard.end(); itr++)
+	{
+		if (itr->pHeader || !itr->pPlayer->isEndOfFile())
+			return false;
+	}
+	return true;
+}
+
+void ShardedPlayer::rewind()
+{
+	m_bPacingStarted = false;
+	for (auto itr = m_vecShard.begin(); itr != m_vecShard.end(); itr++)
+	{
+		itr->pPlayer->rewind();
+		itr->pHeader = NULL;
+	}
+	m_ulPacketNumber = 0;
+}
+
+bool ShardedPlayer::seekToTime(uint64_t time)
+{
+	if (m_vecShard.empty())
+		return false;
+	if (1 == m_vecShard.size())
+	{
+		rewind();
+		bool bOk = m_vecShard[0].pPlayer->seekToTime(time);
+		m_ulPacketNumber = m_vecShard[0].pPlayer->getPacketNumber();
+		return bOk;
+	}
+	seekShards(m_ulStartTimeStamp + time);
+	Shard* pShard = NULL;
+	return NULL != peekRecord(&pShard);
+}
+
+// The shards count their own packets only: find the latest time before which at most
+// packetNumber packets were recorded, then walk the merged records up to the packet
+bool ShardedPlayer::seekToPacket(uint64_t packetNumber)
+{
+	if (m_vecShard.empty())
+		return false;
+	if (1 == m_vecShard.size())
+	{
+		rewind();
+		bool bOk = m_vecShard[0].pPlayer->seekToPacket(packetNumber);
+		m_ulPacketNumber = m_vecShard[0].pPlayer->getPacketNumber();
+		return bOk;
+	}
+	uint64_t low = m_ulStartTimeStamp;
+	uint64_t high = m_ulStartTimeStamp + (uint64_t(1) << 40); //about 12 days
+	while (high - low > 1)
+	{
+		uint64_t middle = low + (high - low) / 2;
+		seekShards(middle);
+		if (m_ulPacketNumber <= packetNumber)
+			low = middle;
+		else
+			high = middle;
+	}
+	seekShards(low);
+
+	Shard* pShard = NULL;
+	const RecordPacketHeader* pHeader = NULL;
+	while ((pHeader = peekRecord(&pShard)) != NULL)
+	{
+		if (RECORD_TYPE_MIPI_PACKET == pHeader->type && m_ulPacketNumber == packetNumber)
+			return true;
+		pShard->pHeader = NULL;
+		if (RECORD_TYPE_MIPI_PACKET == pHeader->type)
+			m_ulPacketNumber++;
+	}
+	return false;
+}
+
+uint64_t ShardedPlayer::getPacketNumber()
+{
+	return m_ulPacketNumber;
+}
+
+uint32_t ShardedPlayer::getShardCount()
+{
+	return m_vecShard.size();
+}
+
+bool ShardedPlayer::loadManifest(const string& filePath, vector<string>& vecFilePath)
+{
+	ifstream file(filePath.c_str(), ios::in);
+	string magic;
+	uint32_t version = 0;
+	if (!file.is_open() || !(file >> magic >> version) || magic != RECORD_SHARD_MAGIC)
+		return false;
+	if (version != RECORD_SHARD_VERSION)
+	{
+		cout << "ShardedPlayer::loadManifest: unsupported manifest version " << version << endl;
+		return false;
+	}
+	string key;
+	while (file >> key)
+	{
+		string value;
+		getline(file, value);
+		if ("shard" == key && value.size() > 1)
+			vecFilePath.push_back(value.substr(1));
+	}
+	cout << "ShardedPlayer::loadManifest: " << vecFilePath.size() << " shards" << endl;
+	return !vecFilePath.empty();
+}
+
+// The record of the smallest sequence; a register write carries the sequence of the
+// packet following it, so it goes first, and the host time decides between shards
+const RecordPacketHeader* ShardedPlayer::peekRecord(Shard** ppShard)
+{
+	*ppShard = NULL;
+	for (auto itr = m_vecShard.begin(); itr != m_vecShard.end(); itr++)
+	{
+		if (NULL == itr->pHeader)
+			itr->pHeader = itr->pPlayer->getNextRecord(&itr->pData);
+		if (NULL == itr->pHeader)
+			continue;
+		if (NULL == *ppShard)
+		{
+			*ppShard = &(*itr);
+			continue;
+		}
+		const RecordPacketHeader* pHeader = itr->pHeader;
+		const RecordPacketHeader* pBest = (*ppShard)->pHeader;
+		bool bPacket = RECORD_TYPE_MIPI_PACKET == pHeader->type;
+		bool bBestPacket = RECORD_TYPE_MIPI_PACKET == pBest->type;
+		if (pHeader->sequence < pBest->sequence ||
+			(pHeader->sequence == pBest->sequence && (bPacket < bBestPacket ||
+			(bPacket == bBestPacket && pHeader->timeStamp < pBest->timeStamp))))
+			*ppShard = &(*itr);
+	}
+	return *ppShard ? (*ppShard)->pHeader : NULL;
+}
+
+// Position every shard at its first MIPI packet at or after the host time stamp
+void ShardedPlayer::seekShards(uint64_t timeStamp)
+{
+	m_bPacingStarted = false;
+	m_ulPacketNumber = 0;
+	for (auto itr = m_vecShard.begin(); itr != m_vecShard.end(); itr++)
+	{
+		itr->pHeader = NULL;
+		uint64_t startTimeStamp = itr->pPlayer->getStartTimeStamp();
+		if (0 == startTimeStamp)
+			itr->pPlayer->rewind(); //no MIPI packet in the shard
+		else
+			itr->pPlayer->seekToTime(timeStamp > startTimeStamp ? timeStamp - startTimeStamp : 0);
+		m_ulPacketNumber += itr->pPlayer->getPacketNumber();
+	}
+}
+
+void ShardedPlayer::waitForRecordTime(uint64_t timeStamp)
+{
+	//restart the pacing when the host clock stepped backwards during the recording
+	if (!m_bPacingStarted || timeStamp < m_ulPacingStartTimeStamp)
+	{
+		m_ulPacingStartTimeStamp = timeStamp;
+		m_tpPacingStart = chrono::steady_clock::now();
+		m_bPacingStarted = true;
+		return;
+	}
+	this_thread::sleep_until(m_tpPacingStart + chrono::microseconds(timeStamp - m_ulPacingStartTimeStamp));
+}
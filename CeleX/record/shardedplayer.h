@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SHARDEDPLAYER_H
+#define SHARDEDPLAYER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "recordformat.h"
+#include "dataplayer.h"
+
+using namespace std;
+
+// Play back a sharded recording from its manifest, or a single recording, through
+// the DataPlayer interface. Every shard is read by its own DataPlayer and the records
+// are merged by sequence, a register write ahead of the packet sharing its sequence.
+// Seeking positions every shard on its own index: by time directly, by packet number
+// with a search over time, as the shards know only their own packet numbers.
+class ShardedPlayer
+{
+public:
+	ShardedPlayer();
+	~ShardedPlayer();
+
+	bool openFile(const string& filePath); //a manifest or a recording
+	void closeFile();
+	bool isOpened();
+
+	void setRealTimeEnabled(bool enable);
+	bool isRealTimeEnabled();
+
+	//returns NULL at the end of the file, *ppData points to header->dataSize bytes
+	const RecordPacketHeader* getNextRecord(const uint8_t** ppData);
+	bool isEndOfFile();
+	void rewind();
+
+	//position at the first MIPI packet at or after the time, unit: us from the first packet
+	bool seekToTime(uint64_t time);
+	bool seekToPacket(uint64_t packetNumber);
+	uint64_t getPacketNumber(); //of the next MIPI packet
+
+	uint32_t getShardCount();
+
+private:
+	struct Shard
+	{
+		DataPlayer*                 pPlayer;
+		const RecordPacketHeader*   pHeader; //next record of the shard, NULL when not read yet
+		const uint8_t*              pData;
+	};
+	bool loadManifest(const string& filePath, vector<string>& vecFilePath);
+	const RecordPacketHeader* peekRecord(Shard** ppShard);
+	void seekShards(uint64_t timeStamp);
+	void waitForRecordTime(uint64_t timeStamp);
+
+private:
+	vector<Shard>                  m_vecShard;
+	uint64_t                       m_ulStartTimeStamp; //of the first MIPI packet of all shards
+	uint64_t                       m_ulPacketNumber;
+
+	bool                           m_bRealTimeEnabled;
+	bool                           m_bPacingStarted;
+	uint64_t                       m_ulPacingStartTimeStamp;
+	chrono::steady_clock::time_point m_tpPacingStart;
+};
+
+#endif // SHARDEDPLAYER_H
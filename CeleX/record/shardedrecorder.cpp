@@ -0,0 +1,192 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "shardedrecorder.h"
+#include <iostream>
+#include <fstream>
+
+ShardedRecorder::ShardedRecorder()
+	: m_uiShardCount(0)
+	, m_bRecording(false)
+	, m_uiPolicy(RECORD_SHARD_ROUND_ROBIN)
+	, m_uiSegmentDuration(1000)
+	, m_ulMIPIPacketCount(0)
+	, m_ulFirstTimeStamp(0)
+	, m_bFirstRecord(true)
+{
+}
+
+ShardedRecorder::~ShardedRecorder()
+{
+	stopRecording();
+	for (auto itr = m_vecRecorder.begin(); itr != m_vecRecorder.end(); itr++)
+		delete *itr;
+	m_vecRecorder.clear();
+}
+
+bool ShardedRecorder::startRecording(const string& filePath, bool bDirectIO)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_bRecording)
+	{
+		cout << "ShardedRecorder::startRecording: already recording!" << endl;
+		return false;
+	}
+	m_uiPolicy = RECORD_SHARD_ROUND_ROBIN;
+	return startShards(vector<string>(1, filePath), bDirectIO);
+}
+
+bool ShardedRecorder::startRecording(const string& manifestPath, const vector<string>& vecDirectory,
+	uint32_t policy, uint32_t segmentDuration, bool bDirectIO)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_bRecording)
+	{
+		cout << "ShardedRecorder::startRecording: already recording!" << endl;
+		return false;
+	}
+	if (vecDirectory.empty() || (RECORD_SHARD_ROUND_ROBIN != policy && RECORD_SHARD_TIME_SEGMENT != policy) ||
+		(RECORD_SHARD_TIME_SEGMENT == policy && 0 == segmentDuration))
+	{
+		cout << "ShardedRecorder::startRecording: invalid shard settings!" << endl;
+		return false;
+	}
+	string fileName = manifestPath.substr(manifestPath.find_last_of("/\\") + 1);
+	vector<string> vecFilePath;
+	for (size_t i = 0; i < vecDirectory.size(); i++)
+	{
+		string directory = vecDirectory[i];
+		if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+			directory += "/";
+		vecFilePath.push_back(directory + fileName + "." + to_string(i));
+	}
+	m_uiPolicy = policy;
+	m_uiSegmentDuration = segmentDuration;
+	if (!writeManifest(manifestPath, vecFilePath))
+		return false;
+	return startShards(vecFilePath, bDirectIO);
+}
+
+void ShardedRecorder::stopRecording()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!m_bRecording)
+		return;
+	//the shards flush in parallel, each on its own writer thread, and are joined in turn
+	for (uint32_t i = 0; i < m_uiShardCount; i++)
+		m_vecRecorder[i]->stopRecording();
+	m_bRecording = false;
+}
+
+bool ShardedRecorder::isRecording()
+{
+	return m_bRecording;
+}
+
+bool ShardedRecorder::writePacket(const RecordPacketHeader& header, const uint8_t* pData)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!m_bRecording)
+		return false;
+	DataRecorder* pRecorder = m_vecRecorder[selectShard(header)];
+	if (RECORD_TYPE_MIPI_PACKET == header.type)
+		m_ulMIPIPacketCount++;
+	return pRecorder->writePacket(header, pData);
+}
+
+uint32_t ShardedRecorder::getShardCount()
+{
+	return m_uiShardCount;
+}
+
+uint64_t ShardedRecorder::getPacketCount()
+{
+	uint64_t count = 0;
+	for (uint32_t i = 0; i < m_uiShardCount; i++)
+		count += m_vecRecorder[i]->getPacketCount();
+	return count;
+}
+
+uint64_t ShardedRecorder::getDroppedPacketCount()
+{
+	uint64_t count = 0;
+	for (uint32_t i = 0; i < m_uiShardCount; i++)
+		count += m_vecRecorder[i]->getDroppedPacketCount();
+	return count;
+}
+
+uint64_t ShardedRecorder::getWrittenBytes()
+{
+	uint64_t bytes = 0;
+	for (uint32_t i = 0; i < m_uiShardCount; i++)
+		bytes += m_vecRecorder[i]->getWrittenBytes();
+	return bytes;
+}
+
+bool ShardedRecorder::startShards(const vector<string>& vecFilePath, bool bDirectIO)
+{
+	while (m_vecRecorder.size() < vecFilePath.size())
+		m_vecRecorder.push_back(new DataRecorder);
+	for (size_t i = 0; i < vecFilePath.size(); i++)
+	{
+		if (!m_vecRecorder[i]->startRecording(vecFilePath[i], bDirectIO))
+		{
+			for (size_t j = 0; j < i; j++)
+				m_vecRecorder[j]->stopRecording();
+			return false;
+		}
+	}
+	m_uiShardCount = vecFilePath.size();
+	m_ulMIPIPacketCount = 0;
+	m_bFirstRecord = true;
+	m_bRecording = true;
+	return true;
+}
+
+bool ShardedRecorder::writeManifest(const string& manifestPath, const vector<string>& vecFilePath)
+{
+	ofstream file(manifestPath.c_str(), ios::out | ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "ShardedRecorder::writeManifest: can't open " << manifestPath << endl;
+		return false;
+	}
+	file << RECORD_SHARD_MAGIC << " " << RECORD_SHARD_VERSION << "\n";
+	file << "policy " << m_uiPolicy << " " << m_uiSegmentDuration << "\n";
+	for (auto itr = vecFilePath.begin(); itr != vecFilePath.end(); itr++)
+		file << "shard " << *itr << "\n";
+	file.close();
+	return !file.fail();
+}
+
+// A register write is dealt like the MIPI packet that follows it: round robin it goes
+// to the shard of the next packet, by time it almost always lands in the same segment
+uint32_t ShardedRecorder::selectShard(const RecordPacketHeader& header)
+{
+	if (1 == m_uiShardCount)
+		return 0;
+	if (RECORD_SHARD_ROUND_ROBIN == m_uiPolicy)
+		return m_ulMIPIPacketCount % m_uiShardCount;
+
+	if (m_bFirstRecord)
+	{
+		m_ulFirstTimeStamp = header.timeStamp;
+		m_bFirstRecord = false;
+	}
+	//host clock stepped backwards: stay in the first segment
+	uint64_t time = header.timeStamp > m_ulFirstTimeStamp ? header.timeStamp - m_ulFirstTimeStamp : 0;
+	return (time / (uint64_t(m_uiSegmentDuration) * 1000)) % m_uiShardCount;
+}
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SHARDEDRECORDER_H
+#define SHARDEDRECORDER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "recordformat.h"
+#include "datarecorder.h"
+
+using namespace std;
+
+// Stripe a recording over several target directories, typically one per disk.
+// Every directory gets a DataRecorder, with its own block pool and writer thread, so
+// the write bandwidth adds up over the disks. Records go to the shards round robin by
+// MIPI packet or by time segment; a register write goes to the shard of the packet
+// that follows it, so each shard keeps it in front of that packet. The manifest is
+// written when the recording starts, so an interrupted recording can still be played.
+// A recording to a single file is a sharded recording of one shard without manifest.
+class ShardedRecorder
+{
+public:
+	ShardedRecorder();
+	~ShardedRecorder();
+
+	bool startRecording(const string& filePath, bool bDirectIO);
+	//shards are named <manifest file name>.<shard number> in the directories
+	bool startRecording(const string& manifestPath, const vector<string>& vecDirectory,
+		uint32_t policy, uint32_t segmentDuration, bool bDirectIO); //segmentDuration unit: ms
+	void stopRecording();
+	bool isRecording();
+
+	bool writePacket(const RecordPacketHeader& header, const uint8_t* pData);
+
+	uint32_t getShardCount();
+	uint64_t getPacketCount();
+	uint64_t getDroppedPacketCount();
+	uint64_t getWrittenBytes();
+
+private:
+	bool startShards(const vector<string>& vecFilePath, bool bDirectIO);
+	bool writeManifest(const string& manifestPath, const vector<string>& vecFilePath);
+	uint32_t selectShard(const RecordPacketHeader& header);
+
+private:
+	mutex                          m_mutex; //serializes writePacket and start/stop
+	vector<DataRecorder*>          m_vecRecorder; //kept with their block pools between recordings
+	uint32_t                       m_uiShardCount; //used by the current recording
+	bool                           m_bRecording;
+
+	uint32_t                       m_uiPolicy;
+	uint32_t                       m_uiSegmentDuration;
+	uint64_t                       m_ulMIPIPacketCount;
+	uint64_t                       m_ulFirstTimeStamp; //of the first record, for the time segments
+	bool                           m_bFirstRecord;
+};
+
+#endif // SHARDEDRECORDER_H
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "fakeceledriver.h"
+#include "driver/CeleDriver.h"
+
+namespace FakeCeleDriver
+{
+	std::vector<std::pair<uint16_t, uint16_t>> vecI2CWrite;
+	std::map<uint16_t, uint16_t>               mapRegister;
+	std::vector<std::vector<uint8_t>>          vecFrame;
+	uint32_t                                   frameIndex = 0;
+	uint32_t                                   clearDataCount = 0;
+
+	void reset()
+	{
+		vecI2CWrite.clear();
+		mapRegister.clear();
+		vecFrame.clear();
+		frameIndex = 0;
+		clearDataCount = 0;
+	}
+}
+
+using namespace FakeCeleDriver;
+
+CeleDriver::CeleDriver(void)
+{
+}
+
+CeleDriver::~CeleDriver(void)
+{
+}
+
+bool CeleDriver::Open(void)
+{
+	return true;
+}
+
+bool CeleDriver::openUSB()
+{
+	return true;
+}
+
+bool CeleDriver::openStream()
+{
+	return true;
+}
+
+void CeleDriver::Close(void)
+{
+}
+
+void CeleDriver::closeUSB()
+{
+}
+
+void CeleDriver::closeStream()
+{
+}
+
+bool CeleDriver::getimage(vector<uint8_t> &image)
+{
+	if (vecFrame.empty())
+	{
+		image.clear();
+		return false;
+	}
+	image = vecFrame[frameIndex++ % vecFrame.size()];
+	return true;
+}
+
+void CeleDriver::clearData()
+{
+	frameIndex = 0;
+	clearDataCount++;
+}
+
+bool CeleDriver::i2c_set(uint16_t reg, uint16_t value)
+{
+	vecI2CWrite.push_back(std::make_pair(reg, value));
+	mapRegister[reg] = value;
+	return true;
+}
+
+bool CeleDriver::i2c_get(uint16_t reg, uint16_t &value)
+{
+	value = mapRegister[reg];
+	return true;
+}
+
+bool CeleDriver::mipi_set(uint16_t, uint16_t)
+{
+	return true;
+}
+
+bool CeleDriver::mipi_get(uint16_t, uint16_t &value)
+{
+	value = 0;
+	return true;
+}
@@ -0,0 +1,37 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef FAKECELEDRIVER_H
+#define FAKECELEDRIVER_H
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+// The test programs link this CeleDriver in place of the one of the CeleDriver library:
+// I2C writes are logged and kept as register values, getimage hands out the frames in turn
+namespace FakeCeleDriver
+{
+	extern std::vector<std::pair<uint16_t, uint16_t>> vecI2CWrite; //address, value
+	extern std::map<uint16_t, uint16_t>               mapRegister;
+	extern std::vector<std::vector<uint8_t>>          vecFrame;
+	extern uint32_t                                   frameIndex; //reset by clearData
+	extern uint32_t                                   clearDataCount;
+
+	void reset();
+}
+
+#endif // FAKECELEDRIVER_H
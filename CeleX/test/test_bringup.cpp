@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "testutil.h"
+#include "fakeceledriver.h"
+#include "include/celex5/celex5.h"
+#include "eventproc/celex5registers.h"
+#include <algorithm>
+
+using namespace FakeCeleDriver;
+
+// Positions of the writes of a register value in the log, from first
+static vector<size_t> findWrites(size_t begin, size_t end, uint32_t address, int value = -1)
+{
+	vector<size_t> vecPosition;
+	for (size_t i = begin; i < end; i++)
+	{
+		if (vecI2CWrite[i].first == address && (value < 0 || vecI2CWrite[i].second == value))
+			vecPosition.push_back(i);
+	}
+	return vecPosition;
+}
+
+static bool isWrittenBetween(size_t begin, size_t end, uint32_t address)
+{
+	return findWrites(0, begin, address).empty() && !findWrites(begin, end, address).empty() &&
+		findWrites(end + 1, vecI2CWrite.size(), address).empty();
+}
+
+// The bring-up writes the CSR defaults of CeleX5_Commands.xml (copied next to the test
+// program) in phases: PLL and MIPI parameters while they are powered down, the sensor core
+// parameters of every auto ISP profile in CFG mode, then it starts the sensor
+static void testBringUp(CeleX5& sensor)
+{
+	reset();
+	sensor.setRegisterCacheEnabled(false);
+	CHECK(sensor.openSensor());
+
+	vector<CeleX5::BringUpPhase> vecPhase;
+	sensor.getBringUpTimes(vecPhase);
+	const char* phaseNames[] = { "Open_Stream", "PLL_Parameters", "MIPI_Parameters",
+		"Sensor_Core_Parameters", "Auto_ISP_Parameters", "Sensor_Mode_Parameters" };
+	CHECK(vecPhase.size() == 6);
+	uint32_t writeCount = 0;
+	for (size_t i = 0; i < vecPhase.size() && i < 6; i++)
+	{
+		CHECK(vecPhase[i].name == phaseNames[i]);
+		writeCount += vecPhase[i].writeCount;
+	}
+	CHECK(vecPhase[0].writeCount == 0);
+	//the phases are preceded by disabling ALS
+	CHECK(!vecI2CWrite.empty() && vecI2CWrite[0].first == CSR::ALS_CONTROL.highAddr && vecI2CWrite[0].second == 2);
+	CHECK(writeCount + 1 == vecI2CWrite.size());
+	CHECK(sensor.getRegisterWriteCount() + 1 == vecI2CWrite.size()); //ALS is set by the driver directly
+
+	//the XML may power them down too: from the first power down to the last power up
+	vector<size_t> vecPLLOff = findWrites(0, vecI2CWrite.size(), CSR::PLL_PD_B.highAddr, 0);
+	vector<size_t> vecPLLOn = findWrites(0, vecI2CWrite.size(), CSR::PLL_PD_B.highAddr, 1);
+	CHECK(!vecPLLOff.empty() && vecPLLOn.size() == 1);
+	if (!vecPLLOff.empty() && vecPLLOn.size() == 1)
+	{
+		CHECK(vecPLLOff.back() < vecPLLOn[0]);
+		CHECK(isWrittenBetween(vecPLLOff[0], vecPLLOn[0], CSR::PLL_DIV_N.highAddr));
+		CHECK(isWrittenBetween(vecPLLOff[0], vecPLLOn[0], CSR::PLL_FOUT_DIV1.highAddr));
+		CHECK(isWrittenBetween(vecPLLOff[0], vecPLLOn[0], CSR::PLL_FOUT_DIV2.highAddr));
+	}
+
+	for (int i = 0; i < 6 && vecPLLOn.size() == 1; i++)
+	{
+		vector<size_t> vecMIPIOff = findWrites(0, vecI2CWrite.size(), CSR::MIPI_POWER[i].highAddr, 0);
+		vector<size_t> vecMIPIOn = findWrites(0, vecI2CWrite.size(), CSR::MIPI_POWER[i].highAddr, 1);
+		CHECK(!vecMIPIOff.empty() && vecMIPIOn.size() == 1);
+		if (vecMIPIOff.empty() || vecMIPIOn.size() != 1)
+			continue;
+		CHECK(vecPLLOn[0] < vecMIPIOff[0] && vecMIPIOff.back() < vecMIPIOn[0]);
+		CHECK(isWrittenBetween(vecMIPIOff[0], vecMIPIOn[0], CSR::MIPI_PLL_DIV_N.highAddr));
+	}
+	CHECK(CSR::MIPI_PLL_DIV_N.highValue(120) == mapRegister[CSR::MIPI_PLL_DIV_N.highAddr]);
+
+	//one set of core parameters per profile, in CFG mode
+	vector<size_t> vecCFG = findWrites(0, vecI2CWrite.size(), CSR::SOFT_RESET.highAddr, 1);
+	vector<size_t> vecStart = findWrites(0, vecI2CWrite.size(), CSR::SOFT_RESET.highAddr, 0);
+	CHECK(vecCFG.size() == 1 && vecStart.size() == 1);
+	vector<size_t> vecProfile = findWrites(0, vecI2CWrite.size(), CSR::AUTOISP_PROFILE_ADDR.highAddr);
+	CHECK(vecProfile.size() == 4);
+	for (size_t i = 0; i < vecProfile.size() && vecCFG.size() == 1 && vecStart.size() == 1; i++)
+	{
+		CHECK(vecI2CWrite[vecProfile[i]].second == i);
+		CHECK(vecCFG[0] < vecProfile[i] && vecProfile[i] < vecStart[0]);
+	}
+	CHECK(findWrites(0, vecI2CWrite.size(), CSR::BIAS_BRT_I.highAddr).size() == 4);
+
+	//started last, with the data transfer parameters of the XML
+	size_t count = vecI2CWrite.size();
+	CHECK(count >= 2 && vecI2CWrite[count - 2].first == CSR::SOFT_RESET.highAddr && vecI2CWrite[count - 2].second == 0);
+	CHECK(count >= 2 && vecI2CWrite[count - 1].first == CSR::SOFT_TRIGGER.highAddr && vecI2CWrite[count - 1].second == 1);
+	CHECK(mapRegister[CSR::EVENT_PACKET_SELECT.highAddr] == 2);
+}
+
+// Packets are numbered as they are read; a mode switch drops what the driver buffered
+// and records the sequence of the first packet read after it
+static void testModeSwitch(CeleX5& sensor)
+{
+	vecFrame.assign(1, vector<uint8_t>(700, 0));
+	CeleX5::MIPIPacket packet;
+	for (uint64_t i = 0; i < 3; i++)
+		CHECK(sensor.getMIPIData(packet) && packet.sequence == i && packet.size == 700);
+
+	sensor.setRegisterCacheEnabled(true);
+	CeleX5::CeleX5Mode fromMode = sensor.getSensorFixedMode();
+	CeleX5::CeleX5Mode toMode = CeleX5::Full_Picture_Mode == fromMode ? CeleX5::Event_Address_Only_Mode : CeleX5::Full_Picture_Mode;
+	size_t writeCount = vecI2CWrite.size();
+	uint32_t clearDataCount = FakeCeleDriver::clearDataCount;
+	CHECK(sensor.setSensorFixedMode(toMode));
+	CHECK(sensor.getSensorFixedMode() == toMode);
+	CHECK(FakeCeleDriver::clearDataCount == clearDataCount + 1);
+	CHECK(mapRegister[CSR::SENSOR_MODE[0].highAddr] == toMode);
+
+	CeleX5::ModeSwitch modeSwitch;
+	sensor.getLastModeSwitch(modeSwitch);
+	CHECK(modeSwitch.fromMode == fromMode && modeSwitch.toMode == toMode);
+	CHECK(modeSwitch.sequence == 3);
+	//the writes entering and leaving CFG mode aren't counted
+	CHECK(modeSwitch.writeCount > 0 && modeSwitch.writeCount + 4 == vecI2CWrite.size() - writeCount);
+	CHECK(sensor.getMIPIData(packet) && packet.sequence == 3);
+
+	//switching again to the mode the sensor is in writes nothing
+	writeCount = vecI2CWrite.size();
+	CHECK(sensor.setSensorFixedMode(toMode));
+	CHECK(vecI2CWrite.size() == writeCount);
+}
+
+int main()
+{
+	CeleX5 sensor;
+	testBringUp(sensor);
+	testModeSwitch(sensor);
+	return testResult("test_bringup");
+}
@@ -0,0 +1,144 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "testutil.h"
+#include "base/crc32c.h"
+#include "base/lzcompressor.h"
+#include <vector>
+#include <random>
+#include <cstring>
+
+// One bit at a time, the definition the table and instruction paths have to agree with
+static uint32_t crc32cBitwise(const uint8_t* pData, size_t size)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= pData[i];
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+static void testCRC32C()
+{
+	//check value of the CRC catalogue and the vectors of RFC 3720, B.4
+	CHECK(crc32c("123456789", 9) == 0xE3069283);
+	CHECK(crc32c("", 0) == 0);
+	uint8_t buffer[32];
+	memset(buffer, 0, sizeof(buffer));
+	CHECK(crc32c(buffer, sizeof(buffer)) == 0x8A9136AA);
+	memset(buffer, 0xFF, sizeof(buffer));
+	CHECK(crc32c(buffer, sizeof(buffer)) == 0x62A8AB43);
+	for (int i = 0; i < 32; i++)
+		buffer[i] = i;
+	CHECK(crc32c(buffer, sizeof(buffer)) == 0x46DD794E);
+	for (int i = 0; i < 32; i++)
+		buffer[i] = 31 - i;
+	CHECK(crc32c(buffer, sizeof(buffer)) == 0x113FDB5C);
+
+	//chained calls give the CRC of the concatenation
+	CHECK(crc32c("6789", 4, crc32c("12345", 5)) == 0xE3069283);
+
+	//every length and alignment around the 8 byte steps
+	std::mt19937 rng(1);
+	std::vector<uint8_t> vecData(4096 + 8);
+	for (size_t i = 0; i < vecData.size(); i++)
+		vecData[i] = uint8_t(rng());
+	int mismatches = 0;
+	for (size_t offset = 0; offset < 8; offset++)
+	{
+		for (size_t size = 0; size <= 200; size++)
+		{
+			if (crc32c(vecData.data() + offset, size) != crc32cBitwise(vecData.data() + offset, size))
+				mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(crc32c(vecData.data() + 3, 4096) == crc32cBitwise(vecData.data() + 3, 4096));
+}
+
+static bool roundTrip(LZCompressor& compressor, const std::vector<uint8_t>& vecSource, uint32_t* pCompressedSize = NULL)
+{
+	uint32_t srcSize = vecSource.size();
+	std::vector<uint8_t> vecCompressed(LZCompressor::compressBound(srcSize));
+	uint32_t compressedSize = compressor.compress(vecSource.data(), srcSize, vecCompressed.data());
+	if (pCompressedSize)
+		*pCompressedSize = compressedSize;
+	if (compressedSize > LZCompressor::compressBound(srcSize))
+		return false;
+	std::vector<uint8_t> vecDecompressed(srcSize + 1);
+	if (!LZCompressor::decompress(vecCompressed.data(), compressedSize, vecDecompressed.data(), srcSize))
+		return false;
+	return 0 == memcmp(vecDecompressed.data(), vecSource.data(), srcSize);
+}
+
+static void testLZCompressor()
+{
+	LZCompressor compressor;
+	std::mt19937 rng(2);
+
+	CHECK(roundTrip(compressor, std::vector<uint8_t>()));
+	CHECK(roundTrip(compressor, std::vector<uint8_t>(1, 7)));
+	CHECK(roundTrip(compressor, std::vector<uint8_t>(LZ_MIN_MATCH + 1, 7)));
+
+	//a run is stored as one long match: the length continues over many 255 bytes
+	uint32_t compressedSize = 0;
+	std::vector<uint8_t> vecRun(1 << 20, 0x55);
+	CHECK(roundTrip(compressor, vecRun, &compressedSize));
+	CHECK(compressedSize < vecRun.size() / 100);
+
+	//random data doesn't compress, but stays within the bound
+	std::vector<uint8_t> vecRandom(100000);
+	for (size_t i = 0; i < vecRandom.size(); i++)
+		vecRandom[i] = uint8_t(rng());
+	CHECK(roundTrip(compressor, vecRandom));
+
+	//long literal runs between matches at offsets up to LZ_MAX_OFFSET
+	std::vector<uint8_t> vecMixed;
+	for (int k = 0; k < 64; k++)
+	{
+		size_t literals = rng() % 600;
+		for (size_t i = 0; i < literals; i++)
+			vecMixed.push_back(uint8_t(rng()));
+		size_t distance = 1 + rng() % (vecMixed.size() < LZ_MAX_OFFSET ? vecMixed.size() : LZ_MAX_OFFSET);
+		size_t length = rng() % 300;
+		for (size_t i = 0; i < length; i++)
+			vecMixed.push_back(vecMixed[vecMixed.size() - distance]);
+	}
+	CHECK(roundTrip(compressor, vecMixed, &compressedSize));
+	CHECK(compressedSize < vecMixed.size());
+
+	//the compressor is reused: nothing of the last block may leak into the next one
+	CHECK(roundTrip(compressor, vecRandom));
+	CHECK(roundTrip(compressor, vecMixed));
+
+	//decoding fails on a size mismatch and on truncated input
+	std::vector<uint8_t> vecCompressed(LZCompressor::compressBound(vecMixed.size()));
+	compressedSize = compressor.compress(vecMixed.data(), vecMixed.size(), vecCompressed.data());
+	std::vector<uint8_t> vecDecompressed(vecMixed.size() + 1);
+	CHECK(!LZCompressor::decompress(vecCompressed.data(), compressedSize, vecDecompressed.data(), vecMixed.size() - 1));
+	CHECK(!LZCompressor::decompress(vecCompressed.data(), compressedSize, vecDecompressed.data(), vecMixed.size() + 1));
+	CHECK(!LZCompressor::decompress(vecCompressed.data(), compressedSize / 2, vecDecompressed.data(), vecMixed.size()));
+}
+
+int main()
+{
+	testCRC32C();
+	testLZCompressor();
+	return testResult("test_codecs");
+}
@@ -0,0 +1,195 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "testutil.h"
+#include "include/celex5/celex5dataprocessor.h"
+#include <vector>
+#include <cstdio>
+
+#define HOT_PIXEL_MASK_PATH "test_dataprocessor.hot"
+
+// Builds the MIPI data of event packet format 2: 14 bit packets, four of them in 7 bytes
+// (the high 8 bits of each, then their low 6 bits), ended by the mode byte
+class MIPIFrame
+{
+public:
+	void addRow(uint32_t row) { add((row << 2) | 2); }
+	void addTime(uint32_t t) { add((t << 2) | 3); }
+	void addColumn(uint32_t col) { add((col << 2) | 1); }
+
+	const vector<uint8_t>& data()
+	{
+		while (0 != m_vecPacket.size() % 4)
+			addColumn(0xFFF); //out of the sensor, ignored by the decoder
+		m_vecData.clear();
+		for (size_t i = 0; i < m_vecPacket.size(); i += 4)
+		{
+			uint32_t low = 0;
+			for (size_t k = 0; k < 4; k++)
+			{
+				m_vecData.push_back(uint8_t(m_vecPacket[i + k] >> 6));
+				low |= (m_vecPacket[i + k] & 0x3F) << (6 * k);
+			}
+			m_vecData.push_back(uint8_t(low));
+			m_vecData.push_back(uint8_t(low >> 8));
+			m_vecData.push_back(uint8_t(low >> 16));
+		}
+		m_vecData.push_back(0); //mode
+		return m_vecData;
+	}
+
+private:
+	void add(uint32_t packet) { m_vecPacket.push_back(packet); }
+
+	vector<uint32_t> m_vecPacket;
+	vector<uint8_t>  m_vecData;
+};
+
+static void decode(CeleX5DataProcessor& processor, MIPIFrame& frame, vector<EventData>& vecEvent)
+{
+	const vector<uint8_t>& vecData = frame.data();
+	CHECK(processor.processMIPIData(vecData.data(), vecData.size()));
+	processor.getEventDataVector(vecEvent);
+}
+
+static void testDecoding()
+{
+	CeleX5DataProcessor processor;
+	MIPIFrame frame;
+	frame.addRow(10);
+	frame.addTime(100);
+	frame.addColumn(5);
+	frame.addColumn(600);
+	frame.addRow(500);
+	frame.addTime(200);
+	frame.addColumn(7);
+	frame.addColumn(1279);
+	vector<EventData> vecEvent;
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 4);
+	if (vecEvent.size() == 4)
+	{
+		CHECK(vecEvent[0].row == 10 && vecEvent[0].col == 5);
+		CHECK(vecEvent[1].row == 10 && vecEvent[1].col == 600 && vecEvent[1].t == vecEvent[0].t);
+		CHECK(vecEvent[2].row == 500 && vecEvent[2].col == 7 && vecEvent[2].t == vecEvent[0].t + 100);
+		CHECK(vecEvent[3].row == 500 && vecEvent[3].col == 1279);
+	}
+}
+
+static void testROI()
+{
+	CeleX5DataProcessor processor;
+	MIPIFrame frame;
+	frame.addRow(10);
+	frame.addTime(100);
+	frame.addColumn(5);
+	frame.addColumn(600);
+	frame.addRow(500);
+	frame.addTime(200);
+	for (uint32_t col = 7; col <= 12; col++)
+		frame.addColumn(col);
+	vector<EventData> vecEvent;
+
+	CHECK(!processor.isROIEnabled());
+	processor.addROI(0, 0, 100, 100);
+	CHECK(processor.isROIEnabled());
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 1 && vecEvent[0].col == 5);
+
+	//the rectangles are united
+	processor.addROI(0, 400, 20, 200);
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 7);
+
+	processor.clearROI();
+	processor.addROI(0, 400, 20, 200);
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 6 && vecEvent[0].row == 500);
+
+	//a pixel mask, one bit per pixel, row after row
+	vector<uint8_t> vecMask(CELEX5_PIXELS_NUMBER / 8, 0xFF);
+	uint32_t pixel = 500 * 1280 + 7;
+	vecMask[pixel >> 3] &= ~(1 << (pixel & 7));
+	processor.setROIMask(vecMask.data());
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 5 && vecEvent[0].col == 8);
+
+	//the mask stays until it is removed
+	processor.clearROI();
+	CHECK(processor.isROIEnabled());
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 7);
+	processor.setROIMask(NULL);
+	CHECK(!processor.isROIEnabled());
+	decode(processor, frame, vecEvent);
+	CHECK(vecEvent.size() == 8);
+}
+
+static void testHotPixelFilter()
+{
+	//pixel (3, 7) fires 5 times per frame, every 30 row time units, the others once
+	CeleX5DataProcessor processor;
+	processor.setHotPixelThreshold(20, 200);
+	processor.setHotPixelDetectionEnabled(true);
+	CHECK(processor.isHotPixelDetectionEnabled());
+	vector<EventData> vecEvent;
+	for (int k = 0; k < 40; k++)
+	{
+		MIPIFrame frame;
+		frame.addRow(3);
+		frame.addTime((k * 30) % 4096);
+		for (int i = 0; i < 5; i++)
+			frame.addColumn(7);
+		frame.addColumn(100 + k);
+		decode(processor, frame, vecEvent);
+	}
+	CHECK(processor.getHotPixelCount() == 1);
+	CHECK(vecEvent.size() == 1 && vecEvent[0].col == 139);
+	CHECK(processor.saveHotPixelMask(HOT_PIXEL_MASK_PATH));
+
+	//a loaded mask filters right away, without detection
+	MIPIFrame frame;
+	frame.addRow(3);
+	frame.addTime(5);
+	frame.addColumn(7);
+	frame.addColumn(8);
+	CeleX5DataProcessor processor2;
+	CHECK(processor2.loadHotPixelMask(HOT_PIXEL_MASK_PATH));
+	decode(processor2, frame, vecEvent);
+	CHECK(processor2.getHotPixelCount() == 1);
+	CHECK(vecEvent.size() == 1 && vecEvent[0].col == 8);
+
+	//hot pixels are dropped in the ROI too
+	processor2.addROI(0, 0, 10, 10);
+	decode(processor2, frame, vecEvent);
+	CHECK(vecEvent.size() == 1 && vecEvent[0].col == 8);
+
+	processor2.clearHotPixelMask();
+	decode(processor2, frame, vecEvent);
+	CHECK(processor2.getHotPixelCount() == 0);
+	CHECK(vecEvent.size() == 2);
+	CHECK(!processor2.loadHotPixelMask("test_dataprocessor.none"));
+
+	remove(HOT_PIXEL_MASK_PATH);
+}
+
+int main()
+{
+	testDecoding();
+	testROI();
+	testHotPixelFilter();
+	return testResult("test_dataprocessor");
+}
@@ -0,0 +1,202 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "testutil.h"
+#include "include/celex5/celex5eventfile.h"
+#include "include/celex5/celex5columnfile.h"
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+
+#define EVENT_FILE_PATH  "test_eventfiles.evt"
+#define COLUMN_FILE_PATH "test_eventfiles.col"
+
+static bool isSameEvent(const EventData& a, const EventData& b)
+{
+	return a.col == b.col && a.row == b.row && a.brightness == b.brightness &&
+		a.polarity == b.polarity && a.t == b.t;
+}
+
+// Rows of events as the decoder delivers them, with the corner cases of the delta coding:
+// full range coordinates, t and row stepping backwards, all three polarities
+static void makeEvents(vector<EventData>& vecEvent, size_t eventCount)
+{
+	std::mt19937 rng(3);
+	uint32_t t = 100;
+	while (vecEvent.size() < eventCount)
+	{
+		uint32_t step = rng() % 16;
+		if (0 == step)
+			t -= std::min<uint32_t>(t, rng() % 50); //row time of an earlier frame
+		else
+			t += step;
+		uint16_t row = (0 == rng() % 8) ? (rng() % 2 ? 0 : 799) : rng() % 800;
+		uint32_t count = 1 + rng() % 24;
+		for (uint32_t i = 0; i < count && vecEvent.size() < eventCount; i++)
+		{
+			EventData event;
+			event.row = row;
+			event.col = (0 == rng() % 16) ? (rng() % 2 ? 0 : 1279) : rng() % 1280;
+			event.brightness = rng() % 4096;
+			event.polarity = uint16_t(int(rng() % 3) - 1);
+			event.t = t;
+			vecEvent.push_back(event);
+		}
+	}
+}
+
+static bool readEventFile(CeleX5EventFileReader& reader, vector<EventData>& vecEvent)
+{
+	vecEvent.clear();
+	vector<EventData> vecBlock;
+	for (uint32_t i = 0; i < reader.getBlockCount(); i++)
+	{
+		if (!reader.readBlock(i, vecBlock))
+			return false;
+		vecEvent.insert(vecEvent.end(), vecBlock.begin(), vecBlock.end());
+	}
+	return true;
+}
+
+static bool isPrefix(const vector<EventData>& vecPrefix, const vector<EventData>& vecEvent)
+{
+	if (vecPrefix.size() > vecEvent.size())
+		return false;
+	for (size_t i = 0; i < vecPrefix.size(); i++)
+	{
+		if (!isSameEvent(vecPrefix[i], vecEvent[i]))
+			return false;
+	}
+	return true;
+}
+
+static void testEventFile()
+{
+	vector<EventData> vecEvent;
+	makeEvents(vecEvent, 100000);
+
+	CeleX5EventFileWriter writer(4096);
+	CHECK(writer.openFile(EVENT_FILE_PATH));
+	std::mt19937 rng(4);
+	for (size_t i = 0; i < vecEvent.size(); )
+	{
+		size_t count = std::min<size_t>(vecEvent.size() - i, 1 + rng() % 10000);
+		CHECK(writer.writeEvents(vector<EventData>(vecEvent.begin() + i, vecEvent.begin() + i + count)));
+		i += count;
+	}
+	CHECK(writer.closeFile());
+	CHECK(writer.getEventCount() == vecEvent.size());
+
+	vector<EventData> vecRead;
+	CeleX5EventFileReader reader;
+	CHECK(reader.openFile(EVENT_FILE_PATH));
+	CHECK(reader.getEventCount() == vecEvent.size());
+	CHECK(reader.getBlockCount() == (vecEvent.size() + 4095) / 4096);
+	CHECK(readEventFile(reader, vecRead));
+	CHECK(vecRead.size() == vecEvent.size() && isPrefix(vecRead, vecEvent));
+
+	CeleX5EventFileReader::BlockInfo info;
+	CHECK(reader.getBlockInfo(1, info));
+	CHECK(info.eventCount == 4096 && info.firstT == vecEvent[4096].t && info.lastT == vecEvent[2 * 4096 - 1].t);
+	CHECK(!reader.getBlockInfo(reader.getBlockCount(), info));
+	CHECK(reader.findBlock(0) == 0);
+	CHECK(reader.findBlock(0xFFFFFFFF) == reader.getBlockCount());
+	uint32_t blockCount = reader.getBlockCount();
+	CeleX5EventFileReader::BlockInfo lastInfo;
+	reader.getBlockInfo(blockCount - 1, lastInfo);
+	reader.closeFile();
+
+	//without the footer (writing interrupted) the blocks are found by walking their headers
+	FILE* pFile = fopen(EVENT_FILE_PATH, "rb");
+	CHECK(NULL != pFile);
+	fseek(pFile, 0, SEEK_END);
+	long fileSize = ftell(pFile);
+	fclose(pFile);
+	CHECK(0 == truncate(EVENT_FILE_PATH, fileSize - 1));
+	CHECK(reader.openFile(EVENT_FILE_PATH));
+	CHECK(reader.getBlockCount() == blockCount);
+	CHECK(readEventFile(reader, vecRead));
+	CHECK(vecRead.size() == vecEvent.size() && isPrefix(vecRead, vecEvent));
+	reader.closeFile();
+
+	//a torn last block is dropped, the blocks before it are kept
+	CHECK(0 == truncate(EVENT_FILE_PATH, lastInfo.offset + 10));
+	CHECK(reader.openFile(EVENT_FILE_PATH));
+	CHECK(reader.getBlockCount() == blockCount - 1);
+	CHECK(readEventFile(reader, vecRead));
+	CHECK(vecRead.size() == (blockCount - 1) * 4096 && isPrefix(vecRead, vecEvent));
+	reader.closeFile();
+
+	remove(EVENT_FILE_PATH);
+}
+
+static void testColumnFile()
+{
+	//row groups are searched by time, so t increases here
+	vector<EventData> vecEvent;
+	makeEvents(vecEvent, 25000);
+	for (size_t i = 0; i < vecEvent.size(); i++)
+		vecEvent[i].t = uint32_t(i / 5);
+
+	CeleX5ColumnFileWriter writer(1000);
+	CHECK(writer.openFile(COLUMN_FILE_PATH));
+	CHECK(writer.writeEvents(vector<EventData>(vecEvent.begin(), vecEvent.begin() + 2500)));
+	CHECK(writer.writeEvents(vector<EventData>(vecEvent.begin() + 2500, vecEvent.end())));
+	CHECK(writer.closeFile());
+	CHECK(writer.getEventCount() == vecEvent.size());
+
+	CeleX5ColumnFileReader reader;
+	CHECK(reader.openFile(COLUMN_FILE_PATH));
+	CHECK(reader.getEventCount() == vecEvent.size());
+	CHECK(reader.getRowGroupCount() == 25);
+
+	vector<EventData> vecRead, vecRowGroup;
+	for (uint32_t i = 0; i < reader.getRowGroupCount(); i++)
+	{
+		CHECK(reader.readRowGroup(i, vecRowGroup));
+		vecRead.insert(vecRead.end(), vecRowGroup.begin(), vecRowGroup.end());
+	}
+	CHECK(vecRead.size() == vecEvent.size() && isPrefix(vecRead, vecEvent));
+
+	CeleX5ColumnFileReader::RowGroupInfo info;
+	CHECK(reader.getRowGroupInfo(3, info));
+	CHECK(info.rowCount == 1000 && info.minT == 600 && info.maxT == 799);
+
+	uint32_t rowCount = 0;
+	const int8_t* pPolarity = (const int8_t*)reader.getColumnData(3, CeleX5ColumnFileReader::Column_Polarity, rowCount);
+	CHECK(NULL != pPolarity && rowCount == 1000);
+	if (pPolarity)
+		CHECK(pPolarity[7] == int8_t(int16_t(vecEvent[3007].polarity)));
+
+	vector<uint32_t> vecIndex;
+	reader.findRowGroups(1500, 1600, vecIndex);
+	CHECK(vecIndex.size() == 2 && vecIndex[0] == 7 && vecIndex[1] == 8);
+	CHECK(reader.readTimeRange(1500, 1600, vecRead));
+	CHECK(vecRead.size() == 505 && isSameEvent(vecRead[0], vecEvent[7500]) && isSameEvent(vecRead.back(), vecEvent[8004]));
+	reader.findRowGroups(10000, 20000, vecIndex);
+	CHECK(vecIndex.empty());
+	reader.closeFile();
+
+	remove(COLUMN_FILE_PATH);
+}
+
+int main()
+{
+	testEventFile();
+	testColumnFile();
+	return testResult("test_eventfiles");
+}
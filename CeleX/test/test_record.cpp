@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "testutil.h"
+#include "record/datarecorder.h"
+#include "record/dataplayer.h"
+#include "record/shardedrecorder.h"
+#include "record/shardedplayer.h"
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+#define RECORD_PATH       "test_record.rec"
+#define INDEX_PATH        RECORD_PATH RECORD_INDEX_SUFFIX
+#define INDEX_COPY_PATH   "test_record.idx.copy"
+#define MANIFEST_PATH     "test_record.cx5m"
+
+#define PACKET_NUMBER     6000
+#define PACKET_INTERVAL   100 //unit: us
+#define REGISTER_INTERVAL 100 //a register write before every 100th packet
+#define FIRST_TIME_STAMP  1000000
+
+// Packet i carries i in its first bytes and is followed by bytes derived from i,
+// its size varies so that records straddle the ends of the blocks
+static uint32_t packetSize(uint64_t i)
+{
+	return 16 + (i * 7919) % 8000;
+}
+
+static void makePacket(uint64_t i, vector<uint8_t>& vecData)
+{
+	vecData.resize(packetSize(i));
+	memcpy(vecData.data(), &i, sizeof(i));
+	for (size_t k = sizeof(i); k < vecData.size(); k++)
+		vecData[k] = uint8_t(i + k);
+}
+
+static bool isPacket(uint64_t i, const RecordPacketHeader* pHeader, const uint8_t* pData)
+{
+	vector<uint8_t> vecData;
+	makePacket(i, vecData);
+	return pHeader->type == RECORD_TYPE_MIPI_PACKET && pHeader->sequence == i &&
+		pHeader->timeStamp == FIRST_TIME_STAMP + i * PACKET_INTERVAL &&
+		pHeader->dataSize == vecData.size() && 0 == memcmp(pData, vecData.data(), vecData.size());
+}
+
+// Register writes carry the sequence of the packet that follows them, as CeleX5 records them
+template<typename Recorder>
+static bool writePackets(Recorder& recorder)
+{
+	vector<uint8_t> vecData;
+	bool bSucceeded = true;
+	for (uint64_t i = 0; i < PACKET_NUMBER; i++)
+	{
+		RecordPacketHeader header;
+		memset(&header, 0, sizeof(header));
+		header.timeStamp = FIRST_TIME_STAMP + i * PACKET_INTERVAL;
+		header.sequence = i;
+		if (0 == i % REGISTER_INTERVAL)
+		{
+			RecordRegisterWrite registerWrite = { 73, uint32_t(i), 0xFF, 0 };
+			header.type = RECORD_TYPE_REGISTER_WRITE;
+			header.dataSize = sizeof(registerWrite);
+			bSucceeded &= recorder.writePacket(header, (const uint8_t*)&registerWrite);
+		}
+		makePacket(i, vecData);
+		header.type = RECORD_TYPE_MIPI_PACKET;
+		header.dataSize = vecData.size();
+		bSucceeded &= recorder.writePacket(header, vecData.data());
+	}
+	return bSucceeded;
+}
+
+// Reads to the end: the MIPI packets have to come in order from 0 on, each register write
+// right before the packet of its sequence; returns the number of packets read
+template<typename Player>
+static uint64_t readPackets(Player& player, int& errors)
+{
+	const uint8_t* pData = NULL;
+	const RecordPacketHeader* pHeader = NULL;
+	uint64_t packetCount = 0;
+	bool bRegisterWrite = false;
+	while (NULL != (pHeader = player.getNextRecord(&pData)))
+	{
+		if (RECORD_TYPE_CHECKPOINT == pHeader->type)
+			continue;
+		if (RECORD_TYPE_REGISTER_WRITE == pHeader->type)
+		{
+			RecordRegisterWrite registerWrite;
+			memcpy(&registerWrite, pData, sizeof(registerWrite));
+			if (pHeader->sequence != packetCount || registerWrite.value != packetCount)
+				errors++;
+			bRegisterWrite = true;
+			continue;
+		}
+		if (!isPacket(packetCount, pHeader, pData) || bRegisterWrite != (0 == packetCount % REGISTER_INTERVAL))
+			errors++;
+		bRegisterWrite = false;
+		packetCount++;
+	}
+	return packetCount;
+}
+
+// The next MIPI packet is number i
+template<typename Player>
+static bool isAtPacket(Player& player, uint64_t i)
+{
+	const uint8_t* pData = NULL;
+	const RecordPacketHeader* pHeader = player.getNextRecord(&pData);
+	while (pHeader && RECORD_TYPE_MIPI_PACKET != pHeader->type)
+		pHeader = player.getNextRecord(&pData);
+	return pHeader && isPacket(i, pHeader, pData);
+}
+
+// Packets that surely fit into the blocks: records are 8 byte aligned, a block may leave
+// the room of a record unused, and some room goes to the checkpoints
+static uint64_t packetsInBlocks(uint32_t blockCount)
+{
+	uint64_t room = uint64_t(blockCount) * (RECORD_BLOCK_SIZE - sizeof(RecordBlockHeader) - 64 * 1024);
+	uint64_t size = 0;
+	uint64_t i = 0;
+	for (; i < PACKET_NUMBER; i++)
+	{
+		if (0 == i % REGISTER_INTERVAL)
+			size += (sizeof(RecordPacketHeader) + sizeof(RecordRegisterWrite) + 7) & ~7;
+		size += (sizeof(RecordPacketHeader) + packetSize(i) + 7) & ~7;
+		if (size > room)
+			break;
+	}
+	return i;
+}
+
+static bool copyFile(const char* sourcePath, const char* destinationPath)
+{
+	FILE* pSource = fopen(sourcePath, "rb");
+	if (!pSource)
+		return false;
+	FILE* pDestination = fopen(destinationPath, "wb");
+	if (!pDestination)
+	{
+		fclose(pSource);
+		return false;
+	}
+	char buffer[4096];
+	size_t size = 0;
+	while ((size = fread(buffer, 1, sizeof(buffer), pSource)) > 0)
+		fwrite(buffer, 1, size, pDestination);
+	fclose(pSource);
+	fclose(pDestination);
+	return true;
+}
+
+static bool recordFile()
+{
+	DataRecorder recorder;
+	recorder.setIndexInterval(10);
+	recorder.setCheckpointInterval(50);
+	if (!recorder.startRecording(RECORD_PATH, false))
+		return false;
+	bool bSucceeded = writePackets(recorder);
+	recorder.stopRecording();
+	return bSucceeded && recorder.getDroppedPacketCount() == 0;
+}
+
+static void testRoundTrip()
+{
+	CHECK(recordFile());
+	CHECK(0 == access(INDEX_PATH, F_OK));
+
+	DataPlayer player;
+	CHECK(player.openFile(RECORD_PATH));
+	CHECK(player.getStartTimeStamp() == FIRST_TIME_STAMP);
+	int errors = 0;
+	CHECK(readPackets(player, errors) == PACKET_NUMBER);
+	CHECK(0 == errors);
+	CHECK(player.isEndOfFile());
+
+	CHECK(player.seekToPacket(0) && isAtPacket(player, 0));
+	CHECK(player.seekToPacket(1) && isAtPacket(player, 1));
+	CHECK(player.seekToPacket(4321) && player.getPacketNumber() == 4321 && isAtPacket(player, 4321));
+	CHECK(player.seekToPacket(PACKET_NUMBER - 1) && isAtPacket(player, PACKET_NUMBER - 1));
+	CHECK(!player.seekToPacket(PACKET_NUMBER));
+	CHECK(player.seekToTime(0) && isAtPacket(player, 0));
+	CHECK(player.seekToTime(PACKET_INTERVAL) && isAtPacket(player, 1));
+	CHECK(player.seekToTime(2500 * PACKET_INTERVAL - 1) && isAtPacket(player, 2500));
+	player.rewind();
+	CHECK(isAtPacket(player, 0));
+	player.closeFile();
+}
+
+// A crash leaves a torn last block behind, and the index of an earlier, longer run of the
+// recording may be lying next to it: the player must not trust that index
+static void testCrashRecovery()
+{
+	CHECK(recordFile());
+	CHECK(copyFile(INDEX_PATH, INDEX_COPY_PATH));
+
+	//cut the recording in the middle of its fourth block
+	CHECK(0 == truncate(RECORD_PATH, RECORD_FILE_HEADER_SIZE + 3 * RECORD_BLOCK_SIZE + RECORD_BLOCK_SIZE / 2));
+	DataPlayer player;
+	CHECK(player.openFile(RECORD_PATH));
+	int errors = 0;
+	uint64_t packetCount = readPackets(player, errors);
+	CHECK(0 == errors);
+	CHECK(packetCount < PACKET_NUMBER);
+	//every packet of the complete blocks is kept
+	CHECK(packetCount >= packetsInBlocks(3));
+	CHECK(player.seekToPacket(packetCount - 1) && isAtPacket(player, packetCount - 1));
+	CHECK(!player.seekToPacket(packetCount));
+	CHECK(player.seekToPacket(packetCount / 2) && isAtPacket(player, packetCount / 2));
+	CHECK(player.seekToTime((packetCount / 3) * PACKET_INTERVAL) && isAtPacket(player, packetCount / 3));
+	player.closeFile();
+
+	//a new recording removes the index of the last one, whose index is then put back
+	CHECK(recordFile());
+	CHECK(copyFile(INDEX_COPY_PATH, INDEX_PATH));
+	CHECK(player.openFile(RECORD_PATH));
+	CHECK(player.seekToPacket(4321) && isAtPacket(player, 4321));
+	CHECK(player.seekToTime(2500 * PACKET_INTERVAL) && isAtPacket(player, 2500));
+	player.closeFile();
+
+	remove(RECORD_PATH);
+	remove(INDEX_PATH);
+	remove(INDEX_COPY_PATH);
+}
+
+// Whatever shard a record went to, the player merges them back into the recorded order
+static void testShardedMerge(uint32_t policy)
+{
+	vector<string> vecDirectory(3, ".");
+	ShardedRecorder recorder;
+	CHECK(recorder.startRecording(MANIFEST_PATH, vecDirectory, policy, 20, false));
+	CHECK(recorder.getShardCount() == 3);
+	CHECK(writePackets(recorder));
+	recorder.stopRecording();
+	CHECK(recorder.getDroppedPacketCount() == 0);
+
+	ShardedPlayer player;
+	CHECK(player.openFile(MANIFEST_PATH));
+	CHECK(player.getShardCount() == 3);
+	int errors = 0;
+	CHECK(readPackets(player, errors) == PACKET_NUMBER);
+	CHECK(0 == errors);
+	CHECK(player.seekToPacket(0) && isAtPacket(player, 0));
+	CHECK(player.seekToPacket(1000) && isAtPacket(player, 1000));
+	CHECK(player.seekToPacket(PACKET_NUMBER - 1) && isAtPacket(player, PACKET_NUMBER - 1));
+	CHECK(player.seekToTime(1500 * PACKET_INTERVAL) && isAtPacket(player, 1500));
+	player.closeFile();
+
+	remove(MANIFEST_PATH);
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		string shardPath = string("./") + MANIFEST_PATH + "." + to_string(i);
+		remove(shardPath.c_str());
+		remove((shardPath + RECORD_INDEX_SUFFIX).c_str());
+	}
+}
+
+int main()
+{
+	testRoundTrip();
+	testCrashRecovery();
+	testShardedMerge(RECORD_SHARD_ROUND_ROBIN);
+	testShardedMerge(RECORD_SHARD_TIME_SEGMENT);
+	return testResult("test_record");
+}
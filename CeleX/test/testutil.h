@@ -0,0 +1,52 @@
+/*
+* Copyright (c) 2017-2018 CelePixel Technology Co. Ltd. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef TESTUTIL_H
+#define TESTUTIL_H
+
+#include <iostream>
+#include <string>
+
+// Checks of the test programs built by "make check": a failed check is reported with its
+// file and line, and the program exits with the number of failed checks.
+inline int& failedCheckCount()
+{
+	static int count = 0;
+	return count;
+}
+
+inline bool checkCondition(bool condition, const char* text, const char* file, int line)
+{
+	if (!condition)
+	{
+		std::cout << file << ":" << line << ": check failed: " << text << std::endl;
+		failedCheckCount()++;
+	}
+	return condition;
+}
+
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+
+inline int testResult(const std::string& testName)
+{
+	if (failedCheckCount() > 0)
+		std::cout << testName << ": " << failedCheckCount() << " checks failed" << std::endl;
+	else
+		std::cout << testName << ": passed" << std::endl;
+	return failedCheckCount();
+}
+
+#endif // TESTUTIL_H
@@ -18,8 +18,13 @@
 #define CELEX5_H
 
 #include <stdint.h>
+#include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
 #include "../celextypes.h"
 
 #ifdef _WIN32
@@ -39,8 +44,14 @@
 using namespace std;
 
 class CeleDriver;
-class HHSequenceMgr;
+class CeleX5CfgProfile;
 class CommandBase;
+class ShardedRecorder;
+class ShardedPlayer;
+class RingRecorder;
+class RegisterCache;
+class ConfigQueue;
+struct RegisterField;
 class CELEX_EXPORTS CeleX5
 {
 public:
@@ -54,6 +65,26 @@ public:
 		Full_Optical_Flow_M_Mode = 6,
 	};
 
+	enum RecordShardPolicy {
+		Shard_Round_Robin = 0,
+		Shard_Time_Segment = 1,
+	};
+
+	enum PlaybackMode {
+		Playback_As_Fast_As_Possible = 0,
+		Playback_Real_Time = 1,
+	};
+
+	//A register write logged in a recording, made before the packet with this sequence
+	typedef struct RegisterWrite
+	{
+		uint64_t    timeStamp; //host time, unit: us
+		uint64_t    sequence;
+		uint32_t    address;
+		uint32_t    value;
+		uint32_t    mask;
+	} RegisterWrite;
+
 	typedef struct CfgInfo
 	{
 		std::string name;
@@ -66,13 +97,88 @@ public:
 		int16_t     low_addr;
 	} CfgInfo;
 
+	//One MIPI frame; data/size is a view into buffer, which keeps the frame alive.
+	//Frames of a playback file have no buffer, they stay valid until the file is closed.
+	typedef struct MIPIPacket
+	{
+		shared_ptr<vector<uint8_t>> buffer;
+		const uint8_t*  data;
+		uint32_t        size;
+		CeleX5Mode      mode;
+		uint64_t        sequence;
+		uint32_t        configVersion; //of the sensor configuration the packet was captured with
+	} MIPIPacket;
+
+	//Sensor settings recorded with a packet, see getPlaybackSensorState
+	typedef struct SensorState
+	{
+		uint32_t    threshold;
+		uint32_t    brightness;
+		uint32_t    contrast;
+		uint32_t    clockRate; //unit: MHz
+		bool        loopModeEnabled;
+		bool        autoISPEnabled;
+		uint32_t    eventPacketFormat; //EVENT_PACKET_SELECT
+	} SensorState;
+
+	//Sensor parameters applied together by commitSensorConfig
+	typedef struct SensorConfig
+	{
+		uint32_t    threshold;
+		uint32_t    brightness;
+		uint32_t    contrast;
+		uint32_t    version; //set by commitSensorConfig, starts at 0
+	} SensorConfig;
+
+	//A switch of the fixed mode done by setSensorFixedMode
+	typedef struct ModeSwitch
+	{
+		CeleX5Mode  fromMode;
+		CeleX5Mode  toMode;
+		uint32_t    writeCount; //register writes sent by the switch, without those entering and leaving CFG mode
+		uint64_t    duration; //unit: us
+		uint64_t    sequence; //of the first packet read after the switch
+	} ModeSwitch;
+
+	//The PLL and MIPI PLL parameters of a clock rate, an entry of the clock table
+	typedef struct ClockSetting
+	{
+		uint32_t    clockRate; //unit: MHz
+		uint32_t    pllDivN;
+		uint32_t    pllDivL;
+		uint32_t    pllFoutDiv1;
+		uint32_t    pllFoutDiv2;
+		uint32_t    mipiPllDivI;
+		uint32_t    mipiPllDivN;
+	} ClockSetting;
+
+	//A change of the clock rate done by setClockRate
+	typedef struct ClockRetune
+	{
+		uint32_t    fromRate; //unit: MHz
+		uint32_t    toRate;
+		uint32_t    writeCount; //I2C writes
+		uint64_t    writeDuration; //unit: us
+		uint64_t    settleTime; //until the first packet captured at the new rate is read, unit: us, 0: none yet
+		uint64_t    sequence; //of that packet
+	} ClockRetune;
+
+	//One phase of the sensor bring-up done by openSensor
+	typedef struct BringUpPhase
+	{
+		std::string name;
+		uint32_t    writeCount; //register writes in the phase, including those skipped by the cache
+		uint64_t    duration; //unit: us
+	} BringUpPhase;
+
 	CeleX5();
 	~CeleX5();
 
 	bool openSensor();
 	bool getMIPIData(vector<uint8_t> &buffer);
+	bool getMIPIData(MIPIPacket &packet); //zero-copy when playing back a recording
 
-	void setSensorFixedMode(CeleX5Mode mode);
+	bool setSensorFixedMode(CeleX5Mode mode);
 	CeleX5Mode getSensorFixedMode();
 
 	void setSensorLoopMode(CeleX5Mode mode, int loopNum); //LopNum = 1/2/3
@@ -85,41 +191,174 @@ public:
 	void setPictureNumber(uint32_t num, CeleX5Mode mode);
 
 	//------- sensor control interfaces -------
-	void setThreshold(uint32_t value);
+	//the setters return false if a register write failed or the value was rejected
+	bool setThreshold(uint32_t value);
 	uint32_t getThreshold();
-	void setContrast(uint32_t value);
+	bool setContrast(uint32_t value);
 	uint32_t getContrast();
-	void setBrightness(uint32_t value);
+	bool setBrightness(uint32_t value);
 	uint32_t getBrightness();
 	uint32_t getClockRate(); //unit: MHz
-	void setClockRate(uint32_t value); //range: 20 ~ 100, step: 10, unit: MHz
+	bool setClockRate(uint32_t value); //a rate of the clock table, by default 20 ~ 100, step: 10, unit: MHz
 
-	void setAutoISPEnabled(bool enable);
+	bool setAutoISPEnabled(bool enable);
 	bool isAutoISPEnabled();
-	void setISPThreshold(uint32_t value, int num);
-	void setISPBrightness(uint32_t value, int num);
+	bool setISPThreshold(uint32_t value, int num);
+	bool setISPBrightness(uint32_t value, int num);
+
+	//------- clock rate table -------
+	//setClockRate only powers the PLL down when its parameters change and the MIPI lanes
+	//when the MIPI PLL parameters change; all in one register batch
+	bool setClockTable(const vector<ClockSetting>& vecSetting); //false if an entry is invalid
+	void getClockTable(vector<ClockSetting>& vecSetting);
+	void getLastClockRetune(ClockRetune& retune);
+
+	//------- consistent multi-register updates -------
+	//take a snapshot of the parameters, change it and commit it: the changed parameters are
+	//written in one CFG mode window, the data buffered before is dropped and the packets
+	//read afterwards carry the new version. Returns the new version.
+	//setThreshold, setBrightness and setContrast change the version too when they write
+	void getSensorConfig(SensorConfig &config);
+	uint32_t commitSensorConfig(const SensorConfig &config);
+	uint32_t getConfigVersion();
+
+	//------- asynchronous configuration -------
+	//the post functions return at once, the settings are applied in order on a control
+	//thread; a setting posted again before it was applied is written once, with the latest
+	//value. callback: called on the control thread once the setting was applied, with what
+	//the setter returned (for a replaced setting: the setter of the latest value).
+	//Don't call the setters above while posted settings are pending, see waitForConfig
+	typedef std::function<void(bool bSucceeded)> ConfigCallback;
+	void postThreshold(uint32_t value, ConfigCallback callback = nullptr);
+	void postContrast(uint32_t value, ConfigCallback callback = nullptr);
+	void postBrightness(uint32_t value, ConfigCallback callback = nullptr);
+	void postClockRate(uint32_t value, ConfigCallback callback = nullptr);
+	void postSensorFixedMode(CeleX5Mode mode, ConfigCallback callback = nullptr);
+	void postAutoISPEnabled(bool enable, ConfigCallback callback = nullptr);
+	void postISPThreshold(uint32_t value, int num, ConfigCallback callback = nullptr);
+	void postISPBrightness(uint32_t value, int num, ConfigCallback callback = nullptr);
+	void waitForConfig(); //until all the settings posted so far were applied
+	uint64_t getCoalescedConfigCount(); //posted settings replaced by a later value
+
+	//------- record the MIPI data -------
+	//bDirectIO: bypass the page cache (O_DIRECT) where the platform supports it
+	bool startRecording(string filePath, bool bDirectIO = false);
+	//stripe the recording over several directories (disks), one writer thread each;
+	//play it back by opening the manifest. segmentDuration unit: ms, for Shard_Time_Segment
+	bool startShardedRecording(string manifestPath, const vector<string>& vecDirectory,
+		RecordShardPolicy policy = Shard_Round_Robin, uint32_t segmentDuration = 1000, bool bDirectIO = false);
+	void stopRecording();
+	bool isRecording();
+
+	//------- keep the last seconds of MIPI data in memory, save them on a trigger -------
+	//duration unit: ms, 0: disabled; maxBytes: memory limit of the buffered packets
+	void setPreTriggerBuffer(uint32_t duration, uint64_t maxBytes);
+	//save the buffered packets and those of the next postTriggerTime ms in the background
+	bool triggerRecording(string filePath, uint32_t postTriggerTime, bool bDirectIO = false);
+	bool isSavingTriggerRecording();
+
+	//------- play back a recording through getMIPIData -------
+	bool openPlaybackFile(string filePath); //a recording or the manifest of a sharded one
+	void closePlaybackFile();
+	bool isPlaybackFileOpened();
+	bool isPlaybackFinished();
+	void setPlaybackMode(PlaybackMode mode);
+	PlaybackMode getPlaybackMode();
+	//seek in O(log n) with the index written next to the recording, then reset the decoders
+	//(CeleX5DataProcessor::resetDecoderState); time unit: us from the first packet
+	bool seekPlaybackTime(uint64_t time);
+	bool seekPlaybackPacket(uint64_t packetNumber);
+	uint64_t getPlaybackPacketNumber();
+	//register writes read since the last call, they were made before the last packet
+	//returned by getMIPIData; feed them to CeleX5DataProcessor::processRegisterWrite
+	void getPlaybackRegisterWrites(vector<RegisterWrite> &vecRegisterWrite);
+	//the sensor settings recorded with the last packet returned by getMIPIData, the getters
+	//of the settings keep reporting the sensor; false if no packet was played back yet
+	bool getPlaybackSensorState(SensorState &state);
 
 	map<string, vector<CfgInfo>> getCeleX5Cfg();
 	void writeRegister(int16_t addressH, int16_t addressM, int16_t addressL, uint32_t value);
-	void writeCSRDefaults(string csrType);
+	void writeCSRDefaults(const string& csrType);
+
+	//------- register batches -------
+	//under auto ISP, ALS is disabled once for all the writes up to endRegisterBatch instead
+	//of around every write; batches nest, the outermost one enables ALS again
+	void beginRegisterBatch();
+	void endRegisterBatch();
+
+	//------- shadow register cache -------
+	//writes of the value a register already holds are skipped, reads are served from
+	//the cache where the sensor can't have changed the register on its own
+	void setRegisterCacheEnabled(bool enable);
+	bool isRegisterCacheEnabled();
+	bool readRegister(uint32_t address, uint32_t &value);
+	uint64_t getRegisterWriteCount(); //I2C writes issued
+	uint64_t getElidedRegisterWriteCount(); //writes skipped by the cache
+	uint64_t getFailedRegisterWriteCount(); //I2C writes that failed, or found no open sensor
+
+	//------- mode switching -------
+	//setSensorFixedMode only writes the registers that differ between the configurations of
+	//the two modes, as long as nothing else has written to them in between
+	void getLastModeSwitch(ModeSwitch &modeSwitch);
+
+	//------- sensor bring-up -------
+	//time taken by every phase of the last openSensor
+	void getBringUpTimes(vector<BringUpPhase> &vecPhase);
 
 private:
+	typedef struct RegisterValue
+	{
+		uint32_t    address;
+		uint32_t    value;
+	} RegisterValue;
+
+	//keys of the posted settings, the profile number goes into the low byte
+	enum ConfigKey {
+		Config_Threshold = 0x100,
+		Config_Contrast = 0x200,
+		Config_Brightness = 0x300,
+		Config_ClockRate = 0x400,
+		Config_SensorFixedMode = 0x500,
+		Config_AutoISPEnabled = 0x600,
+		Config_ISPThreshold = 0x700,
+		Config_ISPBrightness = 0x800,
+	};
+
+	typedef struct BringUpStep
+	{
+		std::string           name;
+		vector<RegisterValue> writes;
+	} BringUpStep;
+
 	bool configureSettings();
+	void buildModeConfigs();
+	void buildBringUpSequence();
+	void appendCSRDefaults(vector<RegisterValue> &vecWrite, const string& csrType);
+	void appendField(vector<RegisterValue> &vecWrite, const RegisterField& field, uint32_t value);
+	void replaceField(vector<RegisterValue> &vecWrite, const RegisterField& field, uint32_t value);
 	//for write register
 	void wireIn(uint32_t address, uint32_t value, uint32_t mask);
-	void writeRegister(CfgInfo cfgInfo);
+	void writeField(const RegisterField& field, uint32_t value);
+	bool isFieldCached(const RegisterField& field, uint32_t value);
+	void writeThreshold(uint32_t value);
+	void writeContrast(uint32_t value);
+	void writeBrightness(uint32_t value);
+	uint32_t changeConfigVersion();
 	void setALSEnabled(bool enable);
 	void enterCFGMode();
 	void enterStartMode();
 	void disableMIPI();
 	void enableMIPI();
+	uint32_t getCfgDefault(const string& csrType, const string& name, uint32_t defaultValue);
+	void recordMIPIData(const uint8_t* pData, uint32_t dataSize, uint64_t sequence);
+	void writeRecord(uint16_t type, uint16_t mode, const uint8_t* pData, uint32_t dataSize, uint64_t sequence);
+	bool getPlaybackPacket(MIPIPacket &packet);
+	bool readSensorData(vector<uint8_t> &buffer, uint32_t &configVersion, uint64_t &sequence);
 
 private:
 	CeleDriver*                    m_pCeleDriver;
 
-	HHSequenceMgr*                 m_pSequenceMgr;
-	//
-	map<string, vector<CfgInfo>>   m_mapCfgDefaults;
+	CeleX5CfgProfile*              m_pCfgProfile; //the CSR defaults
 
 	CeleX5Mode                     m_emSensorFixedMode;
 	CeleX5Mode                     m_emSensorLoopMode[3];
@@ -135,6 +374,39 @@ private:
 	uint32_t                       m_arrayISPThreshold[3];
 	uint32_t                       m_arrayBrightness[4];
 	uint32_t                       m_uiAutoISPRefreshTime;
+	uint32_t                       m_uiEventPacketFormat;
+
+	ShardedRecorder*               m_pRecorder;
+	ShardedPlayer*                 m_pPlayer;
+	RingRecorder*                  m_pRingRecorder;
+	RegisterCache*                 m_pRegisterCache;
+	ConfigQueue*                   m_pConfigQueue;
+	bool                           m_bRegisterCacheEnabled;
+	uint64_t                       m_ulRegisterWriteCount;
+	uint64_t                       m_ulElidedRegisterWriteCount;
+	uint64_t                       m_ulFailedRegisterWriteCount;
+	uint32_t                       m_uiRegisterBatchDepth;
+	vector<BringUpStep>            m_vecBringUpSequence;
+	bool                           m_bBringUpSequenceChanged; //rebuild it before the next bring-up
+	vector<BringUpPhase>           m_vecBringUpPhase;
+	//the registers of a fixed mode, indexed by CeleX5Mode (SENSOR_MODE is 3 bits)
+	vector<RegisterValue>          m_vecModeConfig[8];
+	vector<RegisterValue>          m_vecModeDelta[8][8]; //[from][to]
+	vector<bool>                   m_vecModeConfigRegister; //by address: written by a mode configuration
+	bool                           m_bModeConfigApplied; //the configuration of m_emSensorFixedMode is in effect
+	bool                           m_bApplyingModeConfig;
+	ModeSwitch                     m_lastModeSwitch;
+	vector<RegisterWrite>          m_vecPlaybackRegisterWrite;
+	SensorState                    m_playbackSensorState;
+	bool                           m_bPlaybackSensorStateValid;
+	atomic<uint64_t>               m_ulPacketSequence; //of the next packet read, changed under m_mutexConfigVersion
+	atomic<uint32_t>               m_uiConfigVersion;
+	mutex                          m_mutexConfigVersion; //orders getimage against clearData and the version change
+	vector<ClockSetting>           m_vecClockTable; //sorted by clockRate
+	ClockRetune                    m_lastClockRetune;
+	mutex                          m_mutexClockRetune; //guards m_lastClockRetune and m_ulClockRetuneStart
+	uint64_t                       m_ulClockRetuneStart; //steady clock, unit: us
+	atomic<bool>                   m_bClockSettling; //no packet read since the last retune
 };
 
 #endif // CELEX5_H
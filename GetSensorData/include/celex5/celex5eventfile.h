@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CELEX5_EVENTFILE_H
+#define CELEX5_EVENTFILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "celex5.h"
+
+using namespace std;
+
+class LZCompressor;
+class MappedFile;
+
+// Compact file of decoded events (EventData), several times smaller than the MIPI
+// recording: time stamps and coordinates are delta coded and every block of events
+// is compressed on its own, so blocks can be decoded in any order and in parallel.
+class CELEX_EXPORTS CeleX5EventFileWriter
+{
+public:
+	CeleX5EventFileWriter(uint32_t blockEventCount = 65536);
+	~CeleX5EventFileWriter();
+
+	bool openFile(const string& filePath);
+	bool closeFile(); //writes the last block and the block index
+	bool isOpened();
+
+	bool writeEvents(const vector<EventData> &vecEvent);
+
+	uint64_t getEventCount();
+	uint64_t getWrittenBytes();
+
+private:
+	bool writeBlock();
+
+private:
+	ofstream                       m_ofstream;
+	uint32_t                       m_uiBlockEventCount;
+	vector<EventData>              m_vecEventData; //events of the block being filled
+	vector<uint8_t>                m_vecRawBlock;
+	vector<uint8_t>                m_vecStoredBlock;
+	vector<uint8_t>                m_vecIndex; //EventIndexEntry of every written block
+	LZCompressor*                  m_pCompressor;
+
+	uint64_t                       m_ulEventCount;
+	uint64_t                       m_ulWrittenBytes;
+};
+
+class CELEX_EXPORTS CeleX5EventFileReader
+{
+public:
+	typedef struct BlockInfo
+	{
+		uint64_t    offset;
+		uint32_t    eventCount;
+		uint32_t    firstT; //EventData::t of the first and the last event
+		uint32_t    lastT;
+	} BlockInfo;
+
+	CeleX5EventFileReader();
+	~CeleX5EventFileReader();
+
+	bool openFile(const string& filePath);
+	void closeFile();
+	bool isOpened();
+
+	uint32_t getBlockCount();
+	bool getBlockInfo(uint32_t index, BlockInfo &info);
+	uint64_t getEventCount();
+	//first block that may hold events at or after t, getBlockCount() if none
+	uint32_t findBlock(uint32_t t);
+
+	//may be called from several threads at once
+	bool readBlock(uint32_t index, vector<EventData> &vecEvent);
+
+private:
+	bool loadIndex();
+	void scanBlocks();
+
+private:
+	MappedFile*                    m_pMappedFile;
+	vector<BlockInfo>              m_vecBlockInfo;
+	uint32_t                       m_uiBlockEventCount; //EventFileHeader::blockEventCount
+	uint64_t                       m_ulEventCount;
+};
+
+#endif // CELEX5_EVENTFILE_H
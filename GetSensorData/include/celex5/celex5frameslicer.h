@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CELEX5_FRAMESLICER_H
+#define CELEX5_FRAMESLICER_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include "celex5.h"
+
+using namespace std;
+
+// Cut the decoded event stream into frames of similar workload instead of fixed time windows.
+// A frame is closed when it holds the target number of events, when one tile of the pixel
+// array reaches the activity threshold, or when it has been open for the maximum latency.
+class CELEX_EXPORTS CeleX5FrameSlicer
+{
+public:
+	enum SliceReason {
+		Slice_Event_Count = 0,
+		Slice_Area_Activity = 1,
+		Slice_Max_Latency = 2,
+		Slice_Flush = 3,
+	};
+
+	typedef struct EventFrame
+	{
+		vector<EventData> events;
+		uint32_t          startT;
+		uint32_t          endT;
+		SliceReason       reason;
+	} EventFrame;
+
+	CeleX5FrameSlicer();
+	~CeleX5FrameSlicer();
+
+	void setTargetEventCount(uint32_t count); //0: disabled
+	uint32_t getTargetEventCount();
+	//tileSize is rounded down to a power of two; count = 0: disabled
+	void setAreaActivityThreshold(uint32_t count, uint32_t tileSize);
+	uint32_t getAreaActivityThreshold();
+	void setMaxLatency(uint32_t time); //unit: EventData::t, 0: disabled
+	uint32_t getMaxLatency();
+
+	void addEvents(const vector<EventData> &vecEvent);
+	//close the open frame if it has been open for the maximum latency at time t,
+	//for the case that no more events arrive in a static scene
+	void checkLatency(uint32_t t);
+	void flush();
+
+	bool getFrame(EventFrame &frame);
+	uint32_t getFrameCount(); //number of closed frames waiting to be taken
+
+private:
+	void closeFrame(SliceReason reason);
+
+private:
+	uint32_t                       m_uiTargetEventCount;
+	uint32_t                       m_uiAreaThreshold;
+	uint32_t                       m_uiMaxLatency;
+
+	uint32_t                       m_uiTileShift;
+	uint32_t                       m_uiTilesPerRow;
+	vector<uint32_t>               m_vecTileCount;
+	vector<uint32_t>               m_vecTouchedTile;
+
+	EventFrame                     m_currentFrame;
+	deque<EventFrame>              m_queueFrame;
+};
+
+#endif // CELEX5_FRAMESLICER_H
@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2017-2018  CelePixel Technology Co. Ltd.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CELEX5_PARALLELREADER_H
+#define CELEX5_PARALLELREADER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "celex5.h"
+
+using namespace std;
+
+class MappedFile;
+class CeleX5EventFileReader;
+class CeleX5DataProcessor;
+
+// Decode the events of a MIPI recording or of an event file on a pool of threads.
+// Every block of the file is a chunk that decodes on its own and the chunks come out
+// of getNextChunk in file order, which is time order. A MIPI chunk is decoded from a
+// blank decoder state, with EventData::t counted from its first row; the consumer then
+// rebases it on the state the previous chunk ended with, so the events are the same
+// as a sequential CeleX5DataProcessor would give. Full frames are skipped.
+// At most two chunks per thread are held in memory.
+class CELEX_EXPORTS CeleX5ParallelReader
+{
+public:
+	CeleX5ParallelReader(uint32_t threadNumber = 0); //0: one thread per core
+	~CeleX5ParallelReader();
+
+	bool openFile(const string& filePath);
+	void closeFile();
+	bool isOpened();
+
+	uint32_t getChunkCount();
+	//events of the next chunk, false after the last one
+	bool getNextChunk(vector<EventData> &vecEvent);
+
+private:
+	struct Chunk;
+	void decodeThread();
+	void decodeMIPIChunk(uint32_t index, Chunk* pChunk, CeleX5DataProcessor* pProcessor);
+	void rebaseTimeStamps(Chunk* pChunk);
+
+private:
+	MappedFile*                    m_pMappedFile;
+	CeleX5EventFileReader*         m_pEventFileReader;
+	bool                           m_bEventFile;
+
+	uint32_t                       m_uiThreadNumber;
+	vector<thread>                 m_vecThread;
+	mutex                          m_mutexChunk;
+	condition_variable             m_conditionChunk;
+	vector<Chunk*>                 m_vecChunk; //ring of decoded chunks, indexed by chunk % size
+	uint32_t                       m_uiChunkCount;
+	uint32_t                       m_uiNextChunk; //next chunk to decode
+	uint32_t                       m_uiReadChunk; //next chunk to hand out
+	bool                           m_bStopped;
+
+	//decoder state at the end of the chunks handed out so far
+	uint32_t                       m_uiEventTCounter;
+	uint32_t                       m_uiLastRowTime;
+	uint32_t                       m_uiEventPacketFormat;
+	bool                           m_bRowTimeValid;
+};
+
+#endif // CELEX5_PARALLELREADER_H